@@ -0,0 +1,240 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Hash.hpp"
+#include "HashSet.hpp"
+
+
+// Compares hash functions on the kinds of keys the interpreter sees. For each
+// set of keys, reports how quickly the keys are hashed and how far keys end up
+// from their ideal slot in the interpreter's own hash tables.
+
+
+namespace
+{
+  using KeySet = std::vector<std::string>;
+
+
+  std::size_t std_hash(const std::string& str)
+  {
+    return std::hash<std::string>()(str);
+  }
+
+
+  std::size_t fnv1a_hash(const std::string& str)
+  {
+    std::size_t hash = 14695981039346656037ul;
+    for (const auto c : str) {
+      hash ^= static_cast<unsigned char>(c);
+      hash *= 1099511628211ul;
+    }
+    return hash;
+  }
+
+
+  std::size_t loxx_hash(const std::string& str)
+  {
+    return loxx::hash_bytes(str.data(), str.size());
+  }
+
+
+  struct HashFunction
+  {
+    const char* name;
+    std::size_t (*func)(const std::string&);
+  };
+
+
+  // The tables store pointers, just like the interpreter's tables of
+  // interned strings.
+  template <std::size_t (*Func)(const std::string&)>
+  struct HashStringPtr
+  {
+    std::size_t operator()(const std::string* str) const
+    { return Func(*str); }
+  };
+
+
+  KeySet make_identifiers(const std::size_t num_keys)
+  {
+    const char* prefixes[] = {
+        "func_", "total_", "Class_", "method_", "value", "a", "i"};
+
+    KeySet ret;
+    for (std::size_t i = 0; ret.size() < num_keys; ++i) {
+      for (const auto prefix : prefixes) {
+        ret.push_back(prefix + std::to_string(i));
+      }
+    }
+    ret.resize(num_keys);
+    return ret;
+  }
+
+
+  KeySet make_short_strings(const std::size_t num_keys)
+  {
+    const std::string chars = "abcdefghijklmnopqrstuvwxyz0123456789_";
+
+    KeySet ret;
+    for (std::size_t i = 0; ret.size() < num_keys; ++i) {
+      std::string str;
+      auto n = i;
+      do {
+        str += chars[n % chars.size()];
+        n /= chars.size();
+      } while (n > 0);
+      ret.push_back(str);
+    }
+    return ret;
+  }
+
+
+  KeySet make_random_strings(const std::size_t num_keys,
+                             const std::size_t min_size,
+                             const std::size_t max_size)
+  {
+    std::mt19937_64 generator(42);
+    std::uniform_int_distribution<std::size_t> size_dist(min_size, max_size);
+    std::uniform_int_distribution<int> char_dist(32, 126);
+
+    KeySet ret;
+    while (ret.size() < num_keys) {
+      std::string str(size_dist(generator), ' ');
+      for (auto& c : str) {
+        c = static_cast<char>(char_dist(generator));
+      }
+      ret.push_back(str);
+    }
+    return ret;
+  }
+
+
+  double time_hashing(const KeySet& keys, const HashFunction& hash,
+                      const std::size_t num_iters)
+  {
+    using namespace std::chrono;
+
+    std::size_t total = 0;
+    const auto start = steady_clock::now();
+
+    for (std::size_t i = 0; i < num_iters; ++i) {
+      for (const auto& key : keys) {
+        total += hash.func(key);
+      }
+    }
+
+    const auto elapsed = duration<double>(steady_clock::now() - start);
+
+    // Stops the compiler from throwing the hashing away.
+    if (total == 1) {
+      std::cout << ' ';
+    }
+
+    return elapsed.count() / static_cast<double>(num_iters * keys.size());
+  }
+
+
+  template <std::size_t (*Func)(const std::string&)>
+  void measure_probe_lengths(const KeySet& keys, double& mean,
+                             std::size_t& max)
+  {
+    loxx::HashSet<const std::string*, HashStringPtr<Func>> set;
+
+    for (const auto& key : keys) {
+      set.insert(&key);
+    }
+
+    std::size_t total = 0;
+    max = 0;
+
+    for (const auto& key : keys) {
+      const auto length = set.probe_length(&key);
+      total += length;
+      max = std::max(max, length);
+    }
+
+    mean = static_cast<double>(total) / static_cast<double>(keys.size());
+  }
+
+
+  template <std::size_t (*Func)(const std::string&)>
+  void run_benchmark(const char* set_name, const KeySet& keys,
+                     const HashFunction& hash)
+  {
+    std::size_t num_bytes = 0;
+    for (const auto& key : keys) {
+      num_bytes += key.size();
+    }
+
+    const auto num_iters = std::max<std::size_t>(1, 50000000 / num_bytes);
+    const auto seconds_per_key = time_hashing(keys, hash, num_iters);
+    const auto bytes_per_key =
+        static_cast<double>(num_bytes) / static_cast<double>(keys.size());
+
+    double mean_probe_length = 0.0;
+    std::size_t max_probe_length = 0;
+    measure_probe_lengths<Func>(keys, mean_probe_length, max_probe_length);
+
+    std::cout << std::left << std::setw(16) << set_name
+              << std::setw(10) << hash.name << std::right << std::fixed
+              << std::setprecision(2) << std::setw(10)
+              << seconds_per_key * 1.0e9
+              << std::setw(12) << bytes_per_key / seconds_per_key / 1.0e6
+              << std::setw(12) << mean_probe_length
+              << std::setw(8) << max_probe_length << '\n';
+  }
+}
+
+
+int main()
+{
+  const std::pair<const char*, KeySet> key_sets[] = {
+      {"identifiers", make_identifiers(100000)},
+      {"short", make_short_strings(100000)},
+      {"medium", make_random_strings(100000, 8, 64)},
+      {"long", make_random_strings(10000, 256, 4096)},
+  };
+
+  std::cout << std::left << std::setw(16) << "Keys"
+            << std::setw(10) << "Hash" << std::right
+            << std::setw(10) << "ns/key" << std::setw(12) << "MB/s"
+            << std::setw(12) << "Mean probe" << std::setw(8) << "Max"
+            << '\n';
+
+  for (const auto& key_set : key_sets) {
+    run_benchmark<std_hash>(key_set.first, key_set.second,
+                            {"std::hash", std_hash});
+    run_benchmark<fnv1a_hash>(key_set.first, key_set.second,
+                              {"FNV-1a", fnv1a_hash});
+    run_benchmark<loxx_hash>(key_set.first, key_set.second,
+                             {"wyhash", loxx_hash});
+  }
+
+  return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Hash.hpp"
+#include "HashTable.hpp"
+#include "SwissHashTable.hpp"
+
+
+// Compares the hash table backends on the operations the interpreter uses
+// them for. Keys are pointers to objects that carry their own hash, like the
+// interpreter's interned strings, so the timings are of the tables alone.
+
+
+namespace
+{
+  struct Key
+  {
+    std::size_t hash;
+  };
+
+
+  struct HashKey
+  {
+    std::size_t operator()(const Key* key) const { return key->hash; }
+  };
+
+
+  struct CompareKey
+  {
+    bool operator()(const Key* first, const Key* second) const
+    { return first == second; }
+  };
+
+
+  using RobinHoodTable =
+      loxx::HashTable<const Key*, double, HashKey, CompareKey>;
+  using SwissTable =
+      loxx::SwissHashTable<const Key*, double, HashKey, CompareKey>;
+
+
+  std::vector<Key> make_keys(const std::size_t num_keys)
+  {
+    std::vector<Key> ret(num_keys);
+    for (std::size_t i = 0; i < num_keys; ++i) {
+      ret[i].hash = loxx::hash_bytes(&i, sizeof(i));
+    }
+    return ret;
+  }
+
+
+  std::vector<const Key*> shuffled(const std::vector<Key>& keys)
+  {
+    std::vector<const Key*> ret;
+    for (const auto& key : keys) {
+      ret.push_back(&key);
+    }
+    std::shuffle(ret.begin(), ret.end(), std::mt19937_64(42));
+    return ret;
+  }
+
+
+  // Runs the operation over and over until enough time has passed to give a
+  // stable figure, returning the time taken per key.
+  template <typename Fn>
+  double time_per_key(const std::size_t num_keys, Fn operation)
+  {
+    using namespace std::chrono;
+
+    std::size_t num_iters = 0;
+    const auto start = steady_clock::now();
+    duration<double> elapsed(0.0);
+
+    while (elapsed.count() < 0.2) {
+      operation();
+      ++num_iters;
+      elapsed = steady_clock::now() - start;
+    }
+
+    return elapsed.count() / static_cast<double>(num_iters * num_keys);
+  }
+
+
+  template <typename Table>
+  void run_benchmark(const char* table_name, const std::size_t num_keys)
+  {
+    const auto keys = make_keys(num_keys);
+    const auto missing_keys = make_keys(2 * num_keys);
+    const auto order = shuffled(keys);
+    double total = 0.0;
+
+    const auto insert = time_per_key(
+        num_keys,
+        [&] {
+          Table table;
+          for (const auto key : order) {
+            table[key] = 1.0;
+          }
+          total += table.size();
+        });
+
+    Table table;
+    for (const auto key : order) {
+      table[key] = 1.0;
+    }
+
+    const auto hit = time_per_key(
+        num_keys,
+        [&] {
+          for (const auto key : order) {
+            total += table.get(key)->second;
+          }
+        });
+
+    // The second half of these keys were never inserted.
+    const auto miss = time_per_key(
+        num_keys,
+        [&] {
+          for (std::size_t i = num_keys; i < 2 * num_keys; ++i) {
+            total += table.has_item(&missing_keys[i]) ? 1.0 : 0.0;
+          }
+        });
+
+    const auto churn = time_per_key(
+        num_keys,
+        [&] {
+          for (const auto key : order) {
+            table.erase(key);
+            table[key] = 2.0;
+          }
+        });
+
+    // Stops the compiler from throwing the lookups away.
+    if (total == 0.5) {
+      std::cout << ' ';
+    }
+
+    std::cout << std::left << std::setw(12) << table_name << std::right
+              << std::setw(8) << num_keys << std::fixed << std::setprecision(2)
+              << std::setw(10) << insert * 1.0e9
+              << std::setw(10) << hit * 1.0e9
+              << std::setw(10) << miss * 1.0e9
+              << std::setw(10) << churn * 1.0e9 << '\n';
+  }
+}
+
+
+int main()
+{
+  std::cout << std::left << std::setw(12) << "Table" << std::right
+            << std::setw(8) << "Keys" << std::setw(10) << "Insert"
+            << std::setw(10) << "Hit" << std::setw(10) << "Miss"
+            << std::setw(10) << "Churn" << "  (ns/key)\n";
+
+  for (const std::size_t num_keys : {3, 12, 48, 384, 3072, 98304}) {
+    run_benchmark<RobinHoodTable>("Robin Hood", num_keys);
+    run_benchmark<SwissTable>("Swiss", num_keys);
+  }
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+from __future__ import division, print_function
+
+import argparse
+import os
+import subprocess
+import tempfile
+import time
+
+
+BLOCK_TEMPLATE = """\
+// Generated function number {i}, with a comment that is long enough to matter.
+fun func_{i}(alpha, beta) {{
+  var total_{i} = alpha * 2.5 + beta - {i};
+  if (total_{i} > 100 and beta != nil) {{
+    print "the value computed by function {i} is rather large";
+  }} else {{
+    total_{i} = total_{i} / 3;
+  }}
+  while (total_{i} < 10) total_{i} = total_{i} + 1;
+  return total_{i};
+}}
+
+class Class_{i} {{
+  init(value) {{
+    this.value = value;
+  }}
+
+  method_{i}(other) {{
+    return this.value + other.value * {i}.5;
+  }}
+}}
+"""
+
+
+def generate_source(target_size, blocks_per_chunk=32, chunks_per_module=32):
+    """Generate a Lox source file of approximately the given size in bytes.
+
+    Blocks are nested inside functions so that no single scope exceeds the
+    compiler's constant limits, which keeps the output compilable."""
+
+    pieces = []
+    size = 0
+    block = 0
+    module = 0
+
+    while size < target_size:
+        pieces.append("fun module_{}() {{\n".format(module))
+
+        for chunk in range(chunks_per_module):
+            pieces.append("fun chunk_{}() {{\n".format(chunk))
+
+            for _ in range(blocks_per_chunk):
+                text = BLOCK_TEMPLATE.format(i=block)
+                pieces.append(text)
+                size += len(text)
+                block += 1
+
+            pieces.append("}\n")
+
+        pieces.append("}\n")
+        module += 1
+
+    return "".join(pieces)
+
+
+def scanner_name(interpreter):
+    """Ask the interpreter which of its scanners it picked for this machine."""
+
+    output = subprocess.check_output([interpreter, "--print-scanner"])
+    return output.decode("utf-8").splitlines()[0].strip()
+
+
+def run_benchmark(interpreter_args, source_path, num_iters, verbose=False):
+    """Time the interpreter over the source file, returning the durations."""
+
+    durations = []
+
+    for i in range(num_iters):
+        start = time.time()
+        process = subprocess.Popen(interpreter_args + [source_path],
+                                   stdout=subprocess.PIPE,
+                                   stderr=subprocess.PIPE)
+        output, _ = process.communicate()
+        durations.append(time.time() - start)
+
+        if process.returncode != 0:
+            raise RuntimeError(
+                "Interpreter failed with return code {}:\n{}"
+                .format(process.returncode, output.decode("utf-8")))
+
+        if verbose:
+            print("  - Iteration {} of {}: {:>4.3f} s"
+                  .format(i + 1, num_iters, durations[-1]))
+
+    return durations
+
+
+if __name__ == "__main__":
+
+    parser = argparse.ArgumentParser(
+        description="Measure the throughput of the loxx front end on a large "
+                    "generated source file.")
+    parser.add_argument("interpreter", help="Path to interpreter to bench.")
+    parser.add_argument("-s", "--size", type=float, default=4.0,
+                        help="Size of the generated source in megabytes.")
+    parser.add_argument("-p", "--phases", nargs="+", default=["scan"],
+                        choices=["scan", "parse", "compile"],
+                        help="Front end phases to stop after.")
+    parser.add_argument("-m", "--modes", nargs="+", default=["ast"],
+                        choices=["ast", "single-pass"],
+                        help="Compilation modes to benchmark. The single-pass "
+                             "mode has no separate parse phase, so only the "
+                             "compile phase is run for it.")
+    parser.add_argument("-a", "--interpreter-args", nargs="+", default=[],
+                        help="Additional arguments to pass to the interpreter.")
+    parser.add_argument("-n", "--num-iters", type=int, default=10,
+                        help="Number of iterations to run each phase for.")
+    parser.add_argument("-v", "--verbose", action="store_true",
+                        help="Print iteration times when benchmarking.")
+    args = parser.parse_args()
+
+    source = generate_source(int(args.size * 1024 * 1024))
+    megabytes = len(source) / (1024 * 1024)
+
+    with tempfile.NamedTemporaryFile("w", suffix=".lox", delete=False) as f:
+        f.write(source)
+        source_path = f.name
+
+    try:
+        print("Generated {:.2f} MB of source.".format(megabytes))
+        print("Using the {} scanner.".format(scanner_name(args.interpreter)))
+
+        for mode in args.modes:
+            mode_args = ["--single-pass"] if mode == "single-pass" else []
+            phases = ([p for p in args.phases if p == "compile"]
+                      if mode == "single-pass" else args.phases)
+
+            for phase in phases:
+                print("Running up to phase '{}' in {} mode..."
+                      .format(phase, mode))
+                interpreter_args = ([args.interpreter, "--stop-after", phase] +
+                                    mode_args + args.interpreter_args)
+                durations = run_benchmark(interpreter_args, source_path,
+                                          args.num_iters, args.verbose)
+
+                best = min(durations)
+                mean = sum(durations) / len(durations)
+                print("* {:<20} = {:>4.3f} s".format("Min.", best))
+                print("* {:<20} = {:>4.3f} s".format("Mean", mean))
+                print("* {:<20} = {:>4.1f} MB/s"
+                      .format("Peak throughput", megabytes / best))
+    finally:
+        os.remove(source_path)
@@ -0,0 +1,55 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include "Arena.hpp"
+
+
+namespace loxx
+{
+  void Arena::release()
+  {
+    chunks_.clear();
+    head_ = nullptr;
+    end_ = nullptr;
+  }
+
+
+  void* Arena::allocate_chunk(const std::size_t size,
+                              const std::size_t alignment)
+  {
+    // Oversized requests get a chunk of their own so that the current chunk
+    // can carry on serving small allocations.
+    const auto capacity = size + alignment;
+    const bool dedicated = capacity > chunk_size_ / 4;
+    const auto chunk_size = dedicated ? capacity : chunk_size_;
+
+    chunks_.emplace_back(new char[chunk_size]);
+    char* chunk = chunks_.back().get();
+
+    const auto address = reinterpret_cast<std::uintptr_t>(chunk);
+    const auto padding = (alignment - address % alignment) % alignment;
+
+    if (not dedicated) {
+      head_ = chunk + padding + size;
+      end_ = chunk + chunk_size;
+    }
+
+    return chunk + padding;
+  }
+}
@@ -0,0 +1,132 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_ARENA_HPP
+#define LOXX_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+
+namespace loxx
+{
+  // Fixed-size, read-only view of a sequence of elements that live in an
+  // Arena. Used by the AST in place of std::vector so that node lists don't
+  // need their own heap allocations.
+  template <typename T>
+  class ArenaList
+  {
+  public:
+    ArenaList() : data_(nullptr), size_(0) {}
+    ArenaList(T* data, const std::size_t size) : data_(data), size_(size) {}
+
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+
+    T& operator[](const std::size_t idx) const { return data_[idx]; }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+  private:
+    T* data_;
+    std::size_t size_;
+  };
+
+
+  // Bump allocator for objects that share a lifetime, such as the nodes of a
+  // syntax tree. Memory is handed out from large chunks and is only ever
+  // returned all at once, either by release() or by the destructor. Object
+  // destructors are never run, so anything created here must not own
+  // resources outside the arena.
+  class Arena
+  {
+  public:
+    explicit Arena(const std::size_t chunk_size = 64 * 1024)
+        : chunk_size_(chunk_size), head_(nullptr), end_(nullptr)
+    {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args);
+
+    template <typename T>
+    ArenaList<T> make_list(const T* first, const T* last);
+
+    void* allocate(const std::size_t size, const std::size_t alignment);
+    void release();
+
+  private:
+    void* allocate_chunk(const std::size_t size, const std::size_t alignment);
+
+    std::size_t chunk_size_;
+    char* head_;
+    char* end_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+  };
+
+
+  template <typename T, typename... Args>
+  T* Arena::make(Args&&... args)
+  {
+    void* ptr = allocate(sizeof(T), alignof(T));
+    return new (ptr) T(std::forward<Args>(args)...);
+  }
+
+
+  template <typename T>
+  ArenaList<T> Arena::make_list(const T* first, const T* last)
+  {
+    const auto size = static_cast<std::size_t>(last - first);
+
+    if (size == 0) {
+      return ArenaList<T>();
+    }
+
+    auto data = static_cast<T*>(allocate(sizeof(T) * size, alignof(T)));
+    std::uninitialized_copy(first, last, data);
+
+    return ArenaList<T>(data, size);
+  }
+
+
+  inline void* Arena::allocate(const std::size_t size,
+                               const std::size_t alignment)
+  {
+    const auto address = reinterpret_cast<std::uintptr_t>(head_);
+    const auto padding = (alignment - address % alignment) % alignment;
+
+    if (head_ == nullptr or
+        static_cast<std::size_t>(end_ - head_) < size + padding) {
+      return allocate_chunk(size, alignment);
+    }
+
+    void* ret = head_ + padding;
+    head_ += padding + size;
+    return ret;
+  }
+}
+
+#endif //LOXX_ARENA_HPP
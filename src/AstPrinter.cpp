@@ -27,20 +27,20 @@ namespace loxx
 {
   void AstPrinter::visit_unary_expr(const Unary& expr)
   {
-    paranthesise(expr.op.lexeme(), {expr.right.get()});
+    paranthesise(expr.op.lexeme(), {expr.right});
   }
 
 
   void AstPrinter::visit_assign_expr(const Assign& expr)
   {
     const std::string name = "setq " + expr.name.lexeme();
-    paranthesise(name, {expr.value.get()});
+    paranthesise(name, {expr.value});
   }
 
 
   void AstPrinter::visit_binary_expr(const Binary& expr)
   {
-    paranthesise(expr.op.lexeme(), {expr.left.get(), expr.right.get()});
+    paranthesise(expr.op.lexeme(), {expr.left, expr.right});
   }
 
 
@@ -53,13 +53,13 @@ namespace loxx
   void AstPrinter::visit_logical_expr(const Logical& expr)
   {
     const std::string name = expr.op.type() == TokenType::Or ? "or" : "and";
-    paranthesise(name, {expr.left.get(), expr.right.get()});
+    paranthesise(name, {expr.left, expr.right});
   }
 
 
   void AstPrinter::visit_grouping_expr(const Grouping& expr)
   {
-    paranthesise("group", {expr.expression.get()});
+    paranthesise("group", {expr.expression});
   }
 
 
@@ -85,14 +85,14 @@ namespace loxx
 
   void AstPrinter::visit_get_expr(const Get& expr)
   {
-    paranthesise("get " + expr.name.lexeme(), {expr.object.get()});
+    paranthesise("get " + expr.name.lexeme(), {expr.object});
   }
 
 
   void AstPrinter::visit_set_expr(const Set& expr)
   {
     paranthesise("set " + expr.name.lexeme(),
-                 {expr.object.get(), expr.value.get()});
+                 {expr.object, expr.value});
   }
 
 
@@ -111,13 +111,13 @@ namespace loxx
 
   void AstPrinter::visit_print_stmt(const Print& stmt)
   {
-    paranthesise("write-line", {stmt.expression.get()});
+    paranthesise("write-line", {stmt.expression});
   }
 
 
   void AstPrinter::visit_return_stmt(const Return& stmt)
   {
-    paranthesise("return", {stmt.value.get()});
+    paranthesise("return", {stmt.value});
   }
 
 
@@ -126,7 +126,7 @@ namespace loxx
     const std::string name = "defvar " + stmt.name.lexeme();
 
     if (stmt.initialiser != nullptr) {
-      paranthesise(name, {stmt.initialiser.get()});
+      paranthesise(name, {stmt.initialiser});
     }
     else {
       paranthesise(name, {});
@@ -0,0 +1,97 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_CHARCLASS_HPP
+#define LOXX_CHARCLASS_HPP
+
+#include <cstdint>
+
+
+namespace loxx
+{
+  namespace detail
+  {
+    enum CharClass : std::uint8_t
+    {
+      Alpha = 1 << 0,
+      Digit = 1 << 1
+    };
+
+
+    struct CharClassTable
+    {
+      std::uint8_t classes[256];
+    };
+
+
+    constexpr CharClassTable make_char_class_table()
+    {
+      // Lox identifiers are ASCII only, so unlike isalpha and isdigit this
+      // table doesn't depend on the current locale.
+      CharClassTable table{};
+
+      for (unsigned int c = 'a'; c <= 'z'; ++c) {
+        table.classes[c] |= CharClass::Alpha;
+      }
+      for (unsigned int c = 'A'; c <= 'Z'; ++c) {
+        table.classes[c] |= CharClass::Alpha;
+      }
+      table.classes[static_cast<unsigned char>('_')] |= CharClass::Alpha;
+
+      for (unsigned int c = '0'; c <= '9'; ++c) {
+        table.classes[c] |= CharClass::Digit;
+      }
+
+      return table;
+    }
+
+
+    constexpr CharClassTable char_class_table = make_char_class_table();
+
+
+    inline bool has_class(const char c, const std::uint8_t char_class)
+    {
+      return (char_class_table.classes[static_cast<unsigned char>(c)] &
+              char_class) != 0;
+    }
+  }
+
+
+  // Whether the character can start an identifier.
+  inline bool is_alpha(const char c)
+  {
+    return detail::has_class(c, detail::CharClass::Alpha);
+  }
+
+
+  inline bool is_digit(const char c)
+  {
+    return detail::has_class(c, detail::CharClass::Digit);
+  }
+
+
+  // Whether the character can appear after the first one in an identifier.
+  inline bool is_identifier_char(const char c)
+  {
+    return detail::has_class(
+        c, detail::CharClass::Alpha | detail::CharClass::Digit);
+  }
+}
+
+#endif //LOXX_CHARCLASS_HPP
@@ -0,0 +1,257 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <algorithm>
+#include <limits>
+
+#include "CodeObject.hpp"
+#include "Instruction.hpp"
+#include "Object.hpp"
+#include "utils.hpp"
+
+
+namespace loxx
+{
+  namespace
+  {
+    // The net change in the number of values on the stack once the
+    // instruction at the given position has run. No instruction pushes more
+    // than it leaves behind at the end.
+    long int stack_effect(const CodeObject& code_object, const std::size_t pos)
+    {
+      const auto& bytecode = code_object.bytecode;
+      const auto prefixed =
+          static_cast<Instruction>(bytecode[pos]) == Instruction::Wide;
+      const auto instruction =
+          static_cast<Instruction>(bytecode[prefixed ? pos + 1 : pos]);
+
+      switch (instruction) {
+      case Instruction::CreateClass:
+      case Instruction::CreateClosure:
+      case Instruction::CreateSubclass:
+      case Instruction::False:
+      case Instruction::GetGlobal:
+      case Instruction::GetLocal:
+      case Instruction::GetUpvalue:
+      case Instruction::LoadConstant:
+      case Instruction::Nil:
+      case Instruction::Push:
+      case Instruction::True:
+        return 1;
+
+      case Instruction::Add:
+      case Instruction::AddNumbers:
+      case Instruction::CloseUpvalue:
+      case Instruction::CreateMethod:
+      case Instruction::DefineGlobal:
+      case Instruction::Divide:
+      case Instruction::DivideNumbers:
+      case Instruction::Equal:
+      case Instruction::GetSuperFunc:
+      case Instruction::Greater:
+      case Instruction::GreaterNumbers:
+      case Instruction::Less:
+      case Instruction::LessNumbers:
+      case Instruction::Multiply:
+      case Instruction::MultiplyNumbers:
+      case Instruction::Pop:
+      case Instruction::Print:
+      case Instruction::Return:
+      case Instruction::SetProperty:
+      case Instruction::Subtract:
+      case Instruction::SubtractNumbers:
+        return -1;
+
+      case Instruction::Call:
+      case Instruction::TailCall:
+        return -static_cast<long int>(bytecode[pos + 1]);
+
+      case Instruction::Invoke:
+        // The argument count follows the method name, which may be wide.
+        return -static_cast<long int>(
+            bytecode[pos + instruction_size(code_object, pos) - 1]);
+
+      default:
+        return 0;
+      }
+    }
+  }
+
+
+  void CodeObject::add_line_num_row(int line_num_diff,
+                                    std::size_t instr_num_diff)
+  {
+    // Okay, so I totally ripped off CPython's strategy for encoding line
+    // numbers here, but what I can I say? It's a good strategy!
+
+    // The broad idea here is that for each instruction we encode the difference
+    // between the last line number number and the current line number, and the
+    // last instruction and the current instruction. Lookups stop at the first
+    // row that reaches the position in the bytecode, so differences that don't
+    // fit in a single row have their lines added before their instructions.
+    // That way the intermediate rows never match a lookup with the wrong line.
+
+    using LineDelta = std::int8_t;
+    using InstrDelta = std::uint8_t;
+
+    constexpr int max_line_delta = std::numeric_limits<LineDelta>::max();
+    constexpr int min_line_delta = std::numeric_limits<LineDelta>::min();
+    constexpr std::size_t max_instr_delta =
+        std::numeric_limits<InstrDelta>::max();
+
+    while (line_num_diff > max_line_delta or line_num_diff < min_line_delta) {
+      const auto delta = line_num_diff > 0 ? max_line_delta : min_line_delta;
+      line_num_table.emplace_back(static_cast<LineDelta>(delta), 0);
+      line_num_diff -= delta;
+    }
+
+    while (instr_num_diff > max_instr_delta) {
+      line_num_table.emplace_back(0, static_cast<InstrDelta>(max_instr_delta));
+      instr_num_diff -= max_instr_delta;
+    }
+
+    line_num_table.emplace_back(static_cast<LineDelta>(line_num_diff),
+                                static_cast<InstrDelta>(instr_num_diff));
+  }
+
+
+  std::size_t instruction_size(const CodeObject& code_object,
+                               const std::size_t pos)
+  {
+    const auto instruction =
+        static_cast<Instruction>(code_object.bytecode[pos]);
+
+    switch (instruction) {
+    case Instruction::ConditionalJump:
+    case Instruction::Jump:
+    case Instruction::JumpIfTrue:
+    case Instruction::Loop:
+      return 1 + sizeof(InstrArgUShort);
+
+    case Instruction::AssertNumbers:
+    case Instruction::Call:
+    case Instruction::CreateClass:
+    case Instruction::CreateMethod:
+    case Instruction::CreateSubclass:
+    case Instruction::DefineGlobal:
+    case Instruction::GetGlobal:
+    case Instruction::GetLocal:
+    case Instruction::GetProperty:
+    case Instruction::GetSuperFunc:
+    case Instruction::GetUpvalue:
+    case Instruction::LoadConstant:
+    case Instruction::SetGlobal:
+    case Instruction::SetLocal:
+    case Instruction::SetProperty:
+    case Instruction::SetUpvalue:
+    case Instruction::TailCall:
+      return 1 + sizeof(InstrArgUByte);
+
+    case Instruction::Invoke:
+      return 1 + 2 * sizeof(InstrArgUByte);
+
+    case Instruction::CreateClosure: {
+      const auto& func_value =
+          code_object.constants[code_object.bytecode[pos + 1]];
+      const auto func = static_cast<FuncObject*>(get<ObjectPtr>(func_value));
+      return 1 + sizeof(InstrArgUByte) +
+             2 * sizeof(InstrArgUByte) * func->num_upvalues();
+    }
+
+    case Instruction::Wide: {
+      // The prefix is treated as part of the instruction it widens, which
+      // has each of its index operands stored as two bytes rather than one.
+      const auto widened =
+          static_cast<Instruction>(code_object.bytecode[pos + 1]);
+
+      if (widened == Instruction::Invoke) {
+        return 2 + sizeof(InstrArgUShort) + sizeof(InstrArgUByte);
+      }
+      else if (widened == Instruction::CreateClosure) {
+        const auto index = read_integer_at_pos<InstrArgUShort>(
+            code_object.bytecode.data() + pos + 2);
+        const auto func = static_cast<FuncObject*>(
+            get<ObjectPtr>(code_object.constants[index]));
+        return 2 + sizeof(InstrArgUShort) +
+               (sizeof(InstrArgUByte) + sizeof(InstrArgUShort)) *
+               func->num_upvalues();
+      }
+
+      return 2 + sizeof(InstrArgUShort);
+    }
+
+    default:
+      return 1;
+    }
+  }
+
+
+  std::size_t compute_stack_size(const CodeObject& code_object)
+  {
+    const auto& bytecode = code_object.bytecode;
+
+    // The bytecode is generated from structured code, so every path to an
+    // instruction arrives with the same stack depth, and each instruction
+    // only needs visiting once.
+    std::vector<long int> depths(bytecode.size(), -1);
+    std::vector<std::size_t> pending;
+    long int max_depth = 0;
+
+    if (not bytecode.empty()) {
+      depths[0] = 0;
+      pending.push_back(0);
+    }
+
+    const auto visit = [&] (const std::size_t pos, const long int depth) {
+      if (pos < bytecode.size() and depths[pos] < 0) {
+        depths[pos] = depth;
+        pending.push_back(pos);
+      }
+    };
+
+    while (not pending.empty()) {
+      const auto pos = pending.back();
+      pending.pop_back();
+
+      const auto instruction = static_cast<Instruction>(bytecode[pos]);
+      const auto size = instruction_size(code_object, pos);
+      const auto depth = depths[pos] + stack_effect(code_object, pos);
+      max_depth = std::max(max_depth, depth);
+
+      if (instruction == Instruction::Loop) {
+        visit(pos + size - read_integer_at_pos<InstrArgUShort>(
+            bytecode.data() + pos + 1), depth);
+        continue;
+      }
+      else if (instruction == Instruction::ConditionalJump or
+               instruction == Instruction::Jump or
+               instruction == Instruction::JumpIfTrue) {
+        visit(pos + size + read_integer_at_pos<InstrArgUShort>(
+            bytecode.data() + pos + 1), depth);
+      }
+
+      if (instruction != Instruction::Jump and
+          instruction != Instruction::Return) {
+        visit(pos + size, depth);
+      }
+    }
+
+    return static_cast<std::size_t>(max_depth);
+  }
+}
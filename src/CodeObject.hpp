@@ -25,7 +25,6 @@
 #include <vector>
 
 #include "globals.hpp"
-#include "StringHashTable.hpp"
 #include "Value.hpp"
 
 
@@ -33,13 +32,32 @@ namespace loxx
 {
   struct CodeObject
   {
-    using InsPtr = std::vector<std::uint8_t>::const_iterator;
+    using InsPtr = const std::uint8_t*;
 
     std::vector<std::uint8_t> bytecode;
-    ConstStringHashTable<InstrArgUByte> constant_map;
     std::vector<Value> constants;
     std::vector<std::tuple<std::int8_t, std::uint8_t>> line_num_table;
+
+    // Appends rows to the line number table to advance by the given number
+    // of lines and bytes, splitting the step across several rows if it's too
+    // large for one.
+    void add_line_num_row(int line_num_diff, std::size_t instr_num_diff);
+
+    // The largest number of values the code pushes onto the stack above the
+    // contents of its frame when it's called, as found by
+    // compute_stack_size.
+    std::size_t stack_size = 0;
   };
+
+
+  // Returns the size of the instruction at the given position, including its
+  // operands. A wide prefix counts as part of the instruction it precedes.
+  std::size_t instruction_size(const CodeObject& code_object,
+                               const std::size_t pos);
+
+  // Follows every path through the bytecode to find the deepest the stack
+  // can get while it runs.
+  std::size_t compute_stack_size(const CodeObject& code_object);
 }
 
 #endif //LOXX_CODEOBJECT_HPP
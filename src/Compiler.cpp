@@ -20,15 +20,45 @@
 #include "Compiler.hpp"
 #include "logging.hpp"
 #include "ObjectTracker.hpp"
+#include "Peephole.hpp"
+#include "ThreadPool.hpp"
+#include "TypeInference.hpp"
 #include "VirtualMachine.hpp"
 
 
 namespace loxx
 {
-  void Compiler::compile(const std::vector<std::unique_ptr<Stmt>>& statements)
+  void Compiler::compile(const ArenaList<Stmt*>& statements)
   {
-    compile_stmts(statements);
+    auto& tracker = ObjectTracker::instance();
+    tracker.pause_gc();
+
+    if (options_.infer_types) {
+      TypeInference(numeric_ops_).infer_script(statements);
+    }
+
+    if (options_.inline_functions) {
+      inliner_ = std::make_shared<const Inliner>(statements);
+    }
+
+    // Printing bytecode as each function is finished relies on functions
+    // being compiled in order, so that forces serial compilation.
+    if (options_.num_threads > 1 and not options_.print_bytecode) {
+      tracker.set_thread_safe(true);
+      {
+        ThreadPool pool(options_.num_threads);
+        submit_functions(statements, pool);
+        compile_stmts(statements);
+      }
+      tracker.set_thread_safe(false);
+      pending_functions_.clear();
+    }
+    else {
+      compile_stmts(statements);
+    }
+
     func_->add_instruction(Instruction::Return);
+    tracker.resume_gc();
   }
 
 
@@ -42,49 +72,23 @@ namespace loxx
 
   void Compiler::visit_class_stmt(const Class& stmt)
   {
-    const auto class_type_old = class_type_;
-    class_type_ = stmt.superclass ? ClassType::Subclass : ClassType::Superclass;
-
-    // If this class derives from an existing class, we create an additional
-    // scope containing a reference to the superclass, which is then captured
-    // as an upvalue if it's used anywhere via the super keyword
-    if (stmt.superclass) {
-      func_->begin_scope();
+    const auto has_superclass = stmt.superclass != nullptr;
+    const auto class_type_old = begin_class(has_superclass);
 
-      func_->add_local(func_->make_token(TokenType::Super, "super"));
+    if (has_superclass) {
       compile(*stmt.superclass);
     }
 
-    // Add an instruction to make the class
-    const auto op = stmt.superclass ?
-                    Instruction::CreateSubclass : Instruction::CreateClass;
-    const auto name_constant = make_string_constant(stmt.name.lexeme());
-    func_->add_instruction(op);
-    func_->add_integer<InstrArgUByte>(name_constant);
-    func_->update_line_num_table(stmt.name);
+    const auto name_constant = create_class(stmt.name, has_superclass);
 
     // Compile the class's methods
     for (const auto& method : stmt.methods) {
-      const auto method_constant = make_string_constant(method->name.lexeme());
-      const auto type =
-          method->name.lexeme() == "init" ?
-          FunctionType::Initialiser :
-          FunctionType::Method;
-      compile_function(*method, type);
-
-      func_->add_instruction(Instruction::CreateMethod);
-      func_->add_integer<InstrArgUByte>(method_constant);
-      func_->update_line_num_table(method->name);
+      const auto method_constant = make_string_constant(method->name.symbol());
+      compile_function(*method, method_type(method->name));
+      create_method(method->name, method_constant);
     }
 
-    // Close the scope we opened above, if applicable
-    if (stmt.superclass) {
-      func_->end_scope();
-    }
-
-    define_variable(name_constant, stmt.name);
-
-    class_type_ = class_type_old;
+    end_class(stmt.name, name_constant, has_superclass, class_type_old);
   }
 
 
@@ -145,25 +149,14 @@ namespace loxx
 
   void Compiler::visit_return_stmt(const Return& stmt)
   {
-    if (func_->type() == FunctionType::None) {
-      error(stmt.keyword, "Cannot return from top-level code.");
-    }
-    if (func_->type() == FunctionType::Initialiser and stmt.value != nullptr) {
-      error(stmt.keyword, "Cannot return a value from an initialiser.");
-    }
+    const auto has_value = stmt.value != nullptr;
+    check_return(stmt.keyword, has_value);
 
-    if (func_->type() == FunctionType::Initialiser) {
-      compile_this_return();
-      return;
-    }
-    else if (stmt.value != nullptr) {
+    if (has_value and func_->type() != FunctionType::Initialiser) {
       compile(*stmt.value);
     }
-    else {
-      func_->add_instruction(Instruction::Nil);
-    }
-    func_->add_instruction(Instruction::Return);
-    func_->update_line_num_table(stmt.keyword);
+
+    compile_return(stmt.keyword, has_value);
   }
 
 
@@ -224,102 +217,49 @@ namespace loxx
   void Compiler::visit_binary_expr(const Binary& expr)
   {
     compile(*expr.left);
+    ++num_temporaries_;
     compile(*expr.right);
-
-    switch (expr.op.type()) {
-
-    case TokenType::Plus: {
-      func_->add_instruction(Instruction::Add);
-    }
-      break;
-
-    case TokenType::Minus: {
-      func_->add_instruction(Instruction::Subtract);
-    }
-      break;
-
-    case TokenType::Star: {
-      func_->add_instruction(Instruction::Multiply);
-    }
-      break;
-
-    case TokenType::Slash: {
-      func_->add_instruction(Instruction::Divide);
-    }
-      break;
-
-    case TokenType::Less: {
-      func_->add_instruction(Instruction::Less);
-    }
-      break;
-
-    case TokenType::LessEqual: {
-      func_->add_instruction(Instruction::Greater);
-      func_->add_instruction(Instruction::Not);
-    }
-      break;
-
-    case TokenType::Greater: {
-      func_->add_instruction(Instruction::Greater);
-    }
-      break;
-
-    case TokenType::GreaterEqual: {
-      func_->add_instruction(Instruction::Less);
-      func_->add_instruction(Instruction::Not);
-    }
-      break;
-
-    case TokenType::EqualEqual: {
-      func_->add_instruction(Instruction::Equal);
-    }
-      break;
-
-    case TokenType::BangEqual: {
-      func_->add_instruction(Instruction::Equal);
-      func_->add_instruction(Instruction::Not);
-    }
-      break;
-
-    default:
-      break;
-    }
-    func_->update_line_num_table(expr.op);
+    --num_temporaries_;
+    compile_binary_op(expr.op, has_numeric_operands(expr));
   }
 
 
   void Compiler::visit_call_expr(const Call& expr)
   {
+    if (inliner_ != nullptr) {
+      const auto target = inliner_->target(expr);
+
+      if (target != nullptr and can_inline(*target, expr)) {
+        compile_inline_call(*target, expr);
+        return;
+      }
+    }
+
     const auto callee_is_property = typeid(*expr.callee) == typeid(Get);
 
     if (callee_is_property) {
-      const auto get = static_cast<const Get*>(expr.callee.get());
+      const auto get = static_cast<const Get*>(expr.callee);
       compile(*get->object);
     }
     else {
       compile(*expr.callee);
     }
 
+    ++num_temporaries_;
+
     for (const auto& argument : expr.arguments) {
       compile(*argument);
+      ++num_temporaries_;
     }
 
-    if (expr.arguments.size() > std::numeric_limits<InstrArgUByte>::max()) {
-      error(expr.paren, "Too many arguments passed to function.");
-    }
+    num_temporaries_ -= expr.arguments.size() + 1;
 
     if (callee_is_property) {
-      const auto get = static_cast<const Get*>(expr.callee.get());
-      func_->add_instruction(Instruction::Invoke);
-      func_->update_line_num_table(expr.paren);
-      func_->add_integer<InstrArgUByte>(
-          func_->add_string_constant(get->name.lexeme()));
-      func_->add_integer(static_cast<InstrArgUByte>(expr.arguments.size()));
+      const auto get = static_cast<const Get*>(expr.callee);
+      compile_invoke(get->name, expr.paren, expr.arguments.size());
     }
     else {
-      func_->add_instruction(Instruction::Call);
-      func_->update_line_num_table(expr.paren);
-      func_->add_integer(static_cast<InstrArgUByte>(expr.arguments.size()));
+      compile_call(expr.paren, expr.arguments.size());
     }
   }
 
@@ -327,11 +267,7 @@ namespace loxx
   void Compiler::visit_get_expr(const Get& expr)
   {
     compile(*expr.object);
-
-    const auto name_constant = make_string_constant(expr.name.lexeme());
-    func_->add_instruction(Instruction::GetProperty);
-    func_->add_integer<InstrArgUByte>(name_constant);
-    func_->update_line_num_table(expr.name);
+    compile_property_reference(expr.name, false);
   }
 
 
@@ -343,21 +279,7 @@ namespace loxx
 
   void Compiler::visit_literal_expr(const Literal& expr)
   {
-    if (holds_alternative<bool>(expr.value)) {
-      const Instruction instruction =
-          get<bool>(expr.value) ? Instruction::True : Instruction::False;
-      func_->add_instruction(instruction);
-      return;
-    }
-    else if (expr.value.index() == Value::npos) {
-      func_->add_instruction(Instruction::Nil);
-      return;
-    }
-
-    const auto index = func_->add_named_constant(expr.lexeme, expr.value);
-
-    func_->add_instruction(Instruction::LoadConstant);
-    func_->add_integer<InstrArgUByte>(index);
+    compile_literal(expr.value, expr.lexeme);
   }
 
 
@@ -369,6 +291,7 @@ namespace loxx
       const auto first_jump_pos = func_->add_jump(Instruction::ConditionalJump);
       const auto second_jump_pos = func_->add_jump(Instruction::Jump);
       func_->patch_jump(first_jump_pos);
+      func_->add_instruction(Instruction::Pop);
       compile(*expr.right);
       func_->patch_jump(second_jump_pos);
     }
@@ -384,56 +307,29 @@ namespace loxx
   void Compiler::visit_set_expr(const Set& expr)
   {
     compile(*expr.object);
+    ++num_temporaries_;
     compile(*expr.value);
-
-    const auto name_constant = make_string_constant(expr.name.lexeme());
-    func_->add_instruction(Instruction::SetProperty);
-    func_->add_integer<InstrArgUByte>(name_constant);
-    func_->update_line_num_table(expr.name);
+    --num_temporaries_;
+    compile_property_reference(expr.name, true);
   }
 
 
   void Compiler::visit_super_expr(const Super& expr)
   {
-    if (class_type_ == ClassType::Superclass) {
-      error(expr.keyword,
-            "Cannot use 'super' in a class without a superclass.");
-    }
-    else if (class_type_ == ClassType::None) {
-      error(expr.keyword, "Cannot use 'super' outside of a class.");
-    }
-
-    const auto this_token = Token(TokenType::This, "this", expr.keyword.line());
-    handle_variable_reference(this_token, false);
-    handle_variable_reference(expr.keyword, false);
-
-    const auto func = make_string_constant(expr.method.lexeme());
-    func_->add_instruction(Instruction::GetSuperFunc);
-    func_->add_integer<InstrArgUByte>(func);
-    func_->update_line_num_table(expr.keyword);
+    compile_super(expr.keyword, expr.method);
   }
 
 
   void Compiler::visit_this_expr(const This& expr)
   {
-    if (class_type_ == ClassType::None) {
-      error(expr.keyword, "Cannot use 'this' outside of a class.");
-    }
-    handle_variable_reference(expr, false);
+    compile_this(expr.keyword);
   }
 
 
   void Compiler::visit_unary_expr(const Unary& expr)
   {
     compile(*expr.right);
-
-    if (expr.op.type() == TokenType::Bang) {
-      func_->add_instruction(Instruction::Not);
-    }
-    else if (expr.op.type() == TokenType::Minus) {
-      func_->add_instruction(Instruction::Negate);
-    }
-    func_->update_line_num_table(expr.op);
+    compile_unary_op(expr.op, has_numeric_operands(expr));
   }
 
 
@@ -443,8 +339,7 @@ namespace loxx
   }
 
 
-  void Compiler::compile_stmts(
-      const std::vector<std::unique_ptr<Stmt>>& statements)
+  void Compiler::compile_stmts(const ArenaList<Stmt*>& statements)
   {
     for (const auto& stmt : statements) {
       try {
@@ -469,26 +364,245 @@ namespace loxx
   }
 
 
+  std::unique_ptr<CodeObject> Compiler::release_output()
+  {
+    auto ret = func_->release_code_object();
+    finish_code_object("top level", *ret);
+    return ret;
+  }
+
+
   void Compiler::compile_function(const Function& stmt, const FunctionType type)
+  {
+    const auto pending = pending_functions_.find(&stmt);
+
+    if (pending != pending_functions_.end()) {
+      auto function = pending->second.get();
+      report_held_errors(function.errors);
+
+      for (const auto& upvalue : function.upvalues) {
+        if (upvalue.is_local) {
+          func_->capture_local(upvalue.index);
+        }
+      }
+
+      create_closure(stmt.name, function);
+      return;
+    }
+
+    if (options_.infer_types) {
+      TypeInference(numeric_ops_).infer_function(stmt);
+    }
+
+    begin_function(stmt.name, type);
+
+    for (const auto& param : stmt.parameters) {
+      compile_parameter(param);
+    }
+
+    compile_stmts(stmt.body);
+
+    end_function(stmt.name, static_cast<unsigned int>(stmt.parameters.size()));
+  }
+
+
+  void Compiler::submit_functions(const ArenaList<Stmt*>& statements,
+                                  ThreadPool& pool)
+  {
+    // Functions and methods declared at the top level of the script can only
+    // capture the reference to a superclass from the enclosing scope, so
+    // they can be compiled independently of one another and of the top-level
+    // code. The results are collected as the top-level code is compiled.
+    // Workers compile serially and never print, as the output would be
+    // interleaved.
+    auto worker_options = options_;
+    worker_options.print_bytecode = false;
+    worker_options.num_threads = 1;
+    const auto inliner = inliner_;
+
+    for (const auto stmt : statements) {
+      if (typeid(*stmt) == typeid(Function)) {
+        const auto func = static_cast<const Function*>(stmt);
+        pending_functions_[func] = pool.submit([=] () {
+          return compile_isolated_function(
+              *func, FunctionType::Function, ClassType::None, worker_options,
+              inliner);
+        });
+      }
+      else if (typeid(*stmt) == typeid(Class)) {
+        const auto cls = static_cast<const Class*>(stmt);
+        const auto class_type = cls->superclass != nullptr ?
+                                ClassType::Subclass : ClassType::Superclass;
+
+        for (const auto method : cls->methods) {
+          const auto type = method_type(method->name);
+          pending_functions_[method] = pool.submit([=] () {
+            return compile_isolated_function(
+                *method, type, class_type, worker_options, inliner);
+          });
+        }
+      }
+    }
+  }
+
+
+  Compiler::CompiledFunction Compiler::compile_isolated_function(
+      const Function& stmt, const FunctionType type, const ClassType class_type,
+      const CompilerOptions& options, std::shared_ptr<const Inliner> inliner)
+  {
+    ErrorBuffer errors;
+
+    // Recreate the top-level scope as it will be when the function is
+    // declared. Classes with a superclass hold it in a local.
+    Compiler compiler(options);
+    compiler.class_type_ = class_type;
+    compiler.inliner_ = std::move(inliner);
+
+    if (class_type == ClassType::Subclass) {
+      compiler.begin_class(true);
+    }
+
+    if (options.infer_types) {
+      TypeInference(compiler.numeric_ops_).infer_function(stmt);
+    }
+
+    compiler.begin_function(stmt.name, type);
+
+    for (const auto& param : stmt.parameters) {
+      compiler.compile_parameter(param);
+    }
+
+    compiler.compile_stmts(stmt.body);
+
+    auto ret = compiler.finish_function(
+        stmt.name, static_cast<unsigned int>(stmt.parameters.size()));
+    ret.errors = errors.release();
+
+    return ret;
+  }
+
+
+  void Compiler::begin_function(const Token& name, const FunctionType type)
   {
     func_ = std::make_unique<FunctionScope>(type, std::move(func_));
     func_->begin_scope();
 
     // Declare/define "this"
     if (type == FunctionType::Method or type == FunctionType::Initialiser) {
-      const auto this_token = Token(TokenType::This, "this", stmt.name.line());
+      const auto this_token = Token(
+          TokenType::This, keyword_symbol(TokenType::This), name.line());
       const auto param_index = declare_variable(this_token);
       define_variable(param_index, this_token);
     }
+  }
 
-    // Declare/define function parameters
-    for (const auto& param : stmt.parameters) {
-      const auto param_index = declare_variable(param);
-      define_variable(param_index, param);
+
+  void Compiler::compile_parameter(const Token& param)
+  {
+    const auto param_index = declare_variable(param);
+    define_variable(param_index, param);
+  }
+
+
+  void Compiler::end_function(const Token& name,
+                              const unsigned int num_parameters)
+  {
+    create_closure(name, finish_function(name, num_parameters));
+  }
+
+
+  bool Compiler::can_inline(const Inliner::Target& target,
+                            const Call& call) const
+  {
+    // The callee and any globals read by its body must mean the same thing
+    // here as they do in the body of the callee.
+    const auto& callee = static_cast<const Variable*>(call.callee)->name;
+
+    if (not func_->resolves_to_global(callee)) {
+      return false;
     }
 
-    compile_stmts(stmt.body);
+    for (const auto& global : target.globals) {
+      if (not func_->resolves_to_global(global)) {
+        return false;
+      }
+    }
+
+    const auto first_slot = func_->num_local_slots() + num_temporaries_;
+    return first_slot + call.arguments.size() <=
+           std::numeric_limits<InstrArgUShort>::max();
+  }
+
+
+  void Compiler::compile_inline_call(const Inliner::Target& target,
+                                     const Call& call)
+  {
+    // The arguments are left on the stack where the callee's parameters
+    // would be, and the body reads them from there.
+    const auto first_slot = func_->num_local_slots() + num_temporaries_;
+    const auto& parameters = target.function->parameters;
+
+    for (const auto& argument : call.arguments) {
+      compile(*argument);
+      ++num_temporaries_;
+    }
+
+    for (std::size_t i = 0; i < parameters.size(); ++i) {
+      inlined_params_.emplace_back(
+          parameters[i].symbol(), static_cast<InstrArgUShort>(first_slot + i));
+    }
+
+    if (target.result != nullptr) {
+      compile(*target.result);
+    }
+    else {
+      func_->add_instruction(Instruction::Nil);
+    }
+
+    inlined_params_.clear();
+    num_temporaries_ -= parameters.size();
+
+    if (parameters.empty()) {
+      return;
+    }
+
+    // Replace the first argument with the result and discard the rest.
+    func_->add_indexed_instruction(
+        Instruction::SetLocal, static_cast<InstrArgUShort>(first_slot));
+    func_->update_line_num_table(call.paren);
+
+    for (std::size_t i = 0; i < parameters.size(); ++i) {
+      func_->add_instruction(Instruction::Pop);
+    }
+  }
 
+
+  bool Compiler::has_numeric_operands(const Expr& expr) const
+  {
+    return numeric_ops_.count(&expr) != 0;
+  }
+
+
+  void Compiler::finish_code_object(const std::string& name,
+                                    CodeObject& code_object) const
+  {
+    const auto stats = options_.optimise_bytecode ?
+                       optimise_bytecode(code_object) : PeepholeStats{0, 0};
+    code_object.stack_size = compute_stack_size(code_object);
+
+    if (options_.print_bytecode) {
+      print_bytecode(name, code_object);
+
+      if (options_.optimise_bytecode) {
+        print_peephole_stats(stats);
+      }
+    }
+  }
+
+
+  Compiler::CompiledFunction Compiler::finish_function(
+      const Token& name, const unsigned int num_parameters)
+  {
     // Return "this" if in constructor
     if (func_->type() == FunctionType::Initialiser) {
       compile_this_return();
@@ -499,47 +613,356 @@ namespace loxx
     func_->add_instruction(Instruction::Nil);
     func_->add_instruction(Instruction::Return);
 
-    const auto upvalues = func_->release_upvalues();
+    auto upvalues = func_->release_upvalues();
     auto code_object = func_->release_code_object();
     func_ = func_->release_enclosing();
 
-    if (debug_) {
-      print_bytecode(stmt.name.lexeme(), *code_object);
-    }
+    finish_code_object(name.lexeme(), *code_object);
 
+    const auto func = make_object<FuncObject>(
+        name.lexeme(), std::move(code_object), num_parameters, upvalues.size());
+
+    return CompiledFunction{func, std::move(upvalues), {}};
+  }
+
+
+  void Compiler::create_closure(const Token& name,
+                                const CompiledFunction& function)
+  {
     // Add the new function object as a constant
-    auto func = make_object<FuncObject>(
-        stmt.name.lexeme(), std::move(code_object),
-        static_cast<unsigned int>(stmt.parameters.size()),
-        upvalues.size());
-    const auto index = func_->add_constant(Value(InPlace<ObjectPtr>(), func));
+    const auto index = func_->add_constant(
+        Value(InPlace<ObjectPtr>(), function.object));
+
+    // The upvalue indices are widened along with the function constant, so
+    // the prefix is needed if any of these exceed a byte.
+    auto max_index = index;
+    for (const auto& upvalue : function.upvalues) {
+      max_index = std::max(max_index, upvalue.index);
+    }
+    const auto wide = max_index > std::numeric_limits<InstrArgUByte>::max();
 
+    if (wide) {
+      func_->add_instruction(Instruction::Wide);
+    }
     func_->add_instruction(Instruction::CreateClosure);
-    func_->add_integer<InstrArgUByte>(index);
-    func_->update_line_num_table(stmt.name);
+    add_index(index, wide);
+    func_->update_line_num_table(name);
 
-    for (const auto& upvalue : upvalues) {
+    for (const auto& upvalue : function.upvalues) {
       func_->add_integer<InstrArgUByte>(upvalue.is_local ? 1 : 0);
-      func_->add_integer<InstrArgUByte>(upvalue.index);
+      add_index(upvalue.index, wide);
+    }
+  }
+
+
+  void Compiler::add_index(const InstrArgUShort index, const bool wide)
+  {
+    if (wide) {
+      func_->add_integer(index);
+    }
+    else {
+      func_->add_integer(static_cast<InstrArgUByte>(index));
+    }
+  }
+
+
+  FunctionType Compiler::method_type(const Token& name) const
+  {
+    return name.symbol() == symbols::init ?
+           FunctionType::Initialiser : FunctionType::Method;
+  }
+
+
+  Compiler::ClassType Compiler::begin_class(const bool has_superclass)
+  {
+    const auto class_type_old = class_type_;
+    class_type_ = has_superclass ? ClassType::Subclass : ClassType::Superclass;
+
+    // If this class derives from an existing class, we create an additional
+    // scope containing a reference to the superclass, which is then captured
+    // as an upvalue if it's used anywhere via the super keyword
+    if (has_superclass) {
+      func_->begin_scope();
+
+      func_->add_local(func_->make_token(
+          TokenType::Super, keyword_symbol(TokenType::Super)));
+      func_->define_local();
     }
+
+    return class_type_old;
+  }
+
+
+  InstrArgUShort Compiler::create_class(const Token& name,
+                                        const bool has_superclass)
+  {
+    // Add an instruction to make the class
+    const auto op = has_superclass ?
+                    Instruction::CreateSubclass : Instruction::CreateClass;
+    const auto name_constant = make_string_constant(name.symbol());
+    func_->add_indexed_instruction(op, name_constant);
+    func_->update_line_num_table(name);
+
+    return name_constant;
+  }
+
+
+  void Compiler::create_method(const Token& name,
+                               const InstrArgUShort name_constant)
+  {
+    func_->add_indexed_instruction(Instruction::CreateMethod, name_constant);
+    func_->update_line_num_table(name);
+  }
+
+
+  void Compiler::end_class(const Token& name, const InstrArgUShort name_constant,
+                           const bool has_superclass,
+                           const ClassType class_type_old)
+  {
+    define_variable(name_constant, name);
+
+    // Close the scope we opened in begin_class, if applicable. The class
+    // itself sits above the superclass on the stack, so this has to wait
+    // until the class has been stored.
+    if (has_superclass) {
+      func_->end_scope();
+    }
+
+    class_type_ = class_type_old;
+  }
+
+
+  void Compiler::check_return(const Token& keyword, const bool has_value) const
+  {
+    if (func_->type() == FunctionType::None) {
+      error(keyword, "Cannot return from top-level code.");
+    }
+    if (func_->type() == FunctionType::Initialiser and has_value) {
+      error(keyword, "Cannot return a value from an initialiser.");
+    }
+  }
+
+
+  void Compiler::compile_return(const Token& keyword, const bool has_value)
+  {
+    if (func_->type() == FunctionType::Initialiser) {
+      compile_this_return();
+      return;
+    }
+    else if (not has_value) {
+      func_->add_instruction(Instruction::Nil);
+    }
+    else if (options_.tail_calls and
+             func_->last_instruction() == Instruction::Call) {
+      // Nothing is left to do in this function once the call has finished,
+      // so the callee can take over the current frame. Any jumps to the
+      // return below skip the call, so they're unaffected.
+      func_->rewrite_last_instruction(Instruction::TailCall);
+    }
+    func_->add_instruction(Instruction::Return);
+    func_->update_line_num_table(keyword);
+  }
+
+
+  void Compiler::compile_binary_op(const Token& op, const bool numeric)
+  {
+    // Operators known to have numeric operands use instructions that skip
+    // the runtime type checks, unless these are being verified.
+    if (numeric and options_.verify_types) {
+      func_->add_instruction(Instruction::AssertNumbers);
+      func_->add_integer<InstrArgUByte>(2);
+    }
+
+    switch (op.type()) {
+
+    case TokenType::Plus: {
+      func_->add_instruction(
+          numeric ? Instruction::AddNumbers : Instruction::Add);
+    }
+      break;
+
+    case TokenType::Minus: {
+      func_->add_instruction(
+          numeric ? Instruction::SubtractNumbers : Instruction::Subtract);
+    }
+      break;
+
+    case TokenType::Star: {
+      func_->add_instruction(
+          numeric ? Instruction::MultiplyNumbers : Instruction::Multiply);
+    }
+      break;
+
+    case TokenType::Slash: {
+      func_->add_instruction(
+          numeric ? Instruction::DivideNumbers : Instruction::Divide);
+    }
+      break;
+
+    case TokenType::Less: {
+      func_->add_instruction(
+          numeric ? Instruction::LessNumbers : Instruction::Less);
+    }
+      break;
+
+    case TokenType::LessEqual: {
+      func_->add_instruction(
+          numeric ? Instruction::GreaterNumbers : Instruction::Greater);
+      func_->add_instruction(Instruction::Not);
+    }
+      break;
+
+    case TokenType::Greater: {
+      func_->add_instruction(
+          numeric ? Instruction::GreaterNumbers : Instruction::Greater);
+    }
+      break;
+
+    case TokenType::GreaterEqual: {
+      func_->add_instruction(
+          numeric ? Instruction::LessNumbers : Instruction::Less);
+      func_->add_instruction(Instruction::Not);
+    }
+      break;
+
+    case TokenType::EqualEqual: {
+      func_->add_instruction(Instruction::Equal);
+    }
+      break;
+
+    case TokenType::BangEqual: {
+      func_->add_instruction(Instruction::Equal);
+      func_->add_instruction(Instruction::Not);
+    }
+      break;
+
+    default:
+      break;
+    }
+    func_->update_line_num_table(op);
+  }
+
+
+  void Compiler::compile_unary_op(const Token& op, const bool numeric)
+  {
+    if (op.type() == TokenType::Bang) {
+      func_->add_instruction(Instruction::Not);
+    }
+    else if (op.type() == TokenType::Minus) {
+      if (numeric and options_.verify_types) {
+        func_->add_instruction(Instruction::AssertNumbers);
+        func_->add_integer<InstrArgUByte>(1);
+      }
+      func_->add_instruction(
+          numeric ? Instruction::NegateNumber : Instruction::Negate);
+    }
+    func_->update_line_num_table(op);
+  }
+
+
+
+  void Compiler::compile_literal(const Value& value, const Symbol lexeme)
+  {
+    if (holds_alternative<bool>(value)) {
+      const Instruction instruction =
+          get<bool>(value) ? Instruction::True : Instruction::False;
+      func_->add_instruction(instruction);
+      return;
+    }
+    else if (value.index() == Value::npos) {
+      func_->add_instruction(Instruction::Nil);
+      return;
+    }
+
+    const auto index = func_->add_named_constant(lexeme, value);
+
+    func_->add_indexed_instruction(Instruction::LoadConstant, index);
+  }
+
+
+  void Compiler::compile_call(const Token& paren, const std::size_t num_args)
+  {
+    if (num_args > std::numeric_limits<InstrArgUByte>::max()) {
+      error(paren, "Too many arguments passed to function.");
+    }
+
+    func_->add_instruction(Instruction::Call);
+    func_->update_line_num_table(paren);
+    func_->add_integer(static_cast<InstrArgUByte>(num_args));
+  }
+
+
+  void Compiler::compile_invoke(const Token& name, const Token& paren,
+                                const std::size_t num_args)
+  {
+    if (num_args > std::numeric_limits<InstrArgUByte>::max()) {
+      error(paren, "Too many arguments passed to function.");
+    }
+
+    func_->add_indexed_instruction(
+        Instruction::Invoke, func_->add_string_constant(name.symbol()));
+    func_->update_line_num_table(paren);
+    func_->add_integer(static_cast<InstrArgUByte>(num_args));
+  }
+
+
+  void Compiler::compile_property_reference(const Token& name,
+                                            const bool write)
+  {
+    const auto name_constant = make_string_constant(name.symbol());
+    func_->add_indexed_instruction(
+        write ? Instruction::SetProperty : Instruction::GetProperty,
+        name_constant);
+    func_->update_line_num_table(name);
+  }
+
+
+  void Compiler::compile_super(const Token& keyword, const Token& method)
+  {
+    if (class_type_ == ClassType::Superclass) {
+      error(keyword,
+            "Cannot use 'super' in a class without a superclass.");
+    }
+    else if (class_type_ == ClassType::None) {
+      error(keyword, "Cannot use 'super' outside of a class.");
+    }
+
+    const auto this_token = Token(
+        TokenType::This, keyword_symbol(TokenType::This), keyword.line());
+    handle_variable_reference(this_token, false);
+    handle_variable_reference(keyword, false);
+
+    const auto func = make_string_constant(method.symbol());
+    func_->add_indexed_instruction(Instruction::GetSuperFunc, func);
+    func_->update_line_num_table(keyword);
+  }
+
+
+  void Compiler::compile_this(const Token& keyword)
+  {
+    if (class_type_ == ClassType::None) {
+      error(keyword, "Cannot use 'this' outside of a class.");
+    }
+    handle_variable_reference(keyword, false);
   }
 
 
   void Compiler::compile_this_return()
   {
-    const auto this_token = func_->make_token(TokenType::This, "this");
+    const auto this_token =
+        func_->make_token(TokenType::This, keyword_symbol(TokenType::This));
     handle_variable_reference(this_token, false);
     func_->add_instruction(Instruction::Return);
     func_->update_line_num_table(this_token);
   }
 
 
-  Optional<InstrArgUByte> Compiler::declare_variable(const Token& name)
+  Optional<InstrArgUShort> Compiler::declare_variable(const Token& name)
   {
-    const Optional<InstrArgUByte> arg =
+    const Optional<InstrArgUShort> arg =
         func_->scope_depth() == 0 ?
-        func_->add_string_constant(name.lexeme()) :
-        Optional<InstrArgUByte>();
+        func_->add_string_constant(name.symbol()) :
+        Optional<InstrArgUShort>();
 
     if (not arg) {
       func_->declare_local(name);
@@ -549,12 +972,11 @@ namespace loxx
   }
 
 
-  void Compiler::define_variable(const Optional<InstrArgUByte>& arg,
+  void Compiler::define_variable(const Optional<InstrArgUShort>& arg,
                                  const Token& name)
   {
     if (arg) {
-      func_->add_instruction(Instruction::DefineGlobal);
-      func_->add_integer<InstrArgUByte>(*arg);
+      func_->add_indexed_instruction(Instruction::DefineGlobal, *arg);
       func_->update_line_num_table(name);
     }
     else {
@@ -565,6 +987,14 @@ namespace loxx
 
   void Compiler::handle_variable_reference(const Token& token, const bool write)
   {
+    for (const auto& param : inlined_params_) {
+      if (param.first == token.symbol()) {
+        func_->add_indexed_instruction(Instruction::GetLocal, param.second);
+        func_->update_line_num_table(token);
+        return;
+      }
+    }
+
     auto arg = func_->resolve_local(token, false);
 
     Instruction op;
@@ -583,16 +1013,15 @@ namespace loxx
     }
 
     if (not arg) {
-      arg = make_string_constant(token.lexeme());
+      arg = make_string_constant(token.symbol());
     }
 
-    func_->add_instruction(op);
-    func_->add_integer<InstrArgUByte>(*arg);
+    func_->add_indexed_instruction(op, *arg);
     func_->update_line_num_table(token);
   }
 
 
-  InstrArgUByte Compiler::make_string_constant(const std::string& str) const
+  InstrArgUShort Compiler::make_string_constant(const Symbol str) const
   {
     return func_->add_string_constant(str);
   }
@@ -619,12 +1048,5 @@ namespace loxx
     {
       return var_expr.name;
     }
-
-
-    template <>
-    const Token& get_token(const This& var_expr)
-    {
-      return var_expr.keyword;
-    }
   }
 }
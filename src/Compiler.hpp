@@ -21,12 +21,18 @@
 #define LOXX_COMPILER_HPP
 
 #include <functional>
+#include <future>
 #include <limits>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "Expr.hpp"
 #include "FunctionScope.hpp"
+#include "Inliner.hpp"
 #include "Instruction.hpp"
 #include "Optional.hpp"
 #include "Stack.hpp"
@@ -41,19 +47,43 @@ namespace loxx
   }
 
 
+  class FuncObject;
+  class ThreadPool;
   class VirtualMachine;
 
 
+  struct CompilerOptions
+  {
+    // Print the bytecode of each code object once it's complete.
+    bool print_bytecode;
+    // Pass each code object through the peephole optimiser once complete.
+    bool optimise_bytecode;
+    // Use type inference to emit arithmetic without type checks where the
+    // operands are known to be numbers.
+    bool infer_types;
+    // Check the inferred types at runtime.
+    bool verify_types;
+    // Compile calls to small functions by splicing in the function's body.
+    bool inline_functions;
+    // Reuse the caller's frame for calls whose result is returned directly.
+    bool tail_calls;
+    // With more than one thread, the bodies of functions and methods
+    // declared at the top level are compiled concurrently.
+    unsigned int num_threads;
+  };
+
+
   class Compiler : public Expr::Visitor, public Stmt::Visitor
   {
   public:
-    explicit Compiler(const bool debug)
-        : debug_(debug), class_type_(ClassType::None),
-          func_(new FunctionScope(loxx::FunctionType::None))
+    explicit Compiler(const CompilerOptions& options)
+        : class_type_(ClassType::None),
+          func_(new FunctionScope(loxx::FunctionType::None)),
+          options_(options), num_temporaries_(0)
     {
     }
 
-    void compile(const std::vector<std::unique_ptr<Stmt>>& statements);
+    void compile(const ArenaList<Stmt*>& statements);
 
     void visit_assign_expr(const Assign& expr) override;
     void visit_binary_expr(const Binary& expr) override;
@@ -79,16 +109,56 @@ namespace loxx
     void visit_while_stmt(const While& stmt) override;
 
     const CodeObject& output() const { return func_->code_object(); }
-    std::unique_ptr<CodeObject> release_output()
-    { return func_->release_code_object(); }
+    std::unique_ptr<CodeObject> release_output();
 
-  private:
+  protected:
     enum class ClassType {
       Superclass,
       Subclass,
       None
     };
 
+    struct CompiledFunction
+    {
+      FuncObject* object;
+      std::vector<FunctionScope::Upvalue> upvalues;
+      std::vector<std::string> errors;
+    };
+
+    // Code generation primitives, shared by the visitor methods above and
+    // the SinglePassCompiler, which calls them directly as it parses.
+    void begin_function(const Token& name, const FunctionType type);
+    void compile_parameter(const Token& param);
+    void end_function(const Token& name, const unsigned int num_parameters);
+    CompiledFunction finish_function(const Token& name,
+                                     const unsigned int num_parameters);
+    void create_closure(const Token& name, const CompiledFunction& function);
+    FunctionType method_type(const Token& name) const;
+    ClassType begin_class(const bool has_superclass);
+    InstrArgUShort create_class(const Token& name, const bool has_superclass);
+    void create_method(const Token& name, const InstrArgUShort name_constant);
+    void end_class(const Token& name, const InstrArgUShort name_constant,
+                   const bool has_superclass, const ClassType class_type_old);
+    void check_return(const Token& keyword, const bool has_value) const;
+    void compile_return(const Token& keyword, const bool has_value);
+    void compile_binary_op(const Token& op, const bool numeric = false);
+    void compile_unary_op(const Token& op, const bool numeric = false);
+    void compile_literal(const Value& value, const Symbol lexeme);
+    void compile_call(const Token& paren, const std::size_t num_args);
+    void compile_invoke(const Token& name, const Token& paren,
+                        const std::size_t num_args);
+    void compile_property_reference(const Token& name, const bool write);
+    void compile_super(const Token& keyword, const Token& method);
+    void compile_this(const Token& keyword);
+    Optional<InstrArgUShort> declare_variable(const Token& name);
+    void define_variable(const Optional <InstrArgUShort>& arg, const Token& name);
+    void handle_variable_reference(const Token& token, const bool write);
+
+    ClassType class_type_;
+    std::unique_ptr<FunctionScope> func_;
+
+  private:
+
     class CompileError : public std::runtime_error
     {
     public:
@@ -102,22 +172,38 @@ namespace loxx
       Token name_;
     };
 
-    void compile_stmts(const std::vector<std::unique_ptr<Stmt>>& statements);
+    void compile_stmts(const ArenaList<Stmt*>& statements);
     void compile(const Expr& expr);
     void compile(const Stmt& stmt);
     void compile_function(const Function& stmt, const FunctionType type);
+    void submit_functions(const ArenaList<Stmt*>& statements, ThreadPool& pool);
+    static CompiledFunction compile_isolated_function(
+        const Function& stmt, const FunctionType type,
+        const ClassType class_type, const CompilerOptions& options,
+        std::shared_ptr<const Inliner> inliner);
+    bool can_inline(const Inliner::Target& target, const Call& call) const;
+    void compile_inline_call(const Inliner::Target& target, const Call& call);
+    bool has_numeric_operands(const Expr& expr) const;
+    void finish_code_object(const std::string& name,
+                            CodeObject& code_object) const;
     void compile_this_return();
-    Optional<InstrArgUByte> declare_variable(const Token& name);
-    void define_variable(const Optional <InstrArgUByte>& arg, const Token& name);
     template <typename T>
     void handle_variable_reference(const T& expr, const bool write);
-    void handle_variable_reference(const Token& token, const bool write);
-
-    inline InstrArgUByte make_string_constant(const std::string& str) const;
 
-    bool debug_;
-    ClassType class_type_;
-    std::unique_ptr<FunctionScope> func_;
+    inline InstrArgUShort make_string_constant(const Symbol str) const;
+    void add_index(const InstrArgUShort index, const bool wide);
+
+    CompilerOptions options_;
+    // Operators that type inference has shown to have numeric operands.
+    std::unordered_set<const Expr*> numeric_ops_;
+    std::shared_ptr<const Inliner> inliner_;
+    // Values pushed by enclosing expressions that are yet to be consumed,
+    // which sit on the stack above the locals.
+    std::size_t num_temporaries_;
+    // The stack slots holding the arguments of the call being inlined.
+    std::vector<std::pair<Symbol, InstrArgUShort>> inlined_params_;
+    std::unordered_map<const Function*, std::future<CompiledFunction>>
+        pending_functions_;
   };
 
 
@@ -20,9 +20,7 @@
 #ifndef LOXX_EXPR_HPP
 #define LOXX_EXPR_HPP
 
-#include <memory>
-#include <vector>
-
+#include "Arena.hpp"
 #include "globals.hpp"
 #include "Token.hpp"
 
@@ -43,10 +41,10 @@ namespace loxx
   struct Unary;
   struct Variable;
 
+  // Nodes are allocated in an Arena and are never destroyed individually, so
+  // there's no virtual destructor here.
   struct Expr
   {
-    virtual ~Expr() = default;
-
     class Visitor
     {
     public:
@@ -70,7 +68,7 @@ namespace loxx
 
   struct Assign : public Expr
   {
-    Assign(Token name_arg, std::unique_ptr<Expr> value_arg)
+    Assign(Token name_arg, Expr* value_arg)
         : name(std::move(name_arg)), value(std::move(value_arg))
     {}
 
@@ -78,70 +76,70 @@ namespace loxx
     { visitor.visit_assign_expr(*this); }
 
     Token name;
-    std::unique_ptr<Expr> value;
+    Expr* value;
   };
 
 
   struct Binary : public Expr
   {
-    Binary(std::unique_ptr<Expr> left_arg, Token op_arg, std::unique_ptr<Expr> right_arg)
+    Binary(Expr* left_arg, Token op_arg, Expr* right_arg)
         : left(std::move(left_arg)), op(std::move(op_arg)), right(std::move(right_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_binary_expr(*this); }
 
-    std::unique_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::unique_ptr<Expr> right;
+    Expr* right;
   };
 
 
   struct Call : public Expr
   {
-    Call(std::unique_ptr<Expr> callee_arg, Token paren_arg, std::vector<std::unique_ptr<Expr>> arguments_arg)
+    Call(Expr* callee_arg, Token paren_arg, ArenaList<Expr*> arguments_arg)
         : callee(std::move(callee_arg)), paren(std::move(paren_arg)), arguments(std::move(arguments_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_call_expr(*this); }
 
-    std::unique_ptr<Expr> callee;
+    Expr* callee;
     Token paren;
-    std::vector<std::unique_ptr<Expr>> arguments;
+    ArenaList<Expr*> arguments;
   };
 
 
   struct Get : public Expr
   {
-    Get(std::unique_ptr<Expr> object_arg, Token name_arg)
+    Get(Expr* object_arg, Token name_arg)
         : object(std::move(object_arg)), name(std::move(name_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_get_expr(*this); }
 
-    std::unique_ptr<Expr> object;
+    Expr* object;
     Token name;
   };
 
 
   struct Grouping : public Expr
   {
-    Grouping(std::unique_ptr<Expr> expression_arg)
+    Grouping(Expr* expression_arg)
         : expression(std::move(expression_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_grouping_expr(*this); }
 
-    std::unique_ptr<Expr> expression;
+    Expr* expression;
   };
 
 
   struct Literal : public Expr
   {
-    Literal(Value value_arg, std::string lexeme_arg)
+    Literal(Value value_arg, Symbol lexeme_arg)
         : value(std::move(value_arg)), lexeme(std::move(lexeme_arg))
     {}
 
@@ -149,37 +147,37 @@ namespace loxx
     { visitor.visit_literal_expr(*this); }
 
     Value value;
-    std::string lexeme;
+    Symbol lexeme;
   };
 
 
   struct Logical : public Expr
   {
-    Logical(std::unique_ptr<Expr> left_arg, Token op_arg, std::unique_ptr<Expr> right_arg)
+    Logical(Expr* left_arg, Token op_arg, Expr* right_arg)
         : left(std::move(left_arg)), op(std::move(op_arg)), right(std::move(right_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_logical_expr(*this); }
 
-    std::unique_ptr<Expr> left;
+    Expr* left;
     Token op;
-    std::unique_ptr<Expr> right;
+    Expr* right;
   };
 
 
   struct Set : public Expr
   {
-    Set(std::unique_ptr<Expr> object_arg, Token name_arg, std::unique_ptr<Expr> value_arg)
+    Set(Expr* object_arg, Token name_arg, Expr* value_arg)
         : object(std::move(object_arg)), name(std::move(name_arg)), value(std::move(value_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_set_expr(*this); }
 
-    std::unique_ptr<Expr> object;
+    Expr* object;
     Token name;
-    std::unique_ptr<Expr> value;
+    Expr* value;
   };
 
 
@@ -212,7 +210,7 @@ namespace loxx
 
   struct Unary : public Expr
   {
-    Unary(Token op_arg, std::unique_ptr<Expr> right_arg)
+    Unary(Token op_arg, Expr* right_arg)
         : op(std::move(op_arg)), right(std::move(right_arg))
     {}
 
@@ -220,7 +218,7 @@ namespace loxx
     { visitor.visit_unary_expr(*this); }
 
     Token op;
-    std::unique_ptr<Expr> right;
+    Expr* right;
   };
 
 
@@ -33,7 +33,7 @@ namespace loxx
       if (local.defined and local.depth < scope_depth_) {
         break;
       }
-      if (local.name == name.lexeme()) {
+      if (local.name == name.symbol()) {
         error(name, "Variable with this name already declared in this scope.");
       }
     }
@@ -50,30 +50,34 @@ namespace loxx
 
   void FunctionScope::add_local(const Token& name)
   {
-    locals_.push_back({false, false, 0, name.lexeme()});
+    if (locals_.size() == max_scope_locals) {
+      error(name, "Too many local variables in function.");
+    }
+
+    locals_.push_back({false, false, 0, name.symbol()});
   }
 
 
-  Optional<InstrArgUByte> FunctionScope::resolve_local(
+  Optional<InstrArgUShort> FunctionScope::resolve_local(
       const Token& name, const bool in_function) const
   {
     for (long int i = locals_.size() - 1; i >= 0; --i) {
-      if (locals_[i].name == name.lexeme()) {
+      if (locals_[i].name == name.symbol()) {
         if (not in_function and not locals_[i].defined) {
           error(name, "Cannot read local variable in its own initialiser.");
         }
-        return static_cast<InstrArgUByte>(i);
+        return static_cast<InstrArgUShort>(i);
       }
     }
-    return Optional<InstrArgUByte>();
+    return Optional<InstrArgUShort>();
   }
 
 
-  Optional <InstrArgUByte> FunctionScope::resolve_upvalue(const Token& name)
+  Optional <InstrArgUShort> FunctionScope::resolve_upvalue(const Token& name)
   {
     if (enclosing_ == nullptr) {
       // There is only one scope, so we're not going to find an upvalue
-      return Optional<InstrArgUByte>();
+      return Optional<InstrArgUShort>();
     }
 
     auto local = enclosing_->resolve_local(name, true);
@@ -88,30 +92,57 @@ namespace loxx
       return add_upvalue(*local, false);
     }
 
-    return Optional<InstrArgUByte>();
+    return Optional<InstrArgUShort>();
+  }
+
+
+  bool FunctionScope::resolves_to_global(const Token& name) const
+  {
+    for (auto scope = this; scope != nullptr; scope = scope->enclosing_.get()) {
+      if (scope->resolve_local(name, true)) {
+        return false;
+      }
+    }
+
+    return true;
   }
 
 
-  InstrArgUByte FunctionScope::add_upvalue(const InstrArgUByte index,
-                                          const bool is_local)
+  InstrArgUShort FunctionScope::add_upvalue(const InstrArgUShort index,
+                                           const bool is_local)
   {
-    for (InstrArgUByte i = 0; i < upvalues_.size(); ++i) {
+    for (std::size_t i = 0; i < upvalues_.size(); ++i) {
       if (upvalues_[i].index == index and upvalues_[i].is_local == is_local) {
-        return i;
+        return static_cast<InstrArgUShort>(i);
       }
     }
 
+    if (upvalues_.size() == max_scope_upvalues) {
+      error(last_line_num_, "Too many closure variables in function.");
+    }
+
     upvalues_.push_back(Upvalue{is_local, index});
-    return static_cast<InstrArgUByte>(upvalues_.size() - 1);
+    return static_cast<InstrArgUShort>(upvalues_.size() - 1);
+  }
+
+
+  std::size_t FunctionScope::num_local_slots() const
+  {
+    // A local whose initialiser is being compiled doesn't have a stack slot
+    // yet.
+    if (not locals_.empty() and not locals_.back().defined) {
+      return locals_.size() - 1;
+    }
+    return locals_.size();
   }
 
 
-  InstrArgUByte FunctionScope::add_named_constant(const std::string& lexeme,
-                                                 const Value& value)
+  InstrArgUShort FunctionScope::add_named_constant(const Symbol lexeme,
+                                                  const Value& value)
   {
-    const auto s = make_object<StringObject>(lexeme);
-    if (code_object_->constant_map.count(s) != 0) {
-      return code_object_->constant_map[s];
+    const auto& elem = constant_map_.get(lexeme);
+    if (elem) {
+      return elem->second;
     }
 
     if (code_object_->constants.size() == max_scope_constants) {
@@ -119,21 +150,27 @@ namespace loxx
     }
 
     const auto index =
-        static_cast<InstrArgUByte>(code_object_->constants.size());
+        static_cast<InstrArgUShort>(code_object_->constants.size());
 
     code_object_->constants.push_back(value);
-    code_object_->constant_map[s] = index;
+    constant_map_[lexeme] = index;
 
     return index;
   }
 
-  InstrArgUByte FunctionScope::add_string_constant(const std::string& str)
+  InstrArgUShort FunctionScope::add_string_constant(const Symbol str)
   {
-    const auto ptr = make_object<StringObject>(str);
+    const auto& elem = constant_map_.get(str);
+    if (elem) {
+      return elem->second;
+    }
+
+    const auto ptr =
+        make_object<StringObject>(SymbolTable::instance().lexeme(str));
     return add_named_constant(str, Value(InPlace<ObjectPtr>(), ptr));
   }
 
-  InstrArgUByte FunctionScope::add_constant(const Value& value)
+  InstrArgUShort FunctionScope::add_constant(const Value& value)
   {
     if (code_object_->constants.size() == max_scope_constants) {
       error(last_line_num_, "Too many constants in one scope.");
@@ -167,9 +204,9 @@ namespace loxx
 
 
   Token FunctionScope::make_token(const TokenType type,
-                                  std::string lexeme) const
+                                  const Symbol lexeme) const
   {
-    return Token(type, std::move(lexeme), last_line_num_);
+    return Token(type, lexeme, last_line_num_);
   }
 
 
@@ -199,10 +236,41 @@ namespace loxx
 
   void FunctionScope::add_instruction(const Instruction instruction)
   {
+    last_instr_pos_ = code_object_->bytecode.size();
     code_object_->bytecode.push_back(static_cast<std::uint8_t>(instruction));
   }
 
 
+  void FunctionScope::add_indexed_instruction(const Instruction instruction,
+                                              const InstrArgUShort index)
+  {
+    // Most indices fit in a single byte. Those that don't are encoded using
+    // a prefix that widens the instruction's index operands.
+    if (index > std::numeric_limits<InstrArgUByte>::max()) {
+      add_instruction(Instruction::Wide);
+      add_instruction(instruction);
+      add_integer(index);
+    }
+    else {
+      add_instruction(instruction);
+      add_integer(static_cast<InstrArgUByte>(index));
+    }
+  }
+
+
+  Instruction FunctionScope::last_instruction() const
+  {
+    return static_cast<Instruction>(code_object_->bytecode[last_instr_pos_]);
+  }
+
+
+  void FunctionScope::rewrite_last_instruction(const Instruction instruction)
+  {
+    code_object_->bytecode[last_instr_pos_] =
+        static_cast<std::uint8_t>(instruction);
+  }
+
+
   std::size_t FunctionScope::add_jump(const Instruction instruction)
   {
     add_instruction(instruction);
@@ -251,32 +319,9 @@ namespace loxx
     // different to the previous one, the difference in instruction and line is
     // encoded as one or more pairs of bytes.
 
-    int line_num_diff = token.line() - last_line_num_;
-    auto line_num_diff_abs = static_cast<unsigned int>(std::abs(line_num_diff));
-    std::size_t instr_num_diff =
-        code_object_->bytecode.size() - last_instr_num_;
-
-    const auto num_rows =
-        std::max(line_num_diff_abs / 128,
-                 static_cast<unsigned int>(instr_num_diff / 256));
-
-    if (num_rows > 0) {
-      const auto line_num_delta =
-          static_cast<std::int8_t>(line_num_diff / num_rows);
-      const auto instr_num_delta =
-          static_cast<std::int8_t>(instr_num_diff / num_rows);
-
-      for (unsigned int i = 0; i < num_rows; ++i) {
-        code_object_->line_num_table.emplace_back(
-            line_num_delta, instr_num_delta);
-      }
-
-      line_num_diff -= num_rows * line_num_delta;
-      instr_num_diff -= num_rows * instr_num_delta;
-    }
-
-    code_object_->line_num_table.emplace_back(
-        line_num_diff, instr_num_diff);
+    code_object_->add_line_num_row(
+        static_cast<int>(token.line()) - static_cast<int>(last_line_num_),
+        code_object_->bytecode.size() - last_instr_num_);
     last_instr_num_ = code_object_->bytecode.size();
     last_line_num_ = token.line();
   }
@@ -26,6 +26,7 @@
 
 #include "CodeObject.hpp"
 #include "globals.hpp"
+#include "HashTable.hpp"
 #include "Instruction.hpp"
 #include "Optional.hpp"
 #include "Token.hpp"
@@ -49,38 +50,45 @@ namespace loxx
     explicit FunctionScope(const FunctionType type,
                            std::unique_ptr<FunctionScope> enclosing = nullptr)
         : type_(type), last_line_num_(0), last_instr_num_(0),
+          last_instr_pos_(0),
           scope_depth_(enclosing == nullptr ? 0 : enclosing->scope_depth_ + 1),
           enclosing_(std::move(enclosing)), code_object_(new CodeObject)
     {
       if (type_ == FunctionType::Function) {
-        locals_.push_back(Local{false, false, 0, ""});
+        locals_.push_back(Local{true, false, 0, symbols::empty});
       }
     }
 
     void declare_local(const Token& name);
     void define_local();
     void add_local(const Token& name);
+    void capture_local(const InstrArgUShort index)
+    { locals_[index].is_upvalue = true; }
 
-    Optional<InstrArgUByte> resolve_local(
+    Optional<InstrArgUShort> resolve_local(
         const Token& name, const bool in_function) const;
-    Optional <InstrArgUByte> resolve_upvalue(const Token& name);
-    InstrArgUByte add_upvalue(const InstrArgUByte index, const bool is_local);
+    Optional <InstrArgUShort> resolve_upvalue(const Token& name);
+    bool resolves_to_global(const Token& name) const;
+    InstrArgUShort add_upvalue(const InstrArgUShort index, const bool is_local);
 
-    InstrArgUByte add_named_constant(const std::string& lexeme,
-                                    const Value& value);
-    InstrArgUByte add_string_constant(const std::string& str);
-    InstrArgUByte add_constant(const Value& value);
+    InstrArgUShort add_named_constant(const Symbol lexeme, const Value& value);
+    InstrArgUShort add_string_constant(const Symbol str);
+    InstrArgUShort add_constant(const Value& value);
 
     void begin_scope();
     void end_scope();
 
-    Token make_token(const TokenType type, std::string lexeme) const;
+    Token make_token(const TokenType type, const Symbol lexeme) const;
 
     std::unique_ptr<FunctionScope> release_enclosing();
     std::unique_ptr<CodeObject> release_code_object();
     std::vector<Upvalue> release_upvalues();
 
     void add_instruction(const Instruction instruction);
+    void add_indexed_instruction(const Instruction instruction,
+                                 const InstrArgUShort index);
+    Instruction last_instruction() const;
+    void rewrite_last_instruction(const Instruction instruction);
     template <typename T>
     void add_integer(const T integer);
     std::size_t add_jump(const Instruction instruction);
@@ -94,6 +102,7 @@ namespace loxx
     unsigned int scope_depth() const { return scope_depth_; }
     unsigned int last_line_num() const { return last_line_num_; }
     std::size_t num_upvalues() const { return upvalues_.size(); }
+    std::size_t num_local_slots() const;
     std::size_t current_bytecode_size() const
     { return code_object_->bytecode.size(); }
     const CodeObject& code_object() const { return *code_object_; }
@@ -103,22 +112,24 @@ namespace loxx
       bool defined;
       bool is_upvalue;
       std::size_t depth;
-      std::string name;
+      Symbol name;
     };
 
     struct Upvalue
     {
       bool is_local;
-      InstrArgUByte index;
+      InstrArgUShort index;
     };
 
   private:
     FunctionType type_;
     unsigned int last_line_num_;
     std::size_t last_instr_num_;
+    std::size_t last_instr_pos_;
     unsigned int scope_depth_;
     std::vector<Local> locals_;
     std::vector<Upvalue> upvalues_;
+    HashTable<Symbol, InstrArgUShort> constant_map_;
     std::unique_ptr<FunctionScope> enclosing_;
     std::unique_ptr<CodeObject> code_object_;
   };
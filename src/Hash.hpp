@@ -0,0 +1,168 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_HASH_HPP
+#define LOXX_HASH_HPP
+
+#include <cstdint>
+#include <cstring>
+
+
+namespace loxx
+{
+  // The seed is fixed so that hashes, and therefore the layout of hash tables,
+  // are the same on every platform and every run.
+  constexpr std::uint64_t default_hash_seed = 0x9e3779b97f4a7c15ull;
+
+
+  namespace detail
+  {
+    constexpr std::uint64_t hash_secret0 = 0x2d358dccaa6c78a5ull;
+    constexpr std::uint64_t hash_secret1 = 0x8bb84b93962eacc9ull;
+    constexpr std::uint64_t hash_secret2 = 0x4b33a62ed433d4a3ull;
+    constexpr std::uint64_t hash_secret3 = 0x4d5a2da51de1aa47ull;
+
+
+    // Replaces a and b with the low and high halves of their 128-bit product.
+    inline void multiply_wide(std::uint64_t& a, std::uint64_t& b)
+    {
+#ifdef __SIZEOF_INT128__
+      const auto product = static_cast<unsigned __int128>(a) * b;
+      a = static_cast<std::uint64_t>(product);
+      b = static_cast<std::uint64_t>(product >> 64);
+#else
+      const std::uint64_t a_high = a >> 32;
+      const std::uint64_t b_high = b >> 32;
+      const std::uint64_t a_low = static_cast<std::uint32_t>(a);
+      const std::uint64_t b_low = static_cast<std::uint32_t>(b);
+
+      const auto high = a_high * b_high;
+      const auto middle0 = a_high * b_low;
+      const auto middle1 = b_high * a_low;
+      const auto low = a_low * b_low;
+
+      const auto partial = low + (middle0 << 32);
+      std::uint64_t carry = partial < low;
+      const auto result_low = partial + (middle1 << 32);
+      carry += result_low < partial;
+
+      a = result_low;
+      b = high + (middle0 >> 32) + (middle1 >> 32) + carry;
+#endif
+    }
+
+
+    inline std::uint64_t mix(std::uint64_t a, std::uint64_t b)
+    {
+      multiply_wide(a, b);
+      return a ^ b;
+    }
+
+
+    inline std::uint64_t read_u64(const std::uint8_t* data)
+    {
+      std::uint64_t ret;
+      std::memcpy(&ret, data, sizeof(ret));
+      return ret;
+    }
+
+
+    inline std::uint64_t read_u32(const std::uint8_t* data)
+    {
+      std::uint32_t ret;
+      std::memcpy(&ret, data, sizeof(ret));
+      return ret;
+    }
+
+
+    // Packs one to three bytes into an integer.
+    inline std::uint64_t read_small(const std::uint8_t* data,
+                                    const std::size_t size)
+    {
+      return (static_cast<std::uint64_t>(data[0]) << 16) |
+             (static_cast<std::uint64_t>(data[size >> 1]) << 8) |
+             data[size - 1];
+    }
+  }
+
+
+  // This follows wyhash (final version 4). It's much faster than hashing a
+  // byte at a time, particularly for short keys such as identifiers, and
+  // doesn't depend on the standard library implementation.
+  inline std::uint64_t hash_bytes(const void* data, const std::size_t size,
+                                  std::uint64_t seed = default_hash_seed)
+  {
+    using namespace detail;
+
+    auto pos = static_cast<const std::uint8_t*>(data);
+    seed ^= mix(seed ^ hash_secret0, hash_secret1);
+
+    std::uint64_t a = 0;
+    std::uint64_t b = 0;
+
+    if (size <= 16) {
+      if (size >= 4) {
+        const auto offset = (size >> 3) << 2;
+        const auto end = pos + size - 4;
+        a = (read_u32(pos) << 32) | read_u32(pos + offset);
+        b = (read_u32(end) << 32) | read_u32(end - offset);
+      }
+      else if (size > 0) {
+        a = read_small(pos, size);
+      }
+    }
+    else {
+      auto remaining = size;
+
+      if (remaining >= 48) {
+        auto seed1 = seed;
+        auto seed2 = seed;
+
+        do {
+          seed = mix(read_u64(pos) ^ hash_secret1, read_u64(pos + 8) ^ seed);
+          seed1 = mix(read_u64(pos + 16) ^ hash_secret2,
+                      read_u64(pos + 24) ^ seed1);
+          seed2 = mix(read_u64(pos + 32) ^ hash_secret3,
+                      read_u64(pos + 40) ^ seed2);
+          pos += 48;
+          remaining -= 48;
+        } while (remaining >= 48);
+
+        seed ^= seed1 ^ seed2;
+      }
+
+      while (remaining > 16) {
+        seed = mix(read_u64(pos) ^ hash_secret1, read_u64(pos + 8) ^ seed);
+        pos += 16;
+        remaining -= 16;
+      }
+
+      a = read_u64(pos + remaining - 16);
+      b = read_u64(pos + remaining - 8);
+    }
+
+    a ^= hash_secret1;
+    b ^= seed;
+    multiply_wide(a, b);
+
+    return mix(a ^ hash_secret0 ^ size, b ^ hash_secret1);
+  }
+}
+
+#endif //LOXX_HASH_HPP
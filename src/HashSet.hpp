@@ -26,7 +26,7 @@
 
 #include "detail/HashStructIterator.hpp"
 #include "detail/HashImpl.hpp"
-#include "Optional.hpp"
+#include "detail/HashSlot.hpp"
 
 
 namespace loxx
@@ -36,26 +36,28 @@ namespace loxx
   class HashSet
       : private detail::HashImpl<
           Key,
-          Optional<Key>,
+          typename detail::SlotFor<Key, Key>::Type,
           HashSet<Key, Hash, Compare>>
   {
   friend class detail::HashImpl<
       Key,
-      Optional<Key>,
+      typename detail::SlotFor<Key, Key>::Type,
       HashSet<Key, Hash, Compare>>;
 
   public:
-    using Iter = detail::HashStructIterator<Key, Hash, Compare>;
-    using Elem = Optional<Key>;
+    using Elem = typename detail::SlotFor<Key, Key>::Type;
+    using Iter = detail::HashStructIterator<Key, Elem>;
 
     explicit HashSet()
         : num_used_slots_(0), max_used_slots_(detail::default_max_used_slots),
-          mask_(detail::default_size - 1), data_(detail::default_size)
+          mask_(detail::default_size - 1), max_probe_length_(0),
+          data_(detail::default_size)
     {}
     void insert(const Key& key);
     const Elem& get(const Key& key) const;
+    // Looks for an element with the given hash that satisfies the predicate.
     template <typename Fn>
-    const Elem& find(const Key& key, Fn evaluate) const;
+    const Elem& find(const std::size_t hash, Fn evaluate) const;
     void erase(const Key& key);
     std::size_t count(const Key& key) const;
     bool has_item(const Key& key) const;
@@ -63,6 +65,13 @@ namespace loxx
     std::size_t capacity() const { return data_.size(); }
     std::size_t size() const { return num_used_slots_; }
 
+    // The number of slots past its ideal position that a key ended up in,
+    // which shows how well the hash function spreads keys out. Keys that
+    // aren't in the set are reported as zero.
+    std::size_t probe_length(const Key& key) const
+    { return this->find_probe_length(*this, key); }
+    ProbeStats probe_stats() const { return this->compute_probe_stats(*this); }
+
     auto begin() -> Iter;
     auto end() -> Iter;
 
@@ -75,11 +84,18 @@ namespace loxx
     Hash hash_func_;
     Compare compare_;
     KeyExtractor key_extractor_;
-    std::size_t num_used_slots_, max_used_slots_, mask_;
+    std::size_t num_used_slots_, max_used_slots_, mask_, max_probe_length_;
     std::vector<Elem> data_;
+    // Returned by lookups for keys that aren't in the table.
+    static const Elem missing_;
   };
 
 
+  template <typename Key, typename Hash, typename Compare>
+  const typename HashSet<Key, Hash, Compare>::Elem
+      HashSet<Key, Hash, Compare>::missing_;
+
+
   template <typename Key, typename Hash, typename Compare>
   void HashSet<Key, Hash, Compare>::insert(const Key& key)
   {
@@ -87,10 +103,10 @@ namespace loxx
       this->rehash(*this);
     }
 
-    const auto pos = this->find_new_pos(*this, key, hash_func_(key));
+    const auto hash = hash_func_(key);
 
-    if (not data_[pos]) {
-      data_[pos] = key;
+    if (this->find_pos(*this, key, hash) == data_.size()) {
+      this->insert_at(*this, this->find_new_pos(*this, hash), key);
       ++num_used_slots_;
     }
   }
@@ -99,38 +115,35 @@ namespace loxx
   template <typename Key, typename Hash, typename Compare>
   auto HashSet<Key, Hash, Compare>::get(const Key& key) const -> const Elem&
   {
-    const auto found_pos = this->find_new_pos(*this, key, hash_func_(key));
-    return data_[found_pos];
+    return this->find_elem(*this, key, hash_func_(key));
   }
 
 
   template<typename Key, typename Hash, typename Compare>
   template<typename Fn>
   auto HashSet<Key, Hash, Compare>::find(
-      const Key& key, Fn evaluate) const -> const Elem&
+      const std::size_t hash, Fn evaluate) const -> const Elem&
   {
-    auto pos = hash_func_(key) & mask_;
+    auto pos = hash & mask_;
 
-    while (data_[pos]) {
+    for (std::size_t length = 0; data_[pos]; ++length) {
       if (evaluate(*data_[pos])) {
         return data_[pos];
       }
+      if (length == max_probe_length_) {
+        break;
+      }
       pos = (pos + 1) & mask_;
     }
 
-    return data_[pos];
+    return missing_;
   }
 
 
   template<typename Key, typename Hash, typename Compare>
   void HashSet<Key, Hash, Compare>::erase(const Key& key)
   {
-    using HashStruct = HashSet<Key, Hash, Compare>;
-    const auto add_func =
-        [] (HashStruct& obj, const Elem& new_elem) {
-          obj.insert(*new_elem);
-        };
-    this->remove(*this, key, add_func);
+    this->remove(*this, key);
   }
 
 
@@ -153,14 +166,15 @@ namespace loxx
   template <typename Key, typename Hash, typename Compare>
   auto HashSet<Key, Hash, Compare>::begin() -> HashSet::Iter
   {
-    return Iter(data_.begin(), data_.end());
+    return Iter(data_.data(), data_.data() + data_.size());
   }
 
 
   template <typename Key, typename Hash, typename Compare>
   auto HashSet<Key, Hash, Compare>::end() -> HashSet::Iter
   {
-    return Iter(data_.end(), data_.end());
+    const auto last = data_.data() + data_.size();
+    return Iter(last, last);
   }
 }
 
@@ -20,38 +20,51 @@
 #ifndef LOXX_HASHTABLE_HPP
 #define LOXX_HASHTABLE_HPP
 
+#include <array>
 #include <functional>
+#include <stdexcept>
 #include <utility>
 #include <vector>
 
 #include "detail/HashImpl.hpp"
+#include "detail/HashSlot.hpp"
 #include "detail/HashStructIterator.hpp"
-#include "Optional.hpp"
 
 
 namespace loxx
 {
+  // A table with a non-zero SmallSize starts out holding up to that many items
+  // in an inline array, which is scanned with the key comparison alone. Past
+  // that it moves them into a hashed array, which is never given back. Small
+  // tables don't allocate at all, which suits instance fields and methods.
+  // Their slots are packed rather than padded to a power of two, as the inline
+  // array is part of every object that has one, and it's scanned rather than
+  // indexed.
   template <typename Key, typename Value, typename Hash = std::hash<Key>,
-            typename Compare = std::equal_to<Key>>
+            typename Compare = std::equal_to<Key>,
+            std::size_t SmallSize = 0>
   class HashTable
     : private detail::HashImpl<
         Key,
-        Optional<std::pair<Key, Value>>,
-        HashTable<Key, Value, Hash, Compare>>
+        typename detail::SlotFor<
+            Key, std::pair<Key, Value>, (SmallSize > 0)>::Type,
+        HashTable<Key, Value, Hash, Compare, SmallSize>>
   {
     friend class detail::HashImpl<
         Key,
-        Optional<std::pair<Key, Value>>,
-        HashTable<Key, Value, Hash, Compare>>;
+        typename detail::SlotFor<
+            Key, std::pair<Key, Value>, (SmallSize > 0)>::Type,
+        HashTable<Key, Value, Hash, Compare, SmallSize>>;
 
   public:
     using Item = std::pair<Key, Value>;
-    using Elem = Optional<Item>;
-    using Iter = detail::HashStructIterator<Item, Hash, Compare>;
+    using Elem = typename detail::SlotFor<Key, Item, (SmallSize > 0)>::Type;
+    using Iter = detail::HashStructIterator<Item, Elem>;
 
     explicit HashTable()
         : num_used_slots_(0), max_used_slots_(detail::default_max_used_slots),
-          mask_(detail::default_size - 1), data_(detail::default_size)
+          mask_(detail::default_size - 1), max_probe_length_(0),
+          data_(SmallSize > 0 ? 0 : detail::default_size)
     {}
 
     Value& operator[](const Key& key);
@@ -61,13 +74,30 @@ namespace loxx
     std::size_t count(const Key& key) const;
     bool has_item(const Key& key) const;
 
-    std::size_t capacity() const { return data_.size(); }
+    std::size_t capacity() const
+    { return is_small() ? SmallSize : data_.size(); }
     std::size_t size() const { return num_used_slots_; }
 
+    // The number of slots past its ideal position that a key ended up in,
+    // which shows how well the hash function spreads keys out. Keys in a
+    // small table are all reported as being where they should be, and keys
+    // that aren't in the table are reported as zero.
+    std::size_t probe_length(const Key& key) const
+    { return is_small() ? 0 : this->find_probe_length(*this, key); }
+    ProbeStats probe_stats() const;
+
     auto begin() -> Iter;
     auto end() -> Iter;
 
   private:
+    // The hashed array is only allocated when the table outgrows the inline
+    // one, and this folds away in tables without an inline array.
+    bool is_small() const { return SmallSize > 0 and data_.empty(); }
+    // Returns the inline slot holding the key, or SmallSize if there isn't
+    // one.
+    std::size_t find_small_pos(const Key& key) const;
+    void leave_small_mode();
+
     struct KeyExtractor
     {
       const Key& operator()(const Elem& elem) const { return elem->first; }
@@ -76,32 +106,76 @@ namespace loxx
     Hash hash_func_;
     Compare compare_;
     KeyExtractor key_extractor_;
-    std::size_t num_used_slots_, max_used_slots_, mask_;
+    std::size_t num_used_slots_, max_used_slots_, mask_, max_probe_length_;
     std::vector<Elem> data_;
+    // Filled from the front, so the first num_used_slots_ slots are in use.
+    std::array<Elem, SmallSize> small_data_;
+    // Returned by lookups for keys that aren't in the table.
+    static const Elem missing_;
   };
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  Value& HashTable<Key, Value, Hash, Compare>::operator[](const Key& key)
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  const typename HashTable<Key, Value, Hash, Compare, SmallSize>::Elem
+      HashTable<Key, Value, Hash, Compare, SmallSize>::missing_;
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  Value& HashTable<Key, Value, Hash, Compare, SmallSize>::operator[](
+      const Key& key)
   {
+    if (is_small()) {
+      const auto small_pos = find_small_pos(key);
+
+      if (small_pos != SmallSize) {
+        return small_data_[small_pos]->second;
+      }
+
+      if (num_used_slots_ < SmallSize) {
+        small_data_[num_used_slots_] = std::make_pair(key, Value());
+        return small_data_[num_used_slots_++]->second;
+      }
+
+      leave_small_mode();
+    }
+
     if (num_used_slots_ >= max_used_slots_) {
       this->rehash(*this);
     }
 
-    const auto pos = this->find_new_pos(*this, key, hash_func_(key));
+    const auto hash = hash_func_(key);
+    const auto found_pos = this->find_pos(*this, key, hash);
 
-    if (not data_[pos]) {
-      data_[pos] = std::make_pair(key, Value());
-      ++num_used_slots_;
+    if (found_pos != data_.size()) {
+      return data_[found_pos]->second;
     }
 
+    const auto pos = this->find_new_pos(*this, hash);
+    this->insert_at(*this, pos, std::make_pair(key, Value()));
+    ++num_used_slots_;
+
     return data_[pos]->second;
   }
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  const Value& HashTable<Key, Value, Hash, Compare>::at(const Key& key) const
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  const Value& HashTable<Key, Value, Hash, Compare, SmallSize>::at(
+      const Key& key) const
   {
+    if (is_small()) {
+      const auto small_pos = find_small_pos(key);
+
+      if (small_pos == SmallSize) {
+        throw std::out_of_range(
+            "HashTable instance does not have supplied key!");
+      }
+
+      return small_data_[small_pos]->second;
+    }
+
     const auto found_pos = this->find_pos(*this, key, hash_func_(key));
 
     if (found_pos == data_.size()) {
@@ -112,54 +186,136 @@ namespace loxx
   }
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  auto HashTable<Key, Value, Hash, Compare>::get(const Key& key) const
-      -> const Elem&
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  auto HashTable<Key, Value, Hash, Compare, SmallSize>::get(
+      const Key& key) const -> const Elem&
   {
-    const auto found_pos = this->find_new_pos(*this, key, hash_func_(key));
-    return data_[found_pos];
+    if (is_small()) {
+      const auto small_pos = find_small_pos(key);
+      return small_pos != SmallSize ? small_data_[small_pos] : missing_;
+    }
+
+    return this->find_elem(*this, key, hash_func_(key));
   }
 
 
-  template<typename Key, typename Value, typename Hash, typename Compare>
-  void HashTable<Key, Value, Hash, Compare>::erase(const Key& key)
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  void HashTable<Key, Value, Hash, Compare, SmallSize>::erase(const Key& key)
   {
-    using HashStruct = HashTable<Key, Value, Hash, Compare>;
-    const auto add_func =
-        [] (HashStruct& obj, const Elem& new_elem) {
-          obj[new_elem->first] = new_elem->second;
-        };
-    this->remove(*this, key, add_func);
+    if (not is_small()) {
+      this->remove(*this, key);
+      return;
+    }
+
+    const auto small_pos = find_small_pos(key);
+
+    if (small_pos == SmallSize) {
+      return;
+    }
+
+    // Keep the slots in use at the front by moving the last one into the gap.
+    --num_used_slots_;
+    small_data_[small_pos] = std::move(small_data_[num_used_slots_]);
+    small_data_[num_used_slots_].reset();
   }
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  std::size_t HashTable<Key, Value, Hash, Compare>::count(const Key& key) const
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  std::size_t HashTable<Key, Value, Hash, Compare, SmallSize>::count(
+      const Key& key) const
   {
     return has_item(key) ? 1 : 0;
   }
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  bool HashTable<Key, Value, Hash, Compare>::has_item(const Key& key) const
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  bool HashTable<Key, Value, Hash, Compare, SmallSize>::has_item(
+      const Key& key) const
   {
+    if (is_small()) {
+      return find_small_pos(key) != SmallSize;
+    }
+
     const auto hash = hash_func_(key);
     const auto pos = this->find_pos(*this, key, hash);
     return pos != data_.size();
   }
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  auto HashTable<Key, Value, Hash, Compare>::begin() -> HashTable::Iter
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  auto HashTable<Key, Value, Hash, Compare, SmallSize>::probe_stats() const
+      -> ProbeStats
+  {
+    if (is_small()) {
+      return ProbeStats{num_used_slots_, 0, 0};
+    }
+
+    return this->compute_probe_stats(*this);
+  }
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  auto HashTable<Key, Value, Hash, Compare, SmallSize>::begin()
+      -> HashTable::Iter
+  {
+    const auto first = is_small() ? small_data_.data() : data_.data();
+    return Iter(first, first + capacity());
+  }
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  auto HashTable<Key, Value, Hash, Compare, SmallSize>::end()
+      -> HashTable::Iter
   {
-    return Iter(data_.begin(), data_.end());
+    const auto last =
+        (is_small() ? small_data_.data() : data_.data()) + capacity();
+    return Iter(last, last);
   }
 
 
-  template <typename Key, typename Value, typename Hash, typename Compare>
-  auto HashTable<Key, Value, Hash, Compare>::end() -> HashTable::Iter
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  std::size_t HashTable<Key, Value, Hash, Compare, SmallSize>::find_small_pos(
+      const Key& key) const
   {
-    return Iter(data_.end(), data_.end());
+    for (std::size_t pos = 0; pos < num_used_slots_; ++pos) {
+      if (compare_(small_data_[pos]->first, key)) {
+        return pos;
+      }
+    }
+
+    return SmallSize;
+  }
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare,
+            std::size_t SmallSize>
+  void HashTable<Key, Value, Hash, Compare, SmallSize>::leave_small_mode()
+  {
+    auto capacity = detail::default_size;
+    max_used_slots_ = detail::default_max_used_slots;
+
+    while (max_used_slots_ <= SmallSize) {
+      capacity *= detail::growth_factor;
+      max_used_slots_ *= detail::growth_factor;
+    }
+
+    mask_ = capacity - 1;
+    data_.resize(capacity);
+
+    for (std::size_t pos = 0; pos < num_used_slots_; ++pos) {
+      auto& elem = small_data_[pos];
+      const auto hash = hash_func_(elem->first);
+      this->insert_at(*this, this->find_new_pos(*this, hash), std::move(elem));
+      elem.reset();
+    }
   }
 }
 
@@ -0,0 +1,362 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <typeinfo>
+
+#include "Inliner.hpp"
+
+
+namespace loxx
+{
+  namespace
+  {
+    // Checks that an expression can be compiled in place of a call, and
+    // collects the globals it reads.
+    class ResultChecker : public Expr::Visitor
+    {
+    public:
+      ResultChecker(const ArenaList<Token>& parameters,
+                    std::vector<Token>& globals)
+          : inlinable_(true), parameters_(&parameters), globals_(&globals)
+      {}
+
+      bool check(const Expr& expr)
+      {
+        expr.accept(*this);
+        return inlinable_;
+      }
+
+      void visit_assign_expr(const Assign&) override { inlinable_ = false; }
+
+      void visit_binary_expr(const Binary& expr) override
+      {
+        expr.left->accept(*this);
+        expr.right->accept(*this);
+      }
+
+      void visit_call_expr(const Call&) override { inlinable_ = false; }
+
+      void visit_get_expr(const Get& expr) override
+      {
+        expr.object->accept(*this);
+      }
+
+      void visit_grouping_expr(const Grouping& expr) override
+      {
+        expr.expression->accept(*this);
+      }
+
+      void visit_literal_expr(const Literal&) override {}
+
+      void visit_logical_expr(const Logical& expr) override
+      {
+        expr.left->accept(*this);
+        expr.right->accept(*this);
+      }
+
+      void visit_set_expr(const Set&) override { inlinable_ = false; }
+      void visit_super_expr(const Super&) override { inlinable_ = false; }
+      void visit_this_expr(const This&) override { inlinable_ = false; }
+
+      void visit_unary_expr(const Unary& expr) override
+      {
+        expr.right->accept(*this);
+      }
+
+      void visit_variable_expr(const Variable& expr) override
+      {
+        for (const auto& param : *parameters_) {
+          if (param.symbol() == expr.name.symbol()) {
+            return;
+          }
+        }
+
+        globals_->push_back(expr.name);
+      }
+
+    private:
+      bool inlinable_;
+      const ArenaList<Token>* parameters_;
+      std::vector<Token>* globals_;
+    };
+  }
+
+
+  Inliner::Inliner(const ArenaList<Stmt*>& statements)
+      : statement_(0)
+  {
+    std::unordered_map<Symbol, std::size_t> num_declarations;
+
+    for (const auto stmt : statements) {
+      if (typeid(*stmt) == typeid(Function)) {
+        ++num_declarations[static_cast<const Function*>(stmt)->name.symbol()];
+      }
+      else if (typeid(*stmt) == typeid(Class)) {
+        ++num_declarations[static_cast<const Class*>(stmt)->name.symbol()];
+      }
+      else if (typeid(*stmt) == typeid(Var)) {
+        ++num_declarations[static_cast<const Var*>(stmt)->name.symbol()];
+      }
+    }
+
+    for (statement_ = 0; statement_ < statements.size(); ++statement_) {
+      find_calls(*statements[statement_]);
+    }
+
+    // Map each function that can be inlined to its index in targets_ and
+    // the position of its declaration.
+    std::unordered_map<Symbol, std::pair<std::size_t, std::size_t>> functions;
+
+    for (std::size_t i = 0; i < statements.size(); ++i) {
+      if (typeid(*statements[i]) != typeid(Function)) {
+        continue;
+      }
+
+      const auto& function = *static_cast<const Function*>(statements[i]);
+      const auto name = function.name.symbol();
+
+      if (num_declarations[name] != 1 or assigned_.count(name) != 0) {
+        continue;
+      }
+
+      Target target{&function, nullptr, {}};
+
+      if (make_target(function, target)) {
+        functions[name] = std::make_pair(targets_.size(), i);
+        targets_.push_back(std::move(target));
+      }
+    }
+
+    for (const auto& call_site : call_sites_) {
+      const auto function = functions.find(call_site.callee);
+
+      if (function == functions.end() or
+          call_site.statement <= function->second.second) {
+        continue;
+      }
+
+      const auto& target = targets_[function->second.first];
+
+      if (call_site.call->arguments.size() ==
+          target.function->parameters.size()) {
+        calls_[call_site.call] = function->second.first;
+      }
+    }
+  }
+
+
+  const Inliner::Target* Inliner::target(const Call& call) const
+  {
+    const auto elem = calls_.find(&call);
+    return elem != calls_.end() ? &targets_[elem->second] : nullptr;
+  }
+
+
+  void Inliner::visit_assign_expr(const Assign& expr)
+  {
+    assigned_.insert(expr.name.symbol());
+    find_calls(*expr.value);
+  }
+
+
+  void Inliner::visit_binary_expr(const Binary& expr)
+  {
+    find_calls(*expr.left);
+    find_calls(*expr.right);
+  }
+
+
+  void Inliner::visit_call_expr(const Call& expr)
+  {
+    if (typeid(*expr.callee) == typeid(Variable)) {
+      const auto& name = static_cast<const Variable*>(expr.callee)->name;
+      call_sites_.push_back(CallSite{&expr, name.symbol(), statement_});
+    }
+
+    find_calls(*expr.callee);
+
+    for (const auto argument : expr.arguments) {
+      find_calls(*argument);
+    }
+  }
+
+
+  void Inliner::visit_get_expr(const Get& expr)
+  {
+    find_calls(*expr.object);
+  }
+
+
+  void Inliner::visit_grouping_expr(const Grouping& expr)
+  {
+    find_calls(*expr.expression);
+  }
+
+
+  void Inliner::visit_literal_expr(const Literal&)
+  {
+  }
+
+
+  void Inliner::visit_logical_expr(const Logical& expr)
+  {
+    find_calls(*expr.left);
+    find_calls(*expr.right);
+  }
+
+
+  void Inliner::visit_set_expr(const Set& expr)
+  {
+    find_calls(*expr.object);
+    find_calls(*expr.value);
+  }
+
+
+  void Inliner::visit_super_expr(const Super&)
+  {
+  }
+
+
+  void Inliner::visit_this_expr(const This&)
+  {
+  }
+
+
+  void Inliner::visit_unary_expr(const Unary& expr)
+  {
+    find_calls(*expr.right);
+  }
+
+
+  void Inliner::visit_variable_expr(const Variable&)
+  {
+  }
+
+
+  void Inliner::visit_block_stmt(const Block& stmt)
+  {
+    find_calls(stmt.statements);
+  }
+
+
+  void Inliner::visit_class_stmt(const Class& stmt)
+  {
+    if (stmt.superclass != nullptr) {
+      find_calls(*stmt.superclass);
+    }
+
+    for (const auto method : stmt.methods) {
+      find_calls(method->body);
+    }
+  }
+
+
+  void Inliner::visit_expression_stmt(const Expression& stmt)
+  {
+    find_calls(*stmt.expression);
+  }
+
+
+  void Inliner::visit_function_stmt(const Function& stmt)
+  {
+    find_calls(stmt.body);
+  }
+
+
+  void Inliner::visit_if_stmt(const If& stmt)
+  {
+    find_calls(*stmt.condition);
+    find_calls(*stmt.then_branch);
+
+    if (stmt.else_branch != nullptr) {
+      find_calls(*stmt.else_branch);
+    }
+  }
+
+
+  void Inliner::visit_print_stmt(const Print& stmt)
+  {
+    find_calls(*stmt.expression);
+  }
+
+
+  void Inliner::visit_return_stmt(const Return& stmt)
+  {
+    if (stmt.value != nullptr) {
+      find_calls(*stmt.value);
+    }
+  }
+
+
+  void Inliner::visit_var_stmt(const Var& stmt)
+  {
+    if (stmt.initialiser != nullptr) {
+      find_calls(*stmt.initialiser);
+    }
+  }
+
+
+  void Inliner::visit_while_stmt(const While& stmt)
+  {
+    find_calls(*stmt.condition);
+    find_calls(*stmt.body);
+  }
+
+
+  void Inliner::find_calls(const Expr& expr)
+  {
+    expr.accept(*this);
+  }
+
+
+  void Inliner::find_calls(const Stmt& stmt)
+  {
+    stmt.accept(*this);
+  }
+
+
+  void Inliner::find_calls(const ArenaList<Stmt*>& statements)
+  {
+    for (const auto stmt : statements) {
+      find_calls(*stmt);
+    }
+  }
+
+
+  bool Inliner::make_target(const Function& function, Target& target)
+  {
+    if (function.body.empty()) {
+      return true;
+    }
+
+    if (function.body.size() != 1 or
+        typeid(*function.body[0]) != typeid(Return)) {
+      return false;
+    }
+
+    target.result = static_cast<const Return*>(function.body[0])->value;
+
+    if (target.result == nullptr) {
+      return true;
+    }
+
+    ResultChecker checker(function.parameters, target.globals);
+    return checker.check(*target.result);
+  }
+}
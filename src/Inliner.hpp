@@ -0,0 +1,107 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_INLINER_HPP
+#define LOXX_INLINER_HPP
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Stmt.hpp"
+
+
+namespace loxx
+{
+  // Finds calls to small functions that can be compiled directly into the
+  // caller instead of going through a call instruction and a new frame.
+  //
+  // A function qualifies if it's declared at the top level of the script and
+  // its body is empty or a single return statement whose value only uses
+  // literals, variables, property reads and operators. Such a body can't
+  // call anything, so inlining it never removes a frame that a deeper call
+  // would have needed. The function must also be the only top-level
+  // declaration with its name, and the name must never be assigned to, so
+  // that once the declaration has run the global always refers to it. Only
+  // calls inside top-level statements that follow the declaration are
+  // inlined, as none of that code can run before the declaration does.
+  class Inliner : private Expr::Visitor, private Stmt::Visitor
+  {
+  public:
+    struct Target
+    {
+      const Function* function;
+      // The value returned by the function, or nullptr if it returns nil.
+      const Expr* result;
+      // Globals read by the result, which must not be shadowed by locals
+      // where the call is made.
+      std::vector<Token> globals;
+    };
+
+    explicit Inliner(const ArenaList<Stmt*>& statements);
+
+    const Target* target(const Call& call) const;
+
+  private:
+    struct CallSite
+    {
+      const Call* call;
+      Symbol callee;
+      std::size_t statement;
+    };
+
+    void visit_assign_expr(const Assign& expr) override;
+    void visit_binary_expr(const Binary& expr) override;
+    void visit_call_expr(const Call& expr) override;
+    void visit_get_expr(const Get& expr) override;
+    void visit_grouping_expr(const Grouping& expr) override;
+    void visit_literal_expr(const Literal& expr) override;
+    void visit_logical_expr(const Logical& expr) override;
+    void visit_set_expr(const Set& expr) override;
+    void visit_super_expr(const Super& expr) override;
+    void visit_this_expr(const This& expr) override;
+    void visit_unary_expr(const Unary& expr) override;
+    void visit_variable_expr(const Variable& expr) override;
+
+    void visit_block_stmt(const Block& stmt) override;
+    void visit_class_stmt(const Class& stmt) override;
+    void visit_expression_stmt(const Expression& stmt) override;
+    void visit_function_stmt(const Function& stmt) override;
+    void visit_if_stmt(const If& stmt) override;
+    void visit_print_stmt(const Print& stmt) override;
+    void visit_return_stmt(const Return& stmt) override;
+    void visit_var_stmt(const Var& stmt) override;
+    void visit_while_stmt(const While& stmt) override;
+
+    void find_calls(const Expr& expr);
+    void find_calls(const Stmt& stmt);
+    void find_calls(const ArenaList<Stmt*>& statements);
+
+    static bool make_target(const Function& function, Target& target);
+
+    std::size_t statement_;
+    std::unordered_set<Symbol> assigned_;
+    std::vector<CallSite> call_sites_;
+
+    std::vector<Target> targets_;
+    std::unordered_map<const Call*, std::size_t> calls_;
+  };
+}
+
+#endif //LOXX_INLINER_HPP
@@ -28,6 +28,8 @@ namespace loxx
   enum class Instruction : std::uint8_t
   {
     Add,
+    AddNumbers,
+    AssertNumbers,
     Call,
     CloseUpvalue,
     ConditionalJump,
@@ -37,6 +39,7 @@ namespace loxx
     CreateSubclass,
     DefineGlobal,
     Divide,
+    DivideNumbers,
     Equal,
     False,
     GetGlobal,
@@ -45,13 +48,18 @@ namespace loxx
     GetSuperFunc,
     GetUpvalue,
     Greater,
+    GreaterNumbers,
     Invoke,
     Jump,
+    JumpIfTrue,
     Less,
+    LessNumbers,
     LoadConstant,
     Loop,
     Multiply,
+    MultiplyNumbers,
     Negate,
+    NegateNumber,
     Nil,
     Not,
     Pop,
@@ -63,7 +71,10 @@ namespace loxx
     SetProperty,
     SetUpvalue,
     Subtract,
-    True
+    SubtractNumbers,
+    TailCall,
+    True,
+    Wide
   };
 
 
@@ -74,6 +85,12 @@ namespace loxx
     case Instruction::Add:
       stream << "ADD";
       break;
+    case Instruction::AddNumbers:
+      stream << "ADD_NUMBERS";
+      break;
+    case Instruction::AssertNumbers:
+      stream << "ASSERT_NUMBERS";
+      break;
     case Instruction::Call:
       stream << "CALL";
       break;
@@ -101,6 +118,9 @@ namespace loxx
     case Instruction::Divide:
       stream << "DIVIDE";
       break;
+    case Instruction::DivideNumbers:
+      stream << "DIVIDE_NUMBERS";
+      break;
     case Instruction::Equal:
       stream << "EQUAL";
       break;
@@ -125,15 +145,24 @@ namespace loxx
     case Instruction::Greater:
       stream << "GREATER";
       break;
+    case Instruction::GreaterNumbers:
+      stream << "GREATER_NUMBERS";
+      break;
     case Instruction::Invoke:
       stream << "INVOKE";
       break;
     case Instruction::Jump:
       stream << "JUMP";
       break;
+    case Instruction::JumpIfTrue:
+      stream << "JUMP_IF_TRUE";
+      break;
     case Instruction::Less:
       stream << "LESS";
       break;
+    case Instruction::LessNumbers:
+      stream << "LESS_NUMBERS";
+      break;
     case Instruction::LoadConstant:
       stream << "LOAD_CONST";
       break;
@@ -143,9 +172,15 @@ namespace loxx
     case Instruction::Multiply:
       stream << "MULTIPLY";
       break;
+    case Instruction::MultiplyNumbers:
+      stream << "MULTIPLY_NUMBERS";
+      break;
     case Instruction::Negate:
       stream << "NEGATE";
       break;
+    case Instruction::NegateNumber:
+      stream << "NEGATE_NUMBER";
+      break;
     case Instruction::Nil:
       stream << "NIL";
       break;
@@ -179,9 +214,18 @@ namespace loxx
     case Instruction::Subtract:
       stream << "SUBTRACT";
       break;
+    case Instruction::SubtractNumbers:
+      stream << "SUBTRACT_NUMBERS";
+      break;
+    case Instruction::TailCall:
+      stream << "TAIL_CALL";
+      break;
     case Instruction::True:
       stream << "TRUE";
       break;
+    case Instruction::Wide:
+      stream << "WIDE";
+      break;
     }
 
     return stream;
@@ -0,0 +1,491 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "NumberFormat.hpp"
+
+
+namespace loxx
+{
+  namespace
+  {
+    // The digits are found with Grisu3 (Florian Loitsch, "Printing
+    // Floating-Point Numbers Quickly and Accurately with Integers", PLDI
+    // 2010). It works in 64-bit integer arithmetic and can tell when it might
+    // not have found the shortest digits, which is very rare. In that case the
+    // digits come from printf instead.
+
+    // A floating point number with a 64-bit significand, f * 2^e.
+    struct DiyFp
+    {
+      std::uint64_t f;
+      int e;
+    };
+
+
+    DiyFp operator-(const DiyFp& first, const DiyFp& second)
+    {
+      return {first.f - second.f, first.e};
+    }
+
+
+    // The product of the two significands, rounded to its top 64 bits.
+    DiyFp operator*(const DiyFp& first, const DiyFp& second)
+    {
+      constexpr std::uint64_t mask = 0xffffffff;
+
+      const auto a = first.f >> 32;
+      const auto b = first.f & mask;
+      const auto c = second.f >> 32;
+      const auto d = second.f & mask;
+
+      const auto ac = a * c;
+      const auto bc = b * c;
+      const auto ad = a * d;
+      const auto bd = b * d;
+
+      const auto middle =
+          (bd >> 32) + (ad & mask) + (bc & mask) + (std::uint64_t(1) << 31);
+
+      return {ac + (ad >> 32) + (bc >> 32) + (middle >> 32),
+              first.e + second.e + 64};
+    }
+
+
+    DiyFp normalise(DiyFp value)
+    {
+      while ((value.f & (std::uint64_t(1) << 63)) == 0) {
+        value.f <<= 1;
+        --value.e;
+      }
+
+      return value;
+    }
+
+
+    constexpr int significand_bits = 52;
+    constexpr int exponent_bias = 1075;
+    constexpr std::uint64_t hidden_bit = std::uint64_t(1) << significand_bits;
+
+
+    struct Boundaries
+    {
+      DiyFp value, lower, upper;
+    };
+
+
+    // Finds the number along with the points halfway to its neighbours,
+    // between which every number reads back as this one. All three share the
+    // exponent of the upper boundary.
+    Boundaries find_boundaries(const double number)
+    {
+      std::uint64_t bits;
+      std::memcpy(&bits, &number, sizeof(double));
+
+      const auto biased_exponent = static_cast<int>(bits >> significand_bits);
+      const auto fraction = bits & (hidden_bit - 1);
+
+      const DiyFp value = biased_exponent == 0 ?
+          DiyFp{fraction, 1 - exponent_bias} :
+          DiyFp{fraction + hidden_bit, biased_exponent - exponent_bias};
+
+      // The gap to the number below a power of two is half the gap to the
+      // one above it.
+      const bool lower_is_closer = fraction == 0 and biased_exponent > 1;
+
+      const auto upper = normalise({(value.f << 1) + 1, value.e - 1});
+      auto lower = lower_is_closer ?
+          DiyFp{(value.f << 2) - 1, value.e - 2} :
+          DiyFp{(value.f << 1) - 1, value.e - 1};
+      lower.f <<= lower.e - upper.e;
+      lower.e = upper.e;
+
+      return {normalise(value), lower, upper};
+    }
+
+
+    struct CachedPower
+    {
+      std::uint64_t f;
+      int e;
+      int k;
+    };
+
+
+    // Normalised approximations of 10^k, for k from -300 to 324 in steps of
+    // eight.
+    constexpr int cached_powers_min_k = -300;
+    constexpr int cached_powers_step = 8;
+
+    constexpr CachedPower cached_powers[] = {
+        {0xAB70FE17C79AC6CA, -1060, -300},
+        {0xFF77B1FCBEBCDC4F, -1034, -292},
+        {0xBE5691EF416BD60C, -1007, -284},
+        {0x8DD01FAD907FFC3C, -980, -276},
+        {0xD3515C2831559A83, -954, -268},
+        {0x9D71AC8FADA6C9B5, -927, -260},
+        {0xEA9C227723EE8BCB, -901, -252},
+        {0xAECC49914078536D, -874, -244},
+        {0x823C12795DB6CE57, -847, -236},
+        {0xC21094364DFB5637, -821, -228},
+        {0x9096EA6F3848984F, -794, -220},
+        {0xD77485CB25823AC7, -768, -212},
+        {0xA086CFCD97BF97F4, -741, -204},
+        {0xEF340A98172AACE5, -715, -196},
+        {0xB23867FB2A35B28E, -688, -188},
+        {0x84C8D4DFD2C63F3B, -661, -180},
+        {0xC5DD44271AD3CDBA, -635, -172},
+        {0x936B9FCEBB25C996, -608, -164},
+        {0xDBAC6C247D62A584, -582, -156},
+        {0xA3AB66580D5FDAF6, -555, -148},
+        {0xF3E2F893DEC3F126, -529, -140},
+        {0xB5B5ADA8AAFF80B8, -502, -132},
+        {0x87625F056C7C4A8B, -475, -124},
+        {0xC9BCFF6034C13053, -449, -116},
+        {0x964E858C91BA2655, -422, -108},
+        {0xDFF9772470297EBD, -396, -100},
+        {0xA6DFBD9FB8E5B88F, -369, -92},
+        {0xF8A95FCF88747D94, -343, -84},
+        {0xB94470938FA89BCF, -316, -76},
+        {0x8A08F0F8BF0F156B, -289, -68},
+        {0xCDB02555653131B6, -263, -60},
+        {0x993FE2C6D07B7FAC, -236, -52},
+        {0xE45C10C42A2B3B06, -210, -44},
+        {0xAA242499697392D3, -183, -36},
+        {0xFD87B5F28300CA0E, -157, -28},
+        {0xBCE5086492111AEB, -130, -20},
+        {0x8CBCCC096F5088CC, -103, -12},
+        {0xD1B71758E219652C, -77, -4},
+        {0x9C40000000000000, -50, 4},
+        {0xE8D4A51000000000, -24, 12},
+        {0xAD78EBC5AC620000, 3, 20},
+        {0x813F3978F8940984, 30, 28},
+        {0xC097CE7BC90715B3, 56, 36},
+        {0x8F7E32CE7BEA5C70, 83, 44},
+        {0xD5D238A4ABE98068, 109, 52},
+        {0x9F4F2726179A2245, 136, 60},
+        {0xED63A231D4C4FB27, 162, 68},
+        {0xB0DE65388CC8ADA8, 189, 76},
+        {0x83C7088E1AAB65DB, 216, 84},
+        {0xC45D1DF942711D9A, 242, 92},
+        {0x924D692CA61BE758, 269, 100},
+        {0xDA01EE641A708DEA, 295, 108},
+        {0xA26DA3999AEF774A, 322, 116},
+        {0xF209787BB47D6B85, 348, 124},
+        {0xB454E4A179DD1877, 375, 132},
+        {0x865B86925B9BC5C2, 402, 140},
+        {0xC83553C5C8965D3D, 428, 148},
+        {0x952AB45CFA97A0B3, 455, 156},
+        {0xDE469FBD99A05FE3, 481, 164},
+        {0xA59BC234DB398C25, 508, 172},
+        {0xF6C69A72A3989F5C, 534, 180},
+        {0xB7DCBF5354E9BECE, 561, 188},
+        {0x88FCF317F22241E2, 588, 196},
+        {0xCC20CE9BD35C78A5, 614, 204},
+        {0x98165AF37B2153DF, 641, 212},
+        {0xE2A0B5DC971F303A, 667, 220},
+        {0xA8D9D1535CE3B396, 694, 228},
+        {0xFB9B7CD9A4A7443C, 720, 236},
+        {0xBB764C4CA7A44410, 747, 244},
+        {0x8BAB8EEFB6409C1A, 774, 252},
+        {0xD01FEF10A657842C, 800, 260},
+        {0x9B10A4E5E9913129, 827, 268},
+        {0xE7109BFBA19C0C9D, 853, 276},
+        {0xAC2820D9623BF429, 880, 284},
+        {0x80444B5E7AA7CF85, 907, 292},
+        {0xBF21E44003ACDD2D, 933, 300},
+        {0x8E679C2F5E44FF8F, 960, 308},
+        {0xD433179D9C8CB841, 986, 316},
+        {0x9E19DB92B4E31BA9, 1013, 324},    };
+
+
+    // Scaling by the cached power brings the binary exponent of the product
+    // into this range, so that its integral part fits into 32 bits.
+    constexpr int min_target_exponent = -60;
+    constexpr int max_target_exponent = -32;
+
+
+    // Returns the cached power c such that c * 2^e has an exponent in the
+    // target range.
+    const CachedPower& find_cached_power(const int e)
+    {
+      // 78913 / 2^18 is just above log10(2).
+      const auto f = min_target_exponent - e - 1;
+      const auto k = (f * 78913) / (1 << 18) + (f > 0 ? 1 : 0);
+      const auto index = (k - cached_powers_min_k + cached_powers_step - 1) /
+                         cached_powers_step;
+
+      return cached_powers[index];
+    }
+
+
+    // Returns the number of decimal digits in the number, setting power to
+    // ten to the power of one less than that.
+    int count_digits(const std::uint32_t number, std::uint32_t& power)
+    {
+      int digits = 1;
+      power = 1;
+
+      while (digits < 10 and number / power >= 10) {
+        power *= 10;
+        ++digits;
+      }
+
+      return digits;
+    }
+
+
+    // Moves the last digit towards the number while the digits stay within
+    // the boundaries, then checks they're the closest shortest digits.
+    // Everything is scaled by 2^-e, where e is the exponent of the boundaries.
+    // unit is the error in the scaled boundaries, distance is from the digits
+    // at the upper boundary to the number, rest is from the digits to the
+    // upper boundary and ten_kappa is the size of a step in the last digit.
+    bool round_weed(char* digits, const int length,
+                    const std::uint64_t distance,
+                    const std::uint64_t unsafe_interval, std::uint64_t rest,
+                    const std::uint64_t ten_kappa, const std::uint64_t unit)
+    {
+      const auto small_distance = distance - unit;
+      const auto big_distance = distance + unit;
+
+      while (rest < small_distance and unsafe_interval - rest >= ten_kappa and
+             (rest + ten_kappa < small_distance or
+              small_distance - rest >= rest + ten_kappa - small_distance)) {
+        --digits[length - 1];
+        rest += ten_kappa;
+      }
+
+      // If stepping once more might have been closer given the error, the
+      // result can't be trusted.
+      if (rest < big_distance and unsafe_interval - rest >= ten_kappa and
+          (rest + ten_kappa < big_distance or
+           big_distance - rest > rest + ten_kappa - big_distance)) {
+        return false;
+      }
+
+      return 2 * unit <= rest and rest <= unsafe_interval - 4 * unit;
+    }
+
+
+    // Writes the digits of the shortest decimal between the scaled
+    // boundaries, setting kappa to the power of ten of the last digit. Returns
+    // false if the digits can't be trusted.
+    bool generate_digits(const DiyFp& lower, const DiyFp& value,
+                         const DiyFp& upper, char* digits, int& length,
+                         int& kappa)
+    {
+      // The scaled boundaries are out by up to one unit each way, so widen
+      // them by that to be sure nothing in between is missed.
+      std::uint64_t unit = 1;
+      const DiyFp too_low{lower.f - unit, lower.e};
+      const DiyFp too_high{upper.f + unit, upper.e};
+      auto unsafe_interval = (too_high - too_low).f;
+
+      const auto shift = -value.e;
+      const auto one = std::uint64_t(1) << shift;
+      auto integrals = static_cast<std::uint32_t>(too_high.f >> shift);
+      auto fractionals = too_high.f & (one - 1);
+
+      std::uint32_t divisor;
+      kappa = count_digits(integrals, divisor);
+      length = 0;
+
+      while (kappa > 0) {
+        digits[length++] = static_cast<char>('0' + integrals / divisor);
+        integrals %= divisor;
+        --kappa;
+
+        const auto rest =
+            (static_cast<std::uint64_t>(integrals) << shift) + fractionals;
+
+        if (rest < unsafe_interval) {
+          return round_weed(digits, length, (too_high - value).f,
+                            unsafe_interval, rest,
+                            static_cast<std::uint64_t>(divisor) << shift, unit);
+        }
+
+        divisor /= 10;
+      }
+
+      while (true) {
+        fractionals *= 10;
+        unit *= 10;
+        unsafe_interval *= 10;
+
+        digits[length++] = static_cast<char>('0' + (fractionals >> shift));
+        fractionals &= one - 1;
+        --kappa;
+
+        if (fractionals < unsafe_interval) {
+          return round_weed(digits, length, (too_high - value).f * unit,
+                            unsafe_interval, fractionals, one, unit);
+        }
+      }
+    }
+
+
+    // Finds the shortest digits of a positive finite number, setting exponent
+    // so that the number is digits * 10^exponent. Returns false if Grisu3 gave
+    // up.
+    bool grisu3(const double number, char* digits, int& length, int& exponent)
+    {
+      const auto boundaries = find_boundaries(number);
+      const auto& power = find_cached_power(boundaries.upper.e);
+      const DiyFp scale{power.f, power.e};
+
+      int kappa;
+      const bool found = generate_digits(
+          boundaries.lower * scale, boundaries.value * scale,
+          boundaries.upper * scale, digits, length, kappa);
+
+      exponent = kappa - power.k;
+      return found;
+    }
+
+
+    // Tries printf with increasing precision until the number reads back.
+    void find_digits_with_printf(const double number, char* digits,
+                                 int& length, int& exponent)
+    {
+      char buffer[max_number_length];
+
+      for (int precision = 1; precision <= 17; ++precision) {
+        std::snprintf(buffer, sizeof(buffer), "%.*e", precision - 1, number);
+
+        if (std::strtod(buffer, nullptr) == number or precision == 17) {
+          break;
+        }
+      }
+
+      // The buffer holds d[.ddd]e[+-]xx.
+      length = 0;
+      const char* pos = buffer;
+
+      for (; *pos != 'e'; ++pos) {
+        if (*pos != '.') {
+          digits[length++] = *pos;
+        }
+      }
+
+      exponent = std::atoi(pos + 1) - (length - 1);
+    }
+
+
+    char* write_exponent(char* pos, const int exponent)
+    {
+      *pos++ = 'e';
+      *pos++ = exponent < 0 ? '-' : '+';
+
+      auto magnitude = exponent < 0 ? -exponent : exponent;
+      char reversed[4];
+      int count = 0;
+
+      do {
+        reversed[count++] = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+      } while (magnitude > 0);
+
+      while (count > 0) {
+        *pos++ = reversed[--count];
+      }
+
+      return pos;
+    }
+  }
+
+
+  std::size_t format_number(const double value, char* buffer)
+  {
+    char* pos = buffer;
+
+    if (std::isnan(value)) {
+      std::memcpy(pos, "nan", 3);
+      return 3;
+    }
+
+    if (std::signbit(value)) {
+      *pos++ = '-';
+    }
+
+    if (std::isinf(value)) {
+      std::memcpy(pos, "inf", 3);
+      return static_cast<std::size_t>(pos - buffer) + 3;
+    }
+
+    if (value == 0.0) {
+      *pos++ = '0';
+      return static_cast<std::size_t>(pos - buffer);
+    }
+
+    char digits[17];
+    int length;
+    int exponent;
+
+    const auto magnitude = std::fabs(value);
+
+    if (not grisu3(magnitude, digits, length, exponent)) {
+      find_digits_with_printf(magnitude, digits, length, exponent);
+    }
+
+    // The number is 0.digits * 10^point.
+    const auto point = length + exponent;
+
+    if (length <= point and point <= 21) {
+      std::memcpy(pos, digits, static_cast<std::size_t>(length));
+      pos += length;
+      std::memset(pos, '0', static_cast<std::size_t>(point - length));
+      pos += point - length;
+    }
+    else if (0 < point and point <= 21) {
+      std::memcpy(pos, digits, static_cast<std::size_t>(point));
+      pos += point;
+      *pos++ = '.';
+      const auto remaining = length - point;
+      std::memcpy(pos, digits + point, static_cast<std::size_t>(remaining));
+      pos += remaining;
+    }
+    else if (-6 < point and point <= 0) {
+      *pos++ = '0';
+      *pos++ = '.';
+      std::memset(pos, '0', static_cast<std::size_t>(-point));
+      pos += -point;
+      std::memcpy(pos, digits, static_cast<std::size_t>(length));
+      pos += length;
+    }
+    else {
+      *pos++ = digits[0];
+
+      if (length > 1) {
+        *pos++ = '.';
+        std::memcpy(pos, digits + 1, static_cast<std::size_t>(length - 1));
+        pos += length - 1;
+      }
+
+      pos = write_exponent(pos, point - 1);
+    }
+
+    return static_cast<std::size_t>(pos - buffer);
+  }
+}
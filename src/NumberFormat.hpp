@@ -0,0 +1,42 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_NUMBERFORMAT_HPP
+#define LOXX_NUMBERFORMAT_HPP
+
+#include <cstddef>
+
+
+namespace loxx
+{
+  // Enough for a sign, seventeen digits, a point, the zeros before the digits
+  // of a small number and an exponent.
+  constexpr std::size_t max_number_length = 32;
+
+
+  // Writes the shortest decimal that reads back as the given number into the
+  // buffer, which must hold at least max_number_length characters, and
+  // returns the number of characters written. Integers below 10^21 are
+  // written out in full, and numbers below 10^-6 or from 10^21 up use an
+  // exponent, as in 1e+21 or 2.5e-7. Infinities and NaNs are written as inf,
+  // -inf and nan.
+  std::size_t format_number(const double value, char* buffer);
+}
+
+#endif //LOXX_NUMBERFORMAT_HPP
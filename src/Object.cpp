@@ -17,6 +17,11 @@
  * Created by Matt Spraggs on 18/04/18.
  */
 
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
 #include "CodeObject.hpp"
 #include "ObjectTracker.hpp"
 #include "Object.hpp"
@@ -26,7 +31,7 @@ namespace loxx
 {
   FuncObject::FuncObject(
       std::string lexeme, std::unique_ptr<CodeObject> code_object,
-      const unsigned int arity, const InstrArgUByte num_upvalues)
+      const unsigned int arity, const unsigned int num_upvalues)
       : Object(ObjectType::Function),
         arity_(arity), num_upvalues_(num_upvalues),
         code_object_(std::move(code_object)), lexeme_(std::move(lexeme))
@@ -34,6 +39,22 @@ namespace loxx
   }
 
 
+  void FuncObject::grey_constants() const
+  {
+    for (const auto& constant : code_object_->constants) {
+      if (holds_alternative<ObjectPtr>(constant)) {
+        get<ObjectPtr>(constant)->set_colour(TriColour::Grey);
+      }
+    }
+  }
+
+
+  void FuncObject::grey_references()
+  {
+    grey_constants();
+  }
+
+
   void UpvalueObject::grey_references()
   {
     if (holds_alternative<ObjectPtr>(*value_)) {
@@ -72,7 +93,7 @@ namespace loxx
 
 
   auto ClassObject::method(StringObject* name) const
-      -> const StringHashTable<ClosureObject*>::Elem&
+      -> const MethodTable::Elem&
   {
     const auto& elem = methods_.get(name);
     if (elem) {
@@ -120,4 +141,163 @@ namespace loxx
       obj->set_colour(TriColour::Grey);
     }
   }
+
+
+  std::unique_ptr<StringObject> StringObject::make_interned(
+      const char* data, const std::size_t size, const std::size_t hash)
+  {
+    const auto memory = ::operator new(sizeof(StringObject) + size);
+    std::unique_ptr<StringObject> ret(
+        new (memory) StringObject(true, size, hash));
+    std::memcpy(reinterpret_cast<char*>(ret.get() + 1), data, size);
+    return ret;
+  }
+
+
+  std::string StringObject::as_std_string() const
+  {
+    return std::string(data(), size_);
+  }
+
+
+  void StringObject::append_to(std::string& buffer) const
+  {
+    for_each_piece(
+        [&] (const char* data, const std::size_t size) {
+          buffer.append(data, size);
+        });
+  }
+
+
+  bool StringObject::compare_characters(const StringObject& other) const
+  {
+    return std::memcmp(data(), other.data(), size_) == 0;
+  }
+
+
+  template <typename Fn>
+  void StringObject::for_each_piece(Fn fn) const
+  {
+    std::vector<const StringObject*> pending{this};
+
+    while (not pending.empty()) {
+      const auto str = pending.back();
+      pending.pop_back();
+
+      if (str->is_interned()) {
+        fn(str->data(), str->size_);
+        continue;
+      }
+
+      const auto rope = static_cast<const RopeObject*>(str);
+
+      if (rope->is_flat()) {
+        fn(rope->data_, str->size_);
+      }
+      else {
+        pending.push_back(rope->right_);
+        pending.push_back(rope->left_);
+      }
+    }
+  }
+
+
+  RopeObject::~RopeObject()
+  {
+    delete[] data_;
+  }
+
+
+  void RopeObject::grey_references()
+  {
+    // Strings built up in a loop make very deep ropes, so the whole rope is
+    // greyed here rather than one level per pass of the collector.
+    std::vector<StringObject*> pending;
+
+    if (not is_flat()) {
+      pending.push_back(left_);
+      pending.push_back(right_);
+    }
+
+    while (not pending.empty()) {
+      const auto str = pending.back();
+      pending.pop_back();
+
+      if (str->colour() != TriColour::White) {
+        continue;
+      }
+
+      str->set_colour(TriColour::Grey);
+
+      if (str->is_interned()) {
+        continue;
+      }
+
+      const auto rope = static_cast<RopeObject*>(str);
+
+      if (not rope->is_flat()) {
+        pending.push_back(rope->left_);
+        pending.push_back(rope->right_);
+      }
+    }
+  }
+
+
+  void RopeObject::flatten() const
+  {
+    const auto buffer = new char[size()];
+    auto pos = buffer;
+
+    for_each_piece(
+        [&] (const char* data, const std::size_t size) {
+          std::memcpy(pos, data, size);
+          pos += size;
+        });
+
+    data_ = buffer;
+    // The pieces are garbage now, unless something else refers to them.
+    left_ = nullptr;
+    right_ = nullptr;
+  }
+
+
+  void StringBuilderObject::append(const Value& value)
+  {
+    if (const auto str = get_object<StringObject>(value)) {
+      reserve(buffer_.size() + str->size());
+      str->append_to(buffer_);
+      return;
+    }
+    if (holds_alternative<double>(value)) {
+      char buffer[max_number_length];
+      const auto length = format_number(get<double>(value), buffer);
+      reserve(buffer_.size() + length);
+      buffer_.append(buffer, length);
+      return;
+    }
+
+    std::stringstream ss;
+    ss << value;
+    const auto text = ss.str();
+
+    reserve(buffer_.size() + text.size());
+    buffer_ += text;
+  }
+
+
+  std::string StringBuilderObject::release()
+  {
+    auto ret = std::move(buffer_);
+    buffer_.clear();
+    return ret;
+  }
+
+
+  void StringBuilderObject::reserve(const std::size_t size)
+  {
+    // Growing geometrically keeps appending amortised constant time.
+    if (size > buffer_.capacity()) {
+      buffer_.reserve(std::max(size, 2 * buffer_.capacity()));
+    }
+  }
 }
@@ -20,6 +20,9 @@
 #ifndef LOXX_OBJECT_HPP
 #define LOXX_OBJECT_HPP
 
+#include <memory>
+
+#include "NumberFormat.hpp"
 #include "StringHashTable.hpp"
 #include "Value.hpp"
 
@@ -54,6 +57,7 @@ namespace loxx
     Method,
     Native,
     String,
+    StringBuilder,
     Upvalue,
   };
 
@@ -85,18 +89,23 @@ namespace loxx
   {
   public:
     FuncObject(std::string lexeme, std::unique_ptr<CodeObject> code_object,
-               const unsigned int arity, const InstrArgUByte num_upvalues);
+               const unsigned int arity, const unsigned int num_upvalues);
 
     const CodeObject* code_object() const
     { return code_object_.get(); }
 
     unsigned int arity() const { return arity_; }
-    InstrArgUByte num_upvalues() const { return num_upvalues_; }
+    unsigned int num_upvalues() const { return num_upvalues_; }
     const std::string& lexeme() const { return lexeme_; }
 
+    // The top-level function isn't tracked, so the VM's roots grey its
+    // constants through this directly.
+    void grey_constants() const;
+    void grey_references() override;
+
   private:
     unsigned int arity_;
-    InstrArgUByte num_upvalues_;
+    unsigned int num_upvalues_;
     std::unique_ptr<CodeObject> code_object_;
     std::string lexeme_;
   };
@@ -106,7 +115,7 @@ namespace loxx
   {
   public:
     explicit UpvalueObject(Value& slot)
-        : Object(ObjectType::Upvalue), value_(&slot)
+        : Object(ObjectType::Upvalue), value_(&slot), next_(nullptr)
     {}
 
     void close()
@@ -115,13 +124,27 @@ namespace loxx
       value_ = &closed_;
     }
 
+    // Points an open upvalue at the same slot in a new copy of the stack.
+    void rebase(const Value* old_base, Value* new_base)
+    {
+      if (value_ != &closed_) {
+        value_ = new_base + (value_ - old_base);
+      }
+    }
+
     const Value& value() const { return *value_; }
     void set_value(const Value& value) { *value_ = value; }
 
+    // The VM threads its list of open upvalues through the upvalues
+    // themselves.
+    UpvalueObject* next() const { return next_; }
+    void set_next(UpvalueObject* next) { next_ = next; }
+
     void grey_references() override;
 
   private:
     Value* value_;
+    UpvalueObject* next_;
     Value closed_;
   };
 
@@ -174,6 +197,10 @@ namespace loxx
   class ClassObject : public Object
   {
   public:
+    // Most classes have only a few methods, which are found faster by
+    // scanning than by hashing.
+    using MethodTable = StringHashTable<ClosureObject*, 8>;
+
     explicit ClassObject(std::string lexeme, ClassObject* superclass = {})
         : Object(ObjectType::Class),
           lexeme_(std::move(lexeme)),
@@ -183,8 +210,7 @@ namespace loxx
     const std::string& lexeme() const { return lexeme_; }
 
     bool has_method(StringObject* name) const;
-    auto method(StringObject* name) const
-        -> const StringHashTable<ClosureObject*>::Elem&;
+    auto method(StringObject* name) const -> const MethodTable::Elem&;
 
     void set_method(StringObject* name, ClosureObject* method)
     { methods_[name] = method; }
@@ -193,7 +219,7 @@ namespace loxx
 
   private:
     std::string lexeme_;
-    StringHashTable<ClosureObject*> methods_;
+    MethodTable methods_;
     ClassObject* superclass_;
   };
 
@@ -201,6 +227,9 @@ namespace loxx
   class InstanceObject : public Object
   {
   public:
+    // Likewise, most instances have only a few fields.
+    using FieldTable = StringHashTable<Value, 6>;
+
     explicit InstanceObject(ClassObject* cls)
         : Object(ObjectType::Instance),
           cls_(cls)
@@ -209,19 +238,21 @@ namespace loxx
     bool has_field(StringObject* name) const
     { return fields_.count(name) != 0; }
 
-    auto field(StringObject* name) const -> const StringHashTable<Value>::Elem&
+    auto field(StringObject* name) const -> const FieldTable::Elem&
     { return fields_.get(name); }
 
     void set_field(StringObject* name, const Value& value)
     { fields_[name] = value; }
 
+    ProbeStats field_probe_stats() const { return fields_.probe_stats(); }
+
     const ClassObject& cls() const { return *cls_; }
 
     void grey_references() override;
 
   private:
     ClassObject* cls_;
-    StringHashTable<Value> fields_;
+    FieldTable fields_;
   };
 
 
@@ -249,20 +280,122 @@ namespace loxx
   class StringObject : public Object
   {
   public:
-    explicit StringObject(std::string value)
-        : Object(ObjectType::String),
-          hash_(std::hash<std::string>()(value)), value_(std::move(value))
-    {}
+    // Interned strings keep their characters in the same allocation as the
+    // object itself. Only the string table makes these, so the hash is worked
+    // out there.
+    static std::unique_ptr<StringObject> make_interned(
+        const char* data, const std::size_t size, const std::size_t hash);
 
-    explicit operator std::string() { return value_; }
+    // Interned strings are allocated with room for their characters, which
+    // the sized delete the compiler would otherwise use doesn't account for.
+    static void operator delete(void* ptr) { ::operator delete(ptr); }
 
-    const std::string& as_std_string() const { return value_; }
+    explicit operator std::string() { return as_std_string(); }
 
+    std::string as_std_string() const;
+
+    const char* data() const;
+    std::size_t size() const { return size_; }
+    // Strings are hashed when they're interned, which is the first point at
+    // which they can be used as keys. Ropes are never interned or hashed.
     std::size_t hash() const { return hash_; }
 
+    bool is_interned() const { return interned_; }
+    bool is_rope() const { return not interned_; }
+
+    // Writes the characters out without flattening the string.
+    void append_to(std::string& buffer) const;
+
+    bool equals(const StringObject& other) const
+    {
+      if (this == &other or (interned_ and other.interned_)) {
+        return this == &other;
+      }
+      return size_ == other.size_ and compare_characters(other);
+    }
+
+  protected:
+    StringObject(const bool interned, const std::size_t size,
+                 const std::size_t hash)
+        : Object(ObjectType::String), interned_(interned), size_(size),
+          hash_(hash)
+    {}
+
+    template <typename Fn>
+    void for_each_piece(Fn fn) const;
+
   private:
+    bool compare_characters(const StringObject& other) const;
+
+    bool interned_;
+    std::size_t size_;
     std::size_t hash_;
-    std::string value_;
+  };
+
+
+  // Concatenation builds a rope, which is only flattened into a single string
+  // when its characters are needed. Ropes are never interned. Keeping the
+  // pieces here rather than in StringObject leaves interned strings as just a
+  // header followed by their characters.
+  class RopeObject : public StringObject
+  {
+  public:
+    RopeObject(StringObject* left, StringObject* right)
+        : StringObject(false, left->size() + right->size(), 0),
+          left_(left), right_(right), data_(nullptr)
+    {}
+    ~RopeObject() override;
+
+    const char* data() const
+    {
+      if (not is_flat()) {
+        flatten();
+      }
+      return data_;
+    }
+
+    bool is_flat() const { return left_ == nullptr; }
+
+    void grey_references() override;
+
+  private:
+    friend class StringObject;
+
+    void flatten() const;
+
+    mutable StringObject* left_;
+    mutable StringObject* right_;
+    mutable const char* data_;
+  };
+
+
+  inline const char* StringObject::data() const
+  {
+    if (interned_) {
+      return reinterpret_cast<const char*>(this + 1);
+    }
+    return static_cast<const RopeObject*>(this)->data();
+  }
+
+
+  // A mutable buffer for building up long strings piece by piece. It isn't
+  // interned until it's turned into a string.
+  class StringBuilderObject : public Object
+  {
+  public:
+    StringBuilderObject() : Object(ObjectType::StringBuilder) {}
+
+    void append(const Value& value);
+
+    std::size_t size() const { return buffer_.size(); }
+
+    // Hands the contents over to the caller, leaving the builder empty.
+    std::string release();
+
+  private:
+    void reserve(const std::size_t size);
+
+    std::string buffer_;
   };
 
 
@@ -314,6 +447,13 @@ namespace loxx
     }
 
 
+    template<>
+    constexpr ObjectType object_type<StringBuilderObject>()
+    {
+      return ObjectType::StringBuilder;
+    }
+
+
     template<>
     constexpr ObjectType object_type<UpvalueObject>()
     {
@@ -344,14 +484,16 @@ namespace loxx
       return os;
     }
     if (holds_alternative<double>(value)) {
-      os << get<double>(value);
+      char buffer[max_number_length];
+      const auto length = format_number(get<double>(value), buffer);
+      os.write(buffer, static_cast<std::streamsize>(length));
       return os;
     }
     else if (holds_alternative<bool>(value)) {
       os << std::boolalpha << get<bool>(value);
     }
     else if (const auto str = get_object<StringObject>(value)) {
-      os << str->as_std_string();
+      os.write(str->data(), static_cast<std::streamsize>(str->size()));
     }
     else if (holds_alternative<ObjectPtr>(value)) {
       const auto ptr = get<ObjectPtr>(value);
@@ -373,7 +515,11 @@ namespace loxx
         case ObjectType::Instance: {
           const auto instance = static_cast<InstanceObject*>(ptr);
           os << instance->cls().lexeme() << " instance";
+          break;
         }
+        case ObjectType::StringBuilder:
+          os << "<string builder>";
+          break;
         default:
           break;
       }
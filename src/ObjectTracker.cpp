@@ -18,12 +18,17 @@
  */
 
 #include <algorithm>
+#include <cstring>
 
+#include "Hash.hpp"
 #include "ObjectTracker.hpp"
 
 
 namespace loxx
 {
+  constexpr std::size_t ObjectTracker::gc_size_trigger_;
+
+
   ObjectTracker& ObjectTracker::instance()
   {
     static ObjectTracker ret;
@@ -31,28 +36,53 @@ namespace loxx
   }
 
 
-  StringObject* ObjectTracker::add_string(std::unique_ptr<StringObject> str)
+  StringObject* ObjectTracker::add_string(const std::string& value)
   {
+    // Interning is the first time a string can be used as a key, so it's
+    // hashed here, before any object is made for it.
+    const auto hash = hash_bytes(value.data(), value.size());
+
+    const auto guard = lock();
+
     const auto cached = strings_.find(
-        str.get(),
+        hash,
         [&] (StringObject* candidate) {
-          return candidate->as_std_string() == str->as_std_string();
+          return candidate->hash() == hash and
+                 candidate->size() == value.size() and
+                 std::memcmp(candidate->data(), value.data(),
+                             value.size()) == 0;
         });
 
     if (cached) {
       return *cached;
     }
 
+    auto str = StringObject::make_interned(value.data(), value.size(), hash);
     const auto ret = str.get();
-    strings_.insert(static_cast<StringObject*>(ret));
-    add_object(std::move(str));
+    strings_.insert(ret);
+    add_object_unlocked(std::move(str));
     return ret;
   }
 
 
   ObjectPtr ObjectTracker::add_object(std::unique_ptr<Object> object)
   {
-    if (objects_.size() > gc_size_trigger_) {
+    const auto guard = lock();
+    return add_object_unlocked(std::move(object));
+  }
+
+
+  std::unique_lock<std::mutex> ObjectTracker::lock()
+  {
+    return thread_safe_ ?
+           std::unique_lock<std::mutex>(mutex_) :
+           std::unique_lock<std::mutex>(mutex_, std::defer_lock);
+  }
+
+
+  ObjectPtr ObjectTracker::add_object_unlocked(std::unique_ptr<Object> object)
+  {
+    if (objects_.size() > next_gc_size_ and gc_pause_depth_ == 0) {
       collect_garbage();
     }
 
@@ -95,7 +125,39 @@ namespace loxx
       num_greys = std::count_if(objects_.begin(), objects_.end(), is_grey);
     }
 
+    // Whatever is left is garbage, so interned strings that are about to be
+    // freed have to leave the string table too.
+    for (const auto& object : objects_) {
+      if (not object or object->type() != ObjectType::String) {
+        continue;
+      }
+
+      const auto str = static_cast<StringObject*>(object.get());
+
+      if (str->is_interned()) {
+        strings_.erase(str);
+      }
+    }
+
     objects_ = std::move(reachable_objects);
+    // Leave room to grow, or a large live heap would be rescanned on every
+    // allocation.
+    next_gc_size_ = std::max(gc_size_trigger_, objects_.size() * 2);
+  }
+
+
+  ProbeStats ObjectTracker::field_probe_stats() const
+  {
+    ProbeStats stats{0, 0, 0};
+
+    for (const auto& object : objects_) {
+      if (object and object->type() == ObjectType::Instance) {
+        const auto& instance = static_cast<const InstanceObject&>(*object);
+        stats += instance.field_probe_stats();
+      }
+    }
+
+    return stats;
   }
 
 
@@ -113,7 +175,14 @@ namespace loxx
       object->set_colour(TriColour::Grey);
     }
 
-    for (auto upvalue : *roots_.upvalues) {
+    for (std::size_t i = 0; i < roots_.call_stack->size(); ++i) {
+      const auto closure = roots_.call_stack->get(i).closure();
+      closure->set_colour(TriColour::Grey);
+      closure->function().grey_constants();
+    }
+
+    for (auto upvalue = *roots_.upvalues; upvalue != nullptr;
+         upvalue = upvalue->next()) {
       upvalue->set_colour(TriColour::Grey);
     }
 
@@ -126,5 +195,9 @@ namespace loxx
 
       get<ObjectPtr>(value.second)->set_colour(TriColour::Grey);
     }
+
+    for (const auto object : *roots_.builtins) {
+      object->set_colour(TriColour::Grey);
+    }
   }
 }
\ No newline at end of file
@@ -20,14 +20,15 @@
 #ifndef LOXX_OBJECTTRACKER_HPP
 #define LOXX_OBJECTTRACKER_HPP
 
-#include <list>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "Object.hpp"
 #include "HashSet.hpp"
 #include "HashTable.hpp"
 #include "Stack.hpp"
+#include "StackFrame.hpp"
 #include "Value.hpp"
 
 
@@ -38,31 +39,57 @@ namespace loxx
   public:
     struct Roots
     {
-      Stack<Value, max_stack_size>* stack;
-      std::list<UpvalueObject*>* upvalues;
+      Stack<Value>* stack;
+      Stack<StackFrame>* call_stack;
+      UpvalueObject** upvalues;
       StringHashTable<Value>* globals;
+      std::vector<ObjectPtr>* builtins;
     };
 
     static ObjectTracker& instance();
 
-    StringObject* add_string(std::unique_ptr<StringObject> str);
+    StringObject* add_string(const std::string& value);
     ObjectPtr add_object(std::unique_ptr<Object> object);
     void set_roots(const Roots roots) { roots_ = roots; }
 
+    // Objects created by the compiler aren't reachable from the roots until
+    // the resulting code is executed, so collection is suspended while
+    // compiling.
+    void pause_gc() { ++gc_pause_depth_; }
+    void resume_gc() { --gc_pause_depth_; }
+
+    // Serialises object creation so that functions can be compiled on
+    // several threads at once. This is off by default, since the VM itself
+    // is single-threaded and allocates frequently. It must only be changed
+    // while no other threads are using the tracker.
+    void set_thread_safe(const bool thread_safe) { thread_safe_ = thread_safe; }
+
+    ProbeStats intern_probe_stats() const { return strings_.probe_stats(); }
+    // Combined over the fields of every instance that's still alive.
+    ProbeStats field_probe_stats() const;
+
   private:
     ObjectTracker()
-        : roots_{nullptr, nullptr, nullptr}
+        : thread_safe_(false), gc_pause_depth_(0),
+          next_gc_size_(gc_size_trigger_),
+          roots_{nullptr, nullptr, nullptr, nullptr, nullptr}
     {
       objects_.reserve(gc_size_trigger_);
     }
 
+    std::unique_lock<std::mutex> lock();
+    ObjectPtr add_object_unlocked(std::unique_ptr<Object> object);
     void collect_garbage();
 
     void grey_roots();
 
     static constexpr std::size_t gc_size_trigger_ = 65536;
+    bool thread_safe_;
+    std::mutex mutex_;
+    unsigned int gc_pause_depth_;
+    std::size_t next_gc_size_;
     std::vector<std::unique_ptr<Object>> objects_;
-    HashSet<StringObject*, HashStringObject, CompareStringObject> strings_;
+    StringHashSet strings_;
     Roots roots_;
   };
 
@@ -81,18 +108,22 @@ namespace loxx
     template <typename T0, typename... Ts>
     T0* make_object_impl(std::true_type, Ts&&... args)
     {
-      auto ptr = std::make_unique<T0>(std::forward<Ts>(args)...);
-      return ObjectTracker::instance().add_string(std::move(ptr));
+      return ObjectTracker::instance().add_string(
+          std::string(std::forward<Ts>(args)...));
     }
   }
 
 
+  // Strings made from their contents are interned, which is why they can't be
+  // constructed directly. Ropes are RopeObjects, which are tracked like any
+  // other object.
   template <typename T0, typename... Ts>
   T0* make_object(Ts&& ... args)
   {
+    using IsInterned = std::is_same<std::decay_t<T0>, StringObject>;
+
     return detail::make_object_impl<T0>(
-        std::is_same<std::decay_t<T0>, StringObject>(),
-        std::forward<Ts>(args)...);
+        IsInterned(), std::forward<Ts>(args)...);
   };
 }
 
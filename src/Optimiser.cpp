@@ -0,0 +1,463 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <cmath>
+#include <cstdio>
+
+#include "Object.hpp"
+#include "ObjectTracker.hpp"
+#include "Optimiser.hpp"
+
+
+namespace loxx
+{
+  namespace
+  {
+    const Literal* as_literal(const Expr* expr)
+    {
+      return typeid(*expr) == typeid(Literal) ?
+             static_cast<const Literal*>(expr) : nullptr;
+    }
+
+
+    // These mirror the semantics of the virtual machine.
+    bool is_truthy(const Value& value)
+    {
+      if (value.index() == Value::npos) {
+        return false;
+      }
+      if (holds_alternative<bool>(value)) {
+        return unsafe_get<bool>(value);
+      }
+      return true;
+    }
+
+
+    bool are_equal(const Value& first, const Value& second)
+    {
+      if (first.index() == Value::npos and second.index() == Value::npos) {
+        return true;
+      }
+      return first == second;
+    }
+  }
+
+
+  ArenaList<Stmt*> Optimiser::optimise(const ArenaList<Stmt*>& statements)
+  {
+    // Folded strings aren't reachable by the garbage collector until they're
+    // added to a code object.
+    auto& tracker = ObjectTracker::instance();
+    tracker.pause_gc();
+
+    const auto ret = optimise_stmts(statements);
+
+    tracker.resume_gc();
+
+    return ret;
+  }
+
+
+  void Optimiser::visit_assign_expr(const Assign& expr)
+  {
+    expr_ = make<Assign>(expr.name, optimise(expr.value));
+  }
+
+
+  void Optimiser::visit_binary_expr(const Binary& expr)
+  {
+    const auto left = optimise(expr.left);
+    const auto right = optimise(expr.right);
+
+    const auto left_literal = as_literal(left);
+    const auto right_literal = as_literal(right);
+
+    if (left_literal and right_literal) {
+      const auto folded =
+          fold_binary(left_literal->value, expr.op, right_literal->value);
+
+      if (folded != nullptr) {
+        expr_ = folded;
+        return;
+      }
+    }
+
+    expr_ = make<Binary>(left, expr.op, right);
+  }
+
+
+  void Optimiser::visit_call_expr(const Call& expr)
+  {
+    const auto callee = optimise(expr.callee);
+
+    const auto mark = expr_scratch_.size();
+
+    for (const auto argument : expr.arguments) {
+      expr_scratch_.push_back(optimise(argument));
+    }
+
+    const auto arguments = arena_->make_list(
+        expr_scratch_.data() + mark,
+        expr_scratch_.data() + expr_scratch_.size());
+    expr_scratch_.erase(expr_scratch_.begin() + mark, expr_scratch_.end());
+
+    expr_ = make<Call>(callee, expr.paren, arguments);
+  }
+
+
+  void Optimiser::visit_get_expr(const Get& expr)
+  {
+    expr_ = make<Get>(optimise(expr.object), expr.name);
+  }
+
+
+  void Optimiser::visit_grouping_expr(const Grouping& expr)
+  {
+    const auto inner = optimise(expr.expression);
+    expr_ = as_literal(inner) ? inner : make<Grouping>(inner);
+  }
+
+
+  void Optimiser::visit_literal_expr(const Literal& expr)
+  {
+    expr_ = make<Literal>(expr.value, expr.lexeme);
+  }
+
+
+  void Optimiser::visit_logical_expr(const Logical& expr)
+  {
+    const auto left = optimise(expr.left);
+    const auto left_literal = as_literal(left);
+
+    if (left_literal == nullptr) {
+      expr_ = make<Logical>(left, expr.op, optimise(expr.right));
+      return;
+    }
+
+    // The left operand decides the result if it's truthy for 'or' or falsey
+    // for 'and'. Otherwise the result is always the right operand.
+    const auto is_or = expr.op.type() == TokenType::Or;
+    const auto short_circuits = is_truthy(left_literal->value) == is_or;
+
+    if (not short_circuits) {
+      expr_ = optimise(expr.right);
+    }
+    else if (level_ >= 2) {
+      expr_ = left;
+    }
+    else {
+      expr_ = make<Logical>(left, expr.op, optimise(expr.right));
+    }
+  }
+
+
+  void Optimiser::visit_set_expr(const Set& expr)
+  {
+    const auto object = optimise(expr.object);
+    expr_ = make<Set>(object, expr.name, optimise(expr.value));
+  }
+
+
+  void Optimiser::visit_super_expr(const Super& expr)
+  {
+    expr_ = make<Super>(expr.keyword, expr.method);
+  }
+
+
+  void Optimiser::visit_this_expr(const This& expr)
+  {
+    expr_ = make<This>(expr.keyword);
+  }
+
+
+  void Optimiser::visit_unary_expr(const Unary& expr)
+  {
+    const auto right = optimise(expr.right);
+
+    if (const auto literal = as_literal(right)) {
+      const auto& value = literal->value;
+
+      if (expr.op.type() == TokenType::Bang) {
+        expr_ = make_literal(Value(InPlace<bool>(), not is_truthy(value)));
+        return;
+      }
+      if (expr.op.type() == TokenType::Minus and
+          holds_alternative<double>(value)) {
+        expr_ = make_literal(-unsafe_get<double>(value));
+        return;
+      }
+    }
+
+    expr_ = make<Unary>(expr.op, right);
+  }
+
+
+  void Optimiser::visit_variable_expr(const Variable& expr)
+  {
+    expr_ = make<Variable>(expr.name);
+  }
+
+
+  void Optimiser::visit_block_stmt(const Block& stmt)
+  {
+    stmt_ = make<Block>(optimise_stmts(stmt.statements));
+  }
+
+
+  void Optimiser::visit_class_stmt(const Class& stmt)
+  {
+    const auto superclass =
+        stmt.superclass != nullptr ? optimise(stmt.superclass) : nullptr;
+
+    const auto mark = method_scratch_.size();
+
+    for (const auto method : stmt.methods) {
+      method_scratch_.push_back(optimise_function(*method));
+    }
+
+    const auto methods = arena_->make_list(
+        method_scratch_.data() + mark,
+        method_scratch_.data() + method_scratch_.size());
+    method_scratch_.erase(method_scratch_.begin() + mark,
+                          method_scratch_.end());
+
+    stmt_ = make<Class>(stmt.name, superclass, methods);
+  }
+
+
+  void Optimiser::visit_expression_stmt(const Expression& stmt)
+  {
+    stmt_ = make<Expression>(optimise(stmt.expression));
+  }
+
+
+  void Optimiser::visit_function_stmt(const Function& stmt)
+  {
+    stmt_ = optimise_function(stmt);
+  }
+
+
+  void Optimiser::visit_if_stmt(const If& stmt)
+  {
+    const auto condition = optimise(stmt.condition);
+    const auto literal = as_literal(condition);
+
+    if (level_ >= 2 and literal != nullptr) {
+      if (is_truthy(literal->value)) {
+        stmt_ = optimise(stmt.then_branch);
+      }
+      else {
+        stmt_ = stmt.else_branch != nullptr ?
+                optimise(stmt.else_branch) : nullptr;
+      }
+      return;
+    }
+
+    const auto then_branch = optimise_branch(stmt.then_branch);
+    const auto else_branch =
+        stmt.else_branch != nullptr ? optimise(stmt.else_branch) : nullptr;
+
+    stmt_ = make<If>(condition, then_branch, else_branch);
+  }
+
+
+  void Optimiser::visit_print_stmt(const Print& stmt)
+  {
+    stmt_ = make<Print>(optimise(stmt.expression));
+  }
+
+
+  void Optimiser::visit_return_stmt(const Return& stmt)
+  {
+    const auto value =
+        stmt.value != nullptr ? optimise(stmt.value) : nullptr;
+    stmt_ = make<Return>(stmt.keyword, value);
+  }
+
+
+  void Optimiser::visit_var_stmt(const Var& stmt)
+  {
+    const auto initialiser =
+        stmt.initialiser != nullptr ? optimise(stmt.initialiser) : nullptr;
+    stmt_ = make<Var>(stmt.name, initialiser);
+  }
+
+
+  void Optimiser::visit_while_stmt(const While& stmt)
+  {
+    const auto condition = optimise(stmt.condition);
+    const auto literal = as_literal(condition);
+
+    if (level_ >= 2 and literal != nullptr and
+        not is_truthy(literal->value)) {
+      stmt_ = nullptr;
+      return;
+    }
+
+    stmt_ = make<While>(condition, optimise_branch(stmt.body));
+  }
+
+
+  Expr* Optimiser::optimise(const Expr* expr)
+  {
+    expr->accept(*this);
+    return expr_;
+  }
+
+
+  Stmt* Optimiser::optimise(const Stmt* stmt)
+  {
+    stmt->accept(*this);
+    return stmt_;
+  }
+
+
+  Stmt* Optimiser::optimise_branch(const Stmt* stmt)
+  {
+    // The bodies of if-statements and loops can't be left empty, so removed
+    // statements are replaced with an empty block.
+    const auto ret = optimise(stmt);
+    return ret != nullptr ? ret : make<Block>(ArenaList<Stmt*>());
+  }
+
+
+  ArenaList<Stmt*> Optimiser::optimise_stmts(
+      const ArenaList<Stmt*>& statements)
+  {
+    const auto mark = stmt_scratch_.size();
+
+    for (const auto stmt : statements) {
+      const auto optimised = optimise(stmt);
+
+      if (optimised != nullptr) {
+        stmt_scratch_.push_back(optimised);
+      }
+    }
+
+    const auto ret = arena_->make_list(
+        stmt_scratch_.data() + mark,
+        stmt_scratch_.data() + stmt_scratch_.size());
+    stmt_scratch_.erase(stmt_scratch_.begin() + mark, stmt_scratch_.end());
+
+    return ret;
+  }
+
+
+  Function* Optimiser::optimise_function(const Function& stmt)
+  {
+    return make<Function>(stmt.name, stmt.parameters,
+                          optimise_stmts(stmt.body));
+  }
+
+
+  Expr* Optimiser::fold_binary(const Value& left, const Token& op,
+                               const Value& right)
+  {
+    if (op.type() == TokenType::EqualEqual or
+        op.type() == TokenType::BangEqual) {
+      const auto equal = are_equal(left, right);
+      return make_literal(
+          Value(InPlace<bool>(), equal == (op.type() == TokenType::EqualEqual)));
+    }
+
+    if (op.type() == TokenType::Plus) {
+      const auto left_str = get_object<StringObject>(left);
+      const auto right_str = get_object<StringObject>(right);
+
+      if (left_str and right_str) {
+        const auto combined = make_object<StringObject>(
+            left_str->as_std_string() + right_str->as_std_string());
+        return make_literal(Value(InPlace<ObjectPtr>(), combined));
+      }
+    }
+
+    // Everything else only works on numbers, and would raise an error at
+    // runtime otherwise.
+    if (not holds_alternative<double>(left) or
+        not holds_alternative<double>(right)) {
+      return nullptr;
+    }
+
+    const auto first = unsafe_get<double>(left);
+    const auto second = unsafe_get<double>(right);
+
+    // The comparisons with an equals sign are negations of the strict
+    // comparisons in the virtual machine, which matters for NaN.
+    switch (op.type()) {
+    case TokenType::Plus:
+      return make_literal(first + second);
+    case TokenType::Minus:
+      return make_literal(first - second);
+    case TokenType::Star:
+      return make_literal(first * second);
+    case TokenType::Slash:
+      return make_literal(first / second);
+    case TokenType::Less:
+      return make_literal(Value(InPlace<bool>(), first < second));
+    case TokenType::LessEqual:
+      return make_literal(Value(InPlace<bool>(), not (first > second)));
+    case TokenType::Greater:
+      return make_literal(Value(InPlace<bool>(), first > second));
+    case TokenType::GreaterEqual:
+      return make_literal(Value(InPlace<bool>(), not (first < second)));
+    default:
+      return nullptr;
+    }
+  }
+
+
+  Expr* Optimiser::make_literal(const Value& value)
+  {
+    // The compiler uses a literal's lexeme to deduplicate constants, so
+    // each lexeme must identify exactly one value. Numbers are written with
+    // enough digits to round-trip and strings are quoted as in the source,
+    // which keeps them distinct from identifiers.
+    std::string lexeme;
+
+    if (value.index() == Value::npos) {
+      return make<Literal>(value, keyword_symbol(TokenType::Nil));
+    }
+    else if (holds_alternative<bool>(value)) {
+      const auto keyword =
+          unsafe_get<bool>(value) ? TokenType::True : TokenType::False;
+      return make<Literal>(value, keyword_symbol(keyword));
+    }
+    else if (holds_alternative<double>(value)) {
+      const auto number = unsafe_get<double>(value);
+
+      if (std::isnan(number)) {
+        lexeme = "0/0";
+      }
+      else if (std::isinf(number)) {
+        lexeme = number > 0.0 ? "1/0" : "-1/0";
+      }
+      else {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.17g", number);
+        lexeme = buffer;
+      }
+    }
+    else {
+      const auto str = get_object<StringObject>(value);
+      lexeme = '"' + str->as_std_string() + '"';
+    }
+
+    return make<Literal>(value, SymbolTable::instance().intern(lexeme));
+  }
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_OPTIMISER_HPP
+#define LOXX_OPTIMISER_HPP
+
+#include <vector>
+
+#include "Arena.hpp"
+#include "Stmt.hpp"
+
+
+namespace loxx
+{
+  // Rewrites a syntax tree ahead of compilation. At level one, arithmetic,
+  // comparisons, string concatenation and logical operators with literal
+  // operands are evaluated, along with anything that reduces to literals as a
+  // result. At level two, branches and loops whose conditions are literals are
+  // also pruned, which means compile errors in code that can never run are no
+  // longer reported.
+  //
+  // Expressions are only folded if evaluating them at runtime couldn't fail,
+  // so runtime errors are raised exactly as before.
+  class Optimiser : private Expr::Visitor, private Stmt::Visitor
+  {
+  public:
+    // The rewritten tree is allocated in the supplied arena, alongside the
+    // original.
+    Optimiser(Arena& arena, const unsigned int level)
+        : level_(level), arena_(&arena), expr_(nullptr), stmt_(nullptr)
+    {}
+
+    ArenaList<Stmt*> optimise(const ArenaList<Stmt*>& statements);
+
+  private:
+    void visit_assign_expr(const Assign& expr) override;
+    void visit_binary_expr(const Binary& expr) override;
+    void visit_call_expr(const Call& expr) override;
+    void visit_get_expr(const Get& expr) override;
+    void visit_grouping_expr(const Grouping& expr) override;
+    void visit_literal_expr(const Literal& expr) override;
+    void visit_logical_expr(const Logical& expr) override;
+    void visit_set_expr(const Set& expr) override;
+    void visit_super_expr(const Super& expr) override;
+    void visit_this_expr(const This& expr) override;
+    void visit_unary_expr(const Unary& expr) override;
+    void visit_variable_expr(const Variable& expr) override;
+
+    void visit_block_stmt(const Block& stmt) override;
+    void visit_class_stmt(const Class& stmt) override;
+    void visit_expression_stmt(const Expression& stmt) override;
+    void visit_function_stmt(const Function& stmt) override;
+    void visit_if_stmt(const If& stmt) override;
+    void visit_print_stmt(const Print& stmt) override;
+    void visit_return_stmt(const Return& stmt) override;
+    void visit_var_stmt(const Var& stmt) override;
+    void visit_while_stmt(const While& stmt) override;
+
+    Expr* optimise(const Expr* expr);
+    Stmt* optimise(const Stmt* stmt);
+    Stmt* optimise_branch(const Stmt* stmt);
+    ArenaList<Stmt*> optimise_stmts(const ArenaList<Stmt*>& statements);
+    Function* optimise_function(const Function& stmt);
+
+    Expr* fold_binary(const Value& left, const Token& op, const Value& right);
+    Expr* make_literal(const Value& value);
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    { return arena_->make<T>(std::forward<Args>(args)...); }
+
+    unsigned int level_;
+    Arena* arena_;
+    // The result of visiting a node. A null statement denotes one that has
+    // been removed entirely.
+    Expr* expr_;
+    Stmt* stmt_;
+    // As in the Parser, lists are built up on the end of these buffers and
+    // then copied into the arena.
+    std::vector<Expr*> expr_scratch_;
+    std::vector<Stmt*> stmt_scratch_;
+    std::vector<Function*> method_scratch_;
+  };
+}
+
+#endif //LOXX_OPTIMISER_HPP
@@ -0,0 +1,100 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <iostream>
+
+#include "OutputBuffer.hpp"
+
+#if defined(__unix__) or defined(__APPLE__)
+#define LOXX_HAVE_ISATTY
+#include <unistd.h>
+#endif
+
+
+namespace loxx
+{
+  OutputBuffer::OutputBuffer(std::ostream& stream, std::FILE* file,
+                             const std::size_t size)
+      : stream_(stream), previous_(nullptr), file_(file), buffer_(size)
+  {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    previous_ = stream_.rdbuf(this);
+  }
+
+
+  OutputBuffer::~OutputBuffer()
+  {
+    sync();
+    stream_.rdbuf(previous_);
+  }
+
+
+  auto OutputBuffer::overflow(int_type ch) -> int_type
+  {
+    if (not write_buffer()) {
+      return traits_type::eof();
+    }
+
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+      return traits_type::not_eof(ch);
+    }
+
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+  }
+
+
+  int OutputBuffer::sync()
+  {
+    return write_buffer() and std::fflush(file_) == 0 ? 0 : -1;
+  }
+
+
+  bool OutputBuffer::write_buffer()
+  {
+    const auto size = static_cast<std::size_t>(pptr() - pbase());
+    const auto written = std::fwrite(pbase(), 1, size, file_);
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+    return written == size;
+  }
+
+
+  void buffer_stdout(const BufferMode mode)
+  {
+    if (mode == BufferMode::Line) {
+      std::setvbuf(stdout, nullptr, _IOLBF, BUFSIZ);
+      return;
+    }
+
+    // This is constructed after the standard streams, so it's destroyed and
+    // writes out what's left before they are, including on std::exit.
+    static OutputBuffer buffer(std::cout, stdout);
+  }
+
+
+  bool stdout_is_terminal()
+  {
+#ifdef LOXX_HAVE_ISATTY
+    return isatty(STDOUT_FILENO) != 0;
+#else
+    return false;
+#endif
+  }
+}
@@ -0,0 +1,80 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_OUTPUTBUFFER_HPP
+#define LOXX_OUTPUTBUFFER_HPP
+
+#include <cstdio>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+
+namespace loxx
+{
+  enum class BufferMode
+  {
+    Full,
+    Line
+  };
+
+
+  constexpr std::size_t default_output_buffer_size = 1 << 16;
+
+
+  // Replaces a stream's buffer until it's destroyed, collecting what's written
+  // to the stream and passing it on to a C file in large blocks. A block is
+  // written out when the buffer fills up or the stream is flushed (e.g. by
+  // std::endl).
+  class OutputBuffer : public std::streambuf
+  {
+  public:
+    OutputBuffer(std::ostream& stream, std::FILE* file,
+                 const std::size_t size = default_output_buffer_size);
+    ~OutputBuffer() override;
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+  protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+  private:
+    bool write_buffer();
+
+    std::ostream& stream_;
+    std::streambuf* previous_;
+    std::FILE* file_;
+    std::vector<char> buffer_;
+  };
+
+
+  // Sets how standard output is buffered until the program exits. In full
+  // mode std::cout is given an OutputBuffer, so printing doesn't cost a system
+  // call each time. In line mode the C stream behind std::cout is written out
+  // at the end of each line. This has to be called before anything is
+  // printed.
+  void buffer_stdout(const BufferMode mode);
+
+
+  bool stdout_is_terminal();
+}
+
+#endif //LOXX_OUTPUTBUFFER_HPP
@@ -23,8 +23,13 @@
 
 namespace loxx
 {
-  std::unique_ptr<Stmt> Parser::declaration()
+  Stmt* Parser::declaration()
   {
+    const auto expr_mark = expr_scratch_.size();
+    const auto stmt_mark = stmt_scratch_.size();
+    const auto method_mark = method_scratch_.size();
+    const auto token_mark = token_scratch_.size();
+
     try {
       if (match({TokenType::Class})) {
         return class_declaration();
@@ -39,39 +44,44 @@ namespace loxx
       return statement();
     }
     catch (const ParseError& e) {
+      // Drop any lists that were left half-built by the error.
+      expr_scratch_.resize(expr_mark);
+      stmt_scratch_.resize(stmt_mark);
+      method_scratch_.resize(method_mark);
+      token_scratch_.erase(token_scratch_.begin() + token_mark,
+                           token_scratch_.end());
       synchronise();
 
-      return std::unique_ptr<Stmt>();
+      return nullptr;
     }
   }
 
 
-  std::unique_ptr<Stmt> Parser::class_declaration()
+  Stmt* Parser::class_declaration()
   {
     auto name = consume(TokenType::Identifier, "Expected class name.");
 
-    auto superclass = std::unique_ptr<Expr>();
+    Expr* superclass = nullptr;
     if (match({TokenType::Less})) {
       consume(TokenType::Identifier, "Expected superclass name.");
-      superclass = std::make_unique<Variable>(previous());
+      superclass = make<Variable>(previous());
     }
 
     consume(TokenType::LeftBrace, "Expected '{' before class body.");
 
-    std::vector<std::unique_ptr<Function>> methods;
+    const auto mark = method_scratch_.size();
     while (not check(TokenType::RightBrace) and not is_at_end()) {
-      std::unique_ptr<Stmt> ptr = function("method");
-      methods.emplace_back(static_cast<Function*>(ptr.release()));
+      method_scratch_.push_back(static_cast<Function*>(function("method")));
     }
 
     consume(TokenType::RightBrace, "Expected '}' after class body.");
 
-    return std::make_unique<Class>(std::move(name), std::move(superclass),
-                                   std::move(methods));
+    return make<Class>(std::move(name), superclass,
+                       make_list(method_scratch_, mark));
   }
 
 
-  std::unique_ptr<Stmt> Parser::statement()
+  Stmt* Parser::statement()
   {
     if (match({TokenType::If})) {
       return if_statement();
@@ -83,7 +93,7 @@ namespace loxx
       return return_statement();
     }
     if (match({TokenType::LeftBrace})) {
-      return std::make_unique<Block>(block());
+      return make<Block>(block());
     }
     if (match({TokenType::While})) {
       return while_statement();
@@ -95,7 +105,7 @@ namespace loxx
   }
 
 
-  std::unique_ptr<Stmt> Parser::if_statement()
+  Stmt* Parser::if_statement()
   {
     consume(TokenType::LeftParen, "Expected '(' after 'if'.");
     auto condition = expression();
@@ -103,60 +113,59 @@ namespace loxx
 
     auto then_branch = statement();
     auto else_branch =
-        match({TokenType::Else}) ? statement() : std::unique_ptr<Stmt>();
+        match({TokenType::Else}) ? statement() : nullptr;
 
-    return std::make_unique<If>(std::move(condition), std::move(then_branch),
-                                std::move(else_branch));
+    return make<If>(condition, then_branch, else_branch);
   }
 
 
-  std::unique_ptr<Stmt> Parser::print_statement()
+  Stmt* Parser::print_statement()
   {
     auto expr = expression();
     consume(TokenType::SemiColon, "Expect ';' after value.");
-    return std::make_unique<Print>(std::move(expr));
+    return make<Print>(expr);
   }
 
 
-  std::unique_ptr<Stmt> Parser::return_statement()
+  Stmt* Parser::return_statement()
   {
     auto keyword = previous();
     auto value = not check(TokenType::SemiColon) ?
-                 expression() : std::unique_ptr<Expr>();
+                 expression() : nullptr;
 
     consume(TokenType::SemiColon, "Expected ';' after return value.");
-    return std::make_unique<Return>(std::move(keyword), std::move(value));
+    return make<Return>(std::move(keyword), value);
   }
 
 
-  std::unique_ptr<Stmt> Parser::var_declaration()
+  Stmt* Parser::var_declaration()
   {
     auto name = consume(TokenType::Identifier, "Expected variable name.");
 
     auto initialiser =
-        match({TokenType::Equal}) ? expression() : std::unique_ptr<Expr>();
+        match({TokenType::Equal}) ? expression() : nullptr;
 
     consume(TokenType::SemiColon, "Expected ';' after variable declaration.");
-    return std::make_unique<Var>(std::move(name), std::move(initialiser));
+    return make<Var>(std::move(name), initialiser);
   }
 
 
-  std::unique_ptr<Stmt> Parser::while_statement()
+  Stmt* Parser::while_statement()
   {
     consume(TokenType::LeftParen, "Expected '(' after 'while'.");
     auto condition = expression();
     consume(TokenType::RightParen, "Expected ')' after condition.");
     auto body = statement();
 
-    return std::make_unique<While>(std::move(condition), std::move(body));
+    return make<While>(condition, body);
   }
 
 
-  std::unique_ptr<Stmt> Parser::for_statement()
+  Stmt* Parser::for_statement()
   {
     consume(TokenType::LeftParen, "Expected '(' after 'for'.");
 
-    std::unique_ptr<Stmt> initialiser;
+    Stmt* initialiser = nullptr;
     if (match({TokenType::SemiColon})) {
     }
     else if (match({TokenType::Var})) {
@@ -166,13 +175,13 @@ namespace loxx
       initialiser = expression_statement();
     }
 
-    std::unique_ptr<Expr> condition;
+    Expr* condition = nullptr;
     if (not check(TokenType::SemiColon)) {
       condition = expression();
     }
     consume(TokenType::SemiColon, "Expected ';' after for-loop condition.");
 
-    std::unique_ptr<Expr> increment;
+    Expr* increment = nullptr;
     if (not check(TokenType::RightParen)) {
       increment = expression();
     }
@@ -180,79 +189,74 @@ namespace loxx
 
     auto body = statement();
 
-    using StmtList = std::vector<std::unique_ptr<Stmt>>;
-
     if (increment != nullptr) {
-      StmtList stmts(2);
-      stmts[0] = std::move(body);
-      stmts[1] = std::make_unique<Expression>(std::move(increment));
-      body = std::make_unique<Block>(std::move(stmts));
+      Stmt* stmts[] = {body, make<Expression>(increment)};
+      body = make<Block>(arena_->make_list(stmts, stmts + 2));
     }
 
     if (condition == nullptr) {
-      condition = std::make_unique<Literal>(Value(InPlace<bool>(), true),
-                                            "true");
+      condition = make<Literal>(Value(InPlace<bool>(), true),
+                                keyword_symbol(TokenType::True));
     }
-    body = std::make_unique<While>(std::move(condition), std::move(body));
+    body = make<While>(condition, body);
 
     if (initialiser != nullptr) {
-      StmtList stmts(2);
-      stmts[0] = std::move(initialiser);
-      stmts[1] = std::move(body);
-      body = std::make_unique<Block>(std::move(stmts));
+      Stmt* stmts[] = {initialiser, body};
+      body = make<Block>(arena_->make_list(stmts, stmts + 2));
     }
 
     return body;
   }
 
 
-  std::unique_ptr<Stmt> Parser::expression_statement()
+  Stmt* Parser::expression_statement()
   {
     auto expr = expression();
     consume(TokenType::SemiColon, "Expected ';' after expression.");
-    return std::make_unique<Expression>(std::move(expr));
+    return make<Expression>(expr);
   }
 
 
-  std::vector<std::unique_ptr<Stmt>> Parser::block()
+  ArenaList<Stmt*> Parser::block()
   {
-    std::vector<std::unique_ptr<Stmt>> statements;
+    const auto mark = stmt_scratch_.size();
 
     while (not check(TokenType::RightBrace) and not is_at_end()) {
-      statements.push_back(declaration());
+      stmt_scratch_.push_back(declaration());
     }
 
     consume(TokenType::RightBrace, "Expected '}' after block.");
-    return statements;
+
+    return make_list(stmt_scratch_, mark);
   }
 
 
-  std::unique_ptr<Stmt> Parser::function(const std::string& kind)
+  Stmt* Parser::function(const std::string& kind)
   {
     auto name = consume(TokenType::Identifier, "Expected " + kind + " name.");
     consume(TokenType::LeftParen, "Expected '(' after " + kind + " name.");
 
-    std::vector<Token> parameters;
+    const auto mark = token_scratch_.size();
 
     if (not check(TokenType::RightParen)) {
       do {
-        if (parameters.size() >= 8) {
+        if (token_scratch_.size() - mark >= 8) {
           error(peek(), "Cannot have more than eight function parameters.");
         }
-        parameters.push_back(consume(TokenType::Identifier,
-                                     "Expected parameter name."));
+        token_scratch_.push_back(consume(TokenType::Identifier,
+                                         "Expected parameter name."));
       } while (match({TokenType::Comma}));
     }
     consume(TokenType::RightParen, "Expected ')' after parameters.");
+    const auto parameters = make_list(token_scratch_, mark);
 
     consume(TokenType::LeftBrace, "Expected '{' before " + kind + " body.");
     auto body = block();
-    return std::make_unique<Function>(std::move(name), std::move(parameters),
-                                      std::move(body));
+    return make<Function>(std::move(name), parameters, body);
   }
 
 
-  std::unique_ptr<Expr> Parser::assignment()
+  Expr* Parser::assignment()
   {
     auto expr = logical_or();
 
@@ -261,13 +265,12 @@ namespace loxx
       auto value = assignment();
 
       if (typeid(*expr) == typeid(Variable)) {
-        Token name = static_cast<Variable*>(expr.get())->name;
-        return std::make_unique<Assign>(std::move(name), std::move(value));
+        Token name = static_cast<Variable*>(expr)->name;
+        return make<Assign>(std::move(name), value);
       }
       if (typeid(*expr) == typeid(Get)) {
-        auto get = static_cast<Get*>(expr.get());
-        return std::make_unique<Set>(std::move(get->object), get->name,
-                                     std::move(value));
+        auto get = static_cast<Get*>(expr);
+        return make<Set>(get->object, get->name, value);
       }
 
       error(equals, "Invalid assignment target.");
@@ -277,44 +280,42 @@ namespace loxx
   }
 
 
-  std::unique_ptr<Expr> Parser::logical_or()
+  Expr* Parser::logical_or()
   {
     auto expr = logical_and();
 
     while (match({TokenType::Or})) {
       auto op = previous();
       auto right = logical_and();
-      expr = std::make_unique<Logical>(std::move(expr), std::move(op),
-                                       std::move(right));
+      expr = make<Logical>(expr, std::move(op), right);
     }
 
     return expr;
   }
 
 
-  std::unique_ptr<Expr> Parser::logical_and()
+  Expr* Parser::logical_and()
   {
     auto expr = equality();
 
     while (match({TokenType::And})) {
       auto op = previous();
       auto right = equality();
-      expr = std::make_unique<Logical>(std::move(expr), std::move(op),
-                                       std::move(right));
+      expr = make<Logical>(expr, std::move(op), right);
     }
 
     return expr;
   }
 
 
-  std::unique_ptr<Expr> Parser::equality()
+  Expr* Parser::equality()
   {
     return binary([this] () { return comparison(); },
                   {TokenType::BangEqual, TokenType::EqualEqual});
   }
 
 
-  std::unique_ptr<Expr> Parser::comparison()
+  Expr* Parser::comparison()
   {
     return binary([this] () { return addition(); },
                   {TokenType::Greater, TokenType::GreaterEqual,
@@ -322,64 +323,64 @@ namespace loxx
   }
 
 
-  std::unique_ptr<Expr> Parser::addition()
+  Expr* Parser::addition()
   {
     return binary([this] () { return multiplication(); },
                   {TokenType::Minus, TokenType::Plus});
   }
 
 
-  std::unique_ptr<Expr> Parser::multiplication()
+  Expr* Parser::multiplication()
   {
     return binary([this] () { return unary(); },
                   {TokenType::Slash, TokenType::Star});
   }
 
 
-  std::unique_ptr<Expr> Parser::unary()
+  Expr* Parser::unary()
   {
     if (match({TokenType::Bang, TokenType::Minus})) {
       Token op = previous();
       auto right = unary();
-      return std::make_unique<Unary>(op, std::move(right));
+      return make<Unary>(op, right);
     }
 
     return call();
   }
 
 
-  std::unique_ptr<Expr> Parser::finish_call(std::unique_ptr<Expr> callee)
+  Expr* Parser::finish_call(Expr* callee)
   {
-    std::vector<std::unique_ptr<Expr>> arguments;
+    const auto mark = expr_scratch_.size();
 
     if (not check(TokenType::RightParen)) {
       do {
-        if (arguments.size() >= 8) {
+        if (expr_scratch_.size() - mark >= 8) {
           error(peek(), "Cannot have more than eight function arguments.");
         }
-        arguments.push_back(expression());
+        expr_scratch_.push_back(expression());
       } while (match({TokenType::Comma}));
     }
 
     auto paren = consume(TokenType::RightParen, "Expected ')' after arguments.");
+    const auto arguments = make_list(expr_scratch_, mark);
 
-    return std::make_unique<Call>(std::move(callee), std::move(paren),
-                                  std::move(arguments));
+    return make<Call>(callee, std::move(paren), arguments);
   }
 
 
-  std::unique_ptr<Expr> Parser::call()
+  Expr* Parser::call()
   {
     auto expr = primary();
 
     while (true) {
       if (match({TokenType::LeftParen})) {
-        expr = finish_call(std::move(expr));
+        expr = finish_call(expr);
       }
       else if (match({TokenType::Dot})) {
         auto name = consume(TokenType::Identifier,
                             "Expected property name after '.'.");
-        expr = std::make_unique<Get>(std::move(expr), std::move(name));
+        expr = make<Get>(expr, std::move(name));
       }
       else {
         break;
@@ -390,29 +391,27 @@ namespace loxx
   }
 
 
-  std::unique_ptr<Expr> Parser::primary()
+  Expr* Parser::primary()
   {
     if (match({TokenType::False})) {
-      return std::make_unique<Literal>(Value(InPlace<bool>(), false),
-                                       previous().lexeme());
+      return make<Literal>(Value(InPlace<bool>(), false),
+                           previous().symbol());
     }
     if (match({TokenType::True})) {
-      return std::make_unique<Literal>(Value(InPlace<bool>(), true),
-                                       previous().lexeme());
+      return make<Literal>(Value(InPlace<bool>(), true), previous().symbol());
     }
     if (match({TokenType::Nil})) {
-      return std::make_unique<Literal>(Value(), previous().lexeme());
+      return make<Literal>(Value(), previous().symbol());
     }
 
     if (match({TokenType::Number, TokenType::String})) {
-      return std::make_unique<Literal>(previous().literal(),
-                                       previous().lexeme());
+      return make<Literal>(previous().literal(), previous().symbol());
     }
 
     if (match({TokenType::LeftParen})) {
       auto expr = expression();
       consume(TokenType::RightParen, "Expect ')' after expression.");
-      return std::make_unique<Grouping>(std::move(expr));
+      return make<Grouping>(expr);
     }
 
     if (match({TokenType::Super})) {
@@ -420,110 +419,17 @@ namespace loxx
       consume(TokenType::Dot, "Expected '.' after 'super'.");
       auto method = consume(TokenType::Identifier,
                             "Expected superclass method name.");
-      return std::make_unique<Super>(std::move(keyword), std::move(method));
+      return make<Super>(std::move(keyword), std::move(method));
     }
 
     if (match({TokenType::This})) {
-      return std::make_unique<This>(previous());
+      return make<This>(previous());
     }
 
     if (match({TokenType::Identifier})) {
-      return std::make_unique<Variable>(previous());
+      return make<Variable>(previous());
     }
 
     throw error(peek(), "Expected expression.");
   }
-
-
-  bool Parser::match(std::initializer_list<TokenType> types)
-  {
-    for (const auto type : types) {
-      if (check(type)) {
-        advance();
-        return true;
-      }
-    }
-    return false;
-  }
-
-
-  const Token& Parser::consume(const TokenType type, const std::string& message)
-  {
-    if (check(type)) {
-      return advance();
-    }
-
-    throw error(peek(), message);
-  }
-
-
-  bool Parser::check(const TokenType type) const
-  {
-    if (is_at_end()) {
-      return false;
-    }
-    return peek().type() == type;
-  }
-
-
-  const Token& Parser::advance()
-  {
-    if (not is_at_end()) {
-      current_ += 1;
-    }
-    return previous();
-  }
-
-
-  bool Parser::is_at_end() const
-  {
-    return peek().type() == TokenType::Eof;
-  }
-
-
-  const Token& Parser::peek() const
-  {
-    return tokens_[current_];
-  }
-
-
-  const Token& Parser::previous() const
-  {
-    return tokens_[current_ - 1];
-  }
-
-
-  Parser::ParseError Parser::error(const Token& token,
-                                   const std::string& message)
-  {
-    loxx::error(token, message);
-    return ParseError();
-  }
-
-
-  void Parser::synchronise()
-  {
-    advance();
-
-    while (not is_at_end()) {
-      if (previous().type() == TokenType::SemiColon) {
-        return;
-      }
-
-      switch (peek().type()) {
-        case TokenType::Class:
-        case TokenType::Fun:
-        case TokenType::Var:
-        case TokenType::For:
-        case TokenType::If:
-        case TokenType::While:
-        case TokenType::Print:
-        case TokenType::Return:
-          return;
-        default:
-          advance();
-          break;
-      }
-    }
-  }
 }
@@ -22,86 +22,86 @@
 
 #include <vector>
 
+#include "Arena.hpp"
 #include "Stmt.hpp"
 #include "Token.hpp"
+#include "TokenStream.hpp"
 
 
 namespace loxx
 {
-  class Parser
+  class Parser : private TokenStream
   {
-    class ParseError;
-
   public:
-    explicit Parser(std::vector<Token> tokens, const bool in_repl = false)
-        : in_repl_(in_repl), current_(0), tokens_(std::move(tokens))
+    // Syntax tree nodes are allocated in the supplied arena, which must
+    // outlive any use of the statements returned by parse().
+    Parser(std::vector<Token> tokens, Arena& arena,
+           const bool in_repl = false)
+        : TokenStream(std::move(tokens)), in_repl_(in_repl), arena_(&arena)
     {}
 
-    std::vector<std::unique_ptr<Stmt>> parse() {
-      std::vector<std::unique_ptr<Stmt>> statements;
+    ArenaList<Stmt*> parse() {
+      const auto mark = stmt_scratch_.size();
 
       while (not is_at_end()) {
-        statements.emplace_back(declaration());
+        stmt_scratch_.push_back(declaration());
       }
 
-      return statements;
+      return make_list(stmt_scratch_, mark);
     }
 
   private:
-    class ParseError : public std::runtime_error
-    {
-    public:
-      ParseError() : std::runtime_error("") {}
-    };
-
-    std::unique_ptr<Stmt> declaration();
-    std::unique_ptr<Stmt> class_declaration();
-    std::unique_ptr<Stmt> statement();
-    std::unique_ptr<Stmt> if_statement();
-    std::unique_ptr<Stmt> print_statement();
-    std::unique_ptr<Stmt> return_statement();
-    std::unique_ptr<Stmt> var_declaration();
-    std::unique_ptr<Stmt> while_statement();
-    std::unique_ptr<Stmt> for_statement();
-    std::unique_ptr<Stmt> expression_statement();
-    std::unique_ptr<Stmt> function(const std::string& kind);
-    std::vector<std::unique_ptr<Stmt>> block();
-
-    std::unique_ptr<Expr> assignment();
-    std::unique_ptr<Expr> logical_or();
-    std::unique_ptr<Expr> logical_and();
-    std::unique_ptr<Expr> expression() { return assignment(); }
-    std::unique_ptr<Expr> equality();
-    std::unique_ptr<Expr> comparison();
-    std::unique_ptr<Expr> addition();
-    std::unique_ptr<Expr> multiplication();
-    std::unique_ptr<Expr> unary();
-    std::unique_ptr<Expr> finish_call(std::unique_ptr<Expr> callee);
-    std::unique_ptr<Expr> call();
-    std::unique_ptr<Expr> primary();
+    Stmt* declaration();
+    Stmt* class_declaration();
+    Stmt* statement();
+    Stmt* if_statement();
+    Stmt* print_statement();
+    Stmt* return_statement();
+    Stmt* var_declaration();
+    Stmt* while_statement();
+    Stmt* for_statement();
+    Stmt* expression_statement();
+    Stmt* function(const std::string& kind);
+    ArenaList<Stmt*> block();
+
+    Expr* assignment();
+    Expr* logical_or();
+    Expr* logical_and();
+    Expr* expression() { return assignment(); }
+    Expr* equality();
+    Expr* comparison();
+    Expr* addition();
+    Expr* multiplication();
+    Expr* unary();
+    Expr* finish_call(Expr* callee);
+    Expr* call();
+    Expr* primary();
 
     template <typename Fn>
-    std::unique_ptr<Expr> binary(
+    Expr* binary(
         Fn fn, const std::initializer_list<TokenType>& tokens);
 
-    bool match(std::initializer_list<TokenType> types);
-    const Token& consume(const TokenType type, const std::string& message);
-    bool check(const TokenType type) const;
-    const Token& advance();
-    bool is_at_end() const;
-    const Token& peek() const;
-    const Token& previous() const;
-    ParseError error(const Token& token, const std::string& message);
-    void synchronise();
+    template <typename T, typename... Args>
+    T* make(Args&&... args)
+    { return arena_->make<T>(std::forward<Args>(args)...); }
+    template <typename T>
+    ArenaList<T> make_list(std::vector<T>& scratch, const std::size_t mark);
 
     bool in_repl_;
-    unsigned int current_;
-    std::vector<Token> tokens_;
+    Arena* arena_;
+    // Lists of nodes are accumulated on the end of these buffers while their
+    // elements are being parsed, then copied into the arena in one go. Nested
+    // lists are finished before their parents, so the buffers behave like
+    // stacks and are reused across the whole parse.
+    std::vector<Expr*> expr_scratch_;
+    std::vector<Stmt*> stmt_scratch_;
+    std::vector<Function*> method_scratch_;
+    std::vector<Token> token_scratch_;
   };
 
 
   template<typename Fn>
-  std::unique_ptr<Expr> Parser::binary(
+  Expr* Parser::binary(
       Fn fn, const std::initializer_list<TokenType>& tokens)
   {
     auto expr = fn();
@@ -109,11 +109,22 @@ namespace loxx
     while (match(tokens)) {
       Token op = previous();
       auto right = fn();
-      expr = std::make_unique<Binary>(std::move(expr), op, std::move(right));
+      expr = make<Binary>(expr, op, right);
     }
 
     return expr;
   }
+
+
+  template <typename T>
+  ArenaList<T> Parser::make_list(std::vector<T>& scratch,
+                                 const std::size_t mark)
+  {
+    const auto list = arena_->make_list(scratch.data() + mark,
+                                        scratch.data() + scratch.size());
+    scratch.erase(scratch.begin() + mark, scratch.end());
+    return list;
+  }
 }
 
 #endif //LOXX_PARSER_HPP
@@ -0,0 +1,458 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <limits>
+
+#include "Instruction.hpp"
+#include "Object.hpp"
+#include "Peephole.hpp"
+#include "utils.hpp"
+
+
+namespace loxx
+{
+  namespace
+  {
+    constexpr std::size_t max_jump = std::numeric_limits<InstrArgUShort>::max();
+
+
+    struct Op
+    {
+      std::size_t pos;
+      std::size_t size;
+      Instruction instruction;
+      // Index of the instruction jumped to, or the number of instructions if
+      // the jump goes to the end of the bytecode.
+      std::size_t target;
+      bool live;
+    };
+
+
+    // A row of the line number table, attached to the instruction it falls
+    // within.
+    struct LineRow
+    {
+      std::size_t op;
+      std::size_t offset;
+      int line;
+    };
+
+
+    bool is_jump(const Instruction instruction)
+    {
+      return instruction == Instruction::ConditionalJump or
+             instruction == Instruction::Jump or
+             instruction == Instruction::JumpIfTrue or
+             instruction == Instruction::Loop;
+    }
+
+
+    bool is_unconditional_jump(const Instruction instruction)
+    {
+      return instruction == Instruction::Jump or
+             instruction == Instruction::Loop;
+    }
+
+
+    bool is_pure_push(const Instruction instruction)
+    {
+      switch (instruction) {
+      case Instruction::False:
+      case Instruction::GetLocal:
+      case Instruction::GetUpvalue:
+      case Instruction::LoadConstant:
+      case Instruction::Nil:
+      case Instruction::True:
+        return true;
+      default:
+        return false;
+      }
+    }
+
+
+    Instruction matching_get(const Instruction instruction)
+    {
+      switch (instruction) {
+      case Instruction::SetGlobal:
+        return Instruction::GetGlobal;
+      case Instruction::SetLocal:
+        return Instruction::GetLocal;
+      case Instruction::SetUpvalue:
+        return Instruction::GetUpvalue;
+      default:
+        return instruction;
+      }
+    }
+
+
+    class PeepholeOptimiser
+    {
+    public:
+      explicit PeepholeOptimiser(CodeObject& code_object)
+          : code_object_(&code_object)
+      {}
+
+      PeepholeStats run();
+
+    private:
+      void decode();
+      bool thread_jumps();
+      bool rewrite_sequences();
+      void encode();
+
+      std::size_t next_live(std::size_t index) const;
+      std::size_t position(const std::size_t index) const;
+      bool jump_fits(const std::size_t from, const std::size_t to) const;
+      void remove(const std::size_t index);
+      InstrArgUByte operand(const Op& op) const
+      { return code_object_->bytecode[op.pos + 1]; }
+
+      CodeObject* code_object_;
+      std::vector<Op> ops_;
+      std::vector<LineRow> line_rows_;
+      std::vector<bool> is_target_;
+    };
+
+
+    PeepholeStats PeepholeOptimiser::run()
+    {
+      if (code_object_->bytecode.empty()) {
+        return PeepholeStats{0, 0};
+      }
+
+      decode();
+
+      bool changed = true;
+      while (changed) {
+        const auto threaded = thread_jumps();
+        const auto rewritten = rewrite_sequences();
+        changed = threaded or rewritten;
+      }
+
+      std::size_t num_live = 0;
+      for (const auto& op : ops_) {
+        num_live += op.live ? 1 : 0;
+      }
+
+      const PeepholeStats stats{ops_.size(), num_live};
+
+      if (num_live != ops_.size()) {
+        encode();
+      }
+
+      return stats;
+    }
+
+
+    void PeepholeOptimiser::decode()
+    {
+      const auto& bytecode = code_object_->bytecode;
+
+      std::vector<std::size_t> op_at_pos(bytecode.size() + 1);
+      std::vector<std::size_t> target_pos;
+
+      for (std::size_t pos = 0; pos < bytecode.size();) {
+        const auto instruction = static_cast<Instruction>(bytecode[pos]);
+        const auto size = instruction_size(*code_object_, pos);
+
+        op_at_pos[pos] = ops_.size();
+        ops_.push_back(Op{pos, size, instruction, 0, true});
+
+        if (is_jump(instruction)) {
+          const auto offset =
+              read_integer_at_pos<InstrArgUShort>(bytecode.data() + pos + 1);
+          target_pos.push_back(instruction == Instruction::Loop ?
+                               pos + size - offset : pos + size + offset);
+        }
+        else {
+          target_pos.push_back(0);
+        }
+
+        pos += size;
+      }
+
+      op_at_pos[bytecode.size()] = ops_.size();
+
+      for (std::size_t i = 0; i < ops_.size(); ++i) {
+        if (is_jump(ops_[i].instruction)) {
+          ops_[i].target = op_at_pos[target_pos[i]];
+        }
+      }
+
+      // Convert the line number table to absolute positions and lines, and
+      // attach each row to the instruction it ends within.
+      std::size_t pos = 0;
+      int line = 0;
+      std::size_t op = 0;
+
+      for (const auto& row : code_object_->line_num_table) {
+        pos += std::get<1>(row);
+        line += std::get<0>(row);
+
+        while (op + 1 < ops_.size() and ops_[op].pos + ops_[op].size < pos) {
+          ++op;
+        }
+
+        line_rows_.push_back(LineRow{op, pos - ops_[op].pos, line});
+      }
+    }
+
+
+    bool PeepholeOptimiser::thread_jumps()
+    {
+      bool changed = false;
+
+      for (std::size_t i = 0; i < ops_.size(); ++i) {
+        auto& op = ops_[i];
+
+        if (not op.live or not is_jump(op.instruction)) {
+          continue;
+        }
+
+        const auto conditional = not is_unconditional_jump(op.instruction);
+        auto target = next_live(op.target);
+
+        // Bound the number of hops so that jumps that form a cycle, such as
+        // an empty infinite loop, don't hang the optimiser.
+        for (unsigned int hops = 0; hops < 16 and target < ops_.size(); ++hops) {
+          const auto& next = ops_[target];
+
+          // A conditional jump that lands on an identical conditional jump
+          // will take that one too, as the condition is still on the stack.
+          const auto follows =
+              is_unconditional_jump(next.instruction) or
+              (conditional and next.instruction == op.instruction);
+
+          if (not follows) {
+            break;
+          }
+
+          const auto destination = next_live(next.target);
+
+          // Conditional jumps can only go forwards.
+          if ((conditional and destination <= i) or
+              not jump_fits(i, destination) or destination == target) {
+            break;
+          }
+
+          target = destination;
+        }
+
+        if (target != op.target) {
+          op.target = target;
+          changed = true;
+        }
+
+        // A jump to the next instruction does nothing. Conditional jumps
+        // leave the condition on the stack either way.
+        if (target == next_live(i + 1)) {
+          remove(i);
+          changed = true;
+        }
+      }
+
+      return changed;
+    }
+
+
+    bool PeepholeOptimiser::rewrite_sequences()
+    {
+      is_target_.assign(ops_.size() + 1, false);
+
+      for (const auto& op : ops_) {
+        if (op.live and is_jump(op.instruction)) {
+          is_target_[op.target] = true;
+        }
+      }
+
+      bool changed = false;
+
+      for (std::size_t i = 0; i < ops_.size(); ++i) {
+        if (not ops_[i].live) {
+          continue;
+        }
+
+        const auto second = next_live(i + 1);
+        if (second == ops_.size() or is_target_[second]) {
+          continue;
+        }
+
+        const auto first_instr = ops_[i].instruction;
+        const auto second_instr = ops_[second].instruction;
+
+        if (is_pure_push(first_instr) and second_instr == Instruction::Pop) {
+          remove(i);
+          remove(second);
+          changed = true;
+          continue;
+        }
+
+        if (first_instr == Instruction::Not and
+            (second_instr == Instruction::ConditionalJump or
+             second_instr == Instruction::JumpIfTrue)) {
+          // The jump leaves the negated condition on the stack, so this is
+          // only valid if it's discarded on both paths, as it is for if
+          // statements and while loops.
+          const auto fallthrough = next_live(second + 1);
+          const auto target = ops_[second].target;
+
+          if (fallthrough < ops_.size() and target < ops_.size() and
+              ops_[fallthrough].instruction == Instruction::Pop and
+              ops_[target].instruction == Instruction::Pop) {
+            ops_[second].instruction =
+                second_instr == Instruction::ConditionalJump ?
+                Instruction::JumpIfTrue : Instruction::ConditionalJump;
+            remove(i);
+            changed = true;
+          }
+          continue;
+        }
+
+        if (matching_get(first_instr) != first_instr and
+            second_instr == Instruction::Pop) {
+          const auto third = next_live(second + 1);
+
+          if (third < ops_.size() and not is_target_[third] and
+              ops_[third].instruction == matching_get(first_instr) and
+              operand(ops_[third]) == operand(ops_[i])) {
+            remove(second);
+            remove(third);
+            changed = true;
+          }
+        }
+      }
+
+      return changed;
+    }
+
+
+    void PeepholeOptimiser::encode()
+    {
+      const auto& old_bytecode = code_object_->bytecode;
+
+      std::vector<std::size_t> new_pos(ops_.size() + 1);
+      std::size_t size = 0;
+
+      for (std::size_t i = 0; i < ops_.size(); ++i) {
+        new_pos[i] = size;
+        size += ops_[i].live ? ops_[i].size : 0;
+      }
+      new_pos[ops_.size()] = size;
+
+      std::vector<std::uint8_t> bytecode;
+      bytecode.reserve(size);
+
+      for (std::size_t i = 0; i < ops_.size(); ++i) {
+        const auto& op = ops_[i];
+
+        if (not op.live) {
+          continue;
+        }
+
+        if (not is_jump(op.instruction)) {
+          bytecode.push_back(static_cast<std::uint8_t>(op.instruction));
+          bytecode.insert(bytecode.end(), old_bytecode.begin() + op.pos + 1,
+                          old_bytecode.begin() + op.pos + op.size);
+          continue;
+        }
+
+        // Threading may have turned a loop into a forward jump or vice versa.
+        const auto end = new_pos[i] + op.size;
+        const auto target = new_pos[next_live(op.target)];
+        const auto backwards = target < end;
+
+        auto instruction = op.instruction;
+        if (is_unconditional_jump(instruction)) {
+          instruction = backwards ? Instruction::Loop : Instruction::Jump;
+        }
+
+        const auto offset = static_cast<InstrArgUShort>(
+            backwards ? end - target : target - end);
+        const auto offset_ptr = reinterpret_cast<const std::uint8_t*>(&offset);
+
+        bytecode.push_back(static_cast<std::uint8_t>(instruction));
+        bytecode.insert(bytecode.end(), offset_ptr,
+                        offset_ptr + sizeof(InstrArgUShort));
+      }
+
+      code_object_->bytecode = std::move(bytecode);
+
+      // Rows belonging to removed instructions are moved to the end of the
+      // preceding instruction. Lookups take the first row at or beyond a
+      // position, so earlier instructions still map to the same lines.
+      code_object_->line_num_table.clear();
+
+      std::size_t last_pos = 0;
+      int last_line = 0;
+
+      for (const auto& row : line_rows_) {
+        const auto pos =
+            new_pos[row.op] + (ops_[row.op].live ? row.offset : 0);
+        code_object_->add_line_num_row(row.line - last_line, pos - last_pos);
+        last_pos = pos;
+        last_line = row.line;
+      }
+    }
+
+
+    std::size_t PeepholeOptimiser::next_live(std::size_t index) const
+    {
+      while (index < ops_.size() and not ops_[index].live) {
+        ++index;
+      }
+      return index;
+    }
+
+
+    std::size_t PeepholeOptimiser::position(const std::size_t index) const
+    {
+      return index < ops_.size() ?
+             ops_[index].pos : code_object_->bytecode.size();
+    }
+
+
+    bool PeepholeOptimiser::jump_fits(const std::size_t from,
+                                      const std::size_t to) const
+    {
+      // Removing instructions only ever shortens the distance between two
+      // others, so checking against the original positions is enough.
+      const auto end = position(from) + ops_[from].size;
+      const auto target = position(to);
+      return target >= end ? target - end <= max_jump : end - target < max_jump;
+    }
+
+
+    void PeepholeOptimiser::remove(const std::size_t index)
+    {
+      ops_[index].live = false;
+
+      // Anything that jumped here now lands on the next instruction.
+      if (not is_target_.empty() and is_target_[index]) {
+        is_target_[next_live(index)] = true;
+      }
+    }
+  }
+
+
+  PeepholeStats optimise_bytecode(CodeObject& code_object)
+  {
+    PeepholeOptimiser optimiser(code_object);
+    return optimiser.run();
+  }
+}
@@ -0,0 +1,54 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_PEEPHOLE_HPP
+#define LOXX_PEEPHOLE_HPP
+
+#include <cstddef>
+
+#include "CodeObject.hpp"
+
+
+namespace loxx
+{
+  struct PeepholeStats
+  {
+    std::size_t instructions_before;
+    std::size_t instructions_after;
+  };
+
+
+  // Rewrites short, wasteful sequences of instructions in a finished code
+  // object, then reassembles the bytecode with jump offsets and the line
+  // number table adjusted to match. The rewrites are:
+  //
+  // - Jumps to unconditional jumps go straight to the final destination, as
+  //   do conditional jumps to an identical conditional jump. Jumps to the
+  //   next instruction are removed.
+  // - NOT followed by CONDITIONAL_JUMP becomes JUMP_IF_TRUE, provided both
+  //   destinations discard the condition straight away.
+  // - A push of a constant or variable that's immediately popped is removed.
+  // - Storing a variable, popping it and loading it again is reduced to the
+  //   store, which leaves the value on the stack anyway.
+  //
+  // Nothing is rewritten across a jump target.
+  PeepholeStats optimise_bytecode(CodeObject& code_object);
+}
+
+#endif //LOXX_PEEPHOLE_HPP
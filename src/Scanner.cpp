@@ -17,50 +17,37 @@
  * Created by Matt Spraggs on 31/10/17.
  */
 
+#include <cstring>
+
+#include "CharClass.hpp"
 #include "globals.hpp"
 #include "logging.hpp"
 #include "Scanner.hpp"
 #include "ObjectTracker.hpp"
-
-#include <cctype>
+#include "SimdScan.hpp"
 
 
 namespace loxx
 {
-
   Scanner::Scanner(std::string src)
       : start_(0), current_(0), line_(1), src_(std::move(src))
   {
-    keywords_ =
-        {{"and",    TokenType::And},
-         {"class",  TokenType::Class},
-         {"else",   TokenType::Else},
-         {"false",  TokenType::False},
-         {"for",    TokenType::For},
-         {"fun",    TokenType::Fun},
-         {"if",     TokenType::If},
-         {"nil",    TokenType::Nil},
-         {"or",     TokenType::Or},
-         {"print",  TokenType::Print},
-         {"return", TokenType::Return},
-         {"super",  TokenType::Super},
-         {"this",   TokenType::This},
-         {"true",   TokenType::True},
-         {"var",    TokenType::Var},
-         {"while",  TokenType::While}
-        };
   }
 
 
-  const std::vector<Token>& Scanner::scan_tokens()
+  std::vector<Token> Scanner::scan_tokens()
   {
+    // A rough guess at the number of tokens, based on typical code, to avoid
+    // repeatedly copying tokens as the vector grows.
+    tokens_.reserve(src_.size() / 4);
+
     while (not is_at_end()) {
       start_ = current_;
       scan_token();
     }
 
-    tokens_.emplace_back(TokenType::Eof, "", line_);
-    return tokens_;
+    tokens_.emplace_back(TokenType::Eof, symbols::empty, line_);
+    return std::move(tokens_);
   }
 
 
@@ -112,19 +99,17 @@ namespace loxx
     }
     else if (c == '/') {
       if (match('/')) {
-        while (peek() != '\n' and not is_at_end()) {
-          advance();
-        }
+        skip_to(scan::find_line_end(cursor(), src_end()));
       }
       else {
         add_token(TokenType::Slash);
       }
     }
-    else if (c == ' ' or c == '\r' or c == '\t') {
-
-    }
-    else if (c == '\n') {
-      line_ += 1;
+    else if (c == ' ' or c == '\r' or c == '\t' or c == '\n') {
+      line_ += c == '\n' ? 1 : 0;
+      // Whitespace tends to come in runs (indentation especially), so skip
+      // over the rest of it in one go.
+      skip_to(scan::skip_whitespace(cursor(), src_end(), line_));
     }
     else if (c == '"') {
       string();
@@ -143,34 +128,90 @@ namespace loxx
 
   void Scanner::identifier()
   {
-    while (is_alpha_numeric(peek())) {
-      advance();
-    }
+    skip_to(scan::find_identifier_end(cursor(), src_end()));
 
-    const auto text = src_.substr(start_, current_ - start_);
-    const TokenType type =
-        keywords_.count(text) == 0 ? TokenType::Identifier : keywords_[text];
-    if (type == TokenType::True) {
-      add_token(type, true);
+    const auto type = identifier_type();
+
+    if (type == TokenType::Identifier) {
+      add_token(type);
+    }
+    else if (type == TokenType::True) {
+      tokens_.emplace_back(type, keyword_symbol(type), true, line_);
     }
     else if (type == TokenType::False) {
-      add_token(type, false);
+      tokens_.emplace_back(type, keyword_symbol(type), false, line_);
     }
     else {
-      add_token(type);
+      // Keywords are interned up front, so there's no need to look them up in
+      // the symbol table.
+      tokens_.emplace_back(type, keyword_symbol(type), line_);
     }
   }
 
 
-  void Scanner::string()
+  TokenType Scanner::identifier_type() const
   {
-    while (peek() != '"' and not is_at_end()) {
-      if (peek() == '\n') {
-        line_ += 1;
+    // This is a hand-rolled trie over the keywords: the first character (and
+    // the second where it's ambiguous) decides which keyword is a candidate,
+    // and the remainder is checked with a single comparison.
+    const auto length = current_ - start_;
+    const char* lexeme = src_.data() + start_;
+
+    switch (lexeme[0]) {
+    case 'a': return check_keyword(1, "nd", 2, TokenType::And);
+    case 'c': return check_keyword(1, "lass", 4, TokenType::Class);
+    case 'e': return check_keyword(1, "lse", 3, TokenType::Else);
+    case 'f':
+      if (length > 1) {
+        switch (lexeme[1]) {
+        case 'a': return check_keyword(2, "lse", 3, TokenType::False);
+        case 'o': return check_keyword(2, "r", 1, TokenType::For);
+        case 'u': return check_keyword(2, "n", 1, TokenType::Fun);
+        default: break;
+        }
       }
-      advance();
+      break;
+    case 'i': return check_keyword(1, "f", 1, TokenType::If);
+    case 'n': return check_keyword(1, "il", 2, TokenType::Nil);
+    case 'o': return check_keyword(1, "r", 1, TokenType::Or);
+    case 'p': return check_keyword(1, "rint", 4, TokenType::Print);
+    case 'r': return check_keyword(1, "eturn", 5, TokenType::Return);
+    case 's': return check_keyword(1, "uper", 4, TokenType::Super);
+    case 't':
+      if (length > 1) {
+        switch (lexeme[1]) {
+        case 'h': return check_keyword(2, "is", 2, TokenType::This);
+        case 'r': return check_keyword(2, "ue", 2, TokenType::True);
+        default: break;
+        }
+      }
+      break;
+    case 'v': return check_keyword(1, "ar", 2, TokenType::Var);
+    case 'w': return check_keyword(1, "hile", 4, TokenType::While);
+    default: break;
     }
 
+    return TokenType::Identifier;
+  }
+
+
+  TokenType Scanner::check_keyword(
+      const unsigned int offset, const char* rest, const unsigned int length,
+      const TokenType type) const
+  {
+    if (current_ - start_ == offset + length and
+        std::memcmp(src_.data() + start_ + offset, rest, length) == 0) {
+      return type;
+    }
+
+    return TokenType::Identifier;
+  }
+
+
+  void Scanner::string()
+  {
+    skip_to(scan::find_string_end(cursor(), src_end(), line_));
+
     if (is_at_end()) {
       error(line_, "Unterminated string.");
     }
@@ -250,14 +291,19 @@ namespace loxx
 
   void Scanner::add_token(const TokenType type)
   {
-    auto substr = src_.substr(start_, current_ - start_);
-    tokens_.emplace_back(type, substr, line_);
+    tokens_.emplace_back(type, make_symbol(), line_);
   }
 
 
   void Scanner::add_token(const TokenType type, Value literal)
   {
-    auto substr = src_.substr(start_, current_ - start_);
-    tokens_.emplace_back(type, substr, std::move(literal), line_);
+    tokens_.emplace_back(type, make_symbol(), std::move(literal), line_);
+  }
+
+
+  Symbol Scanner::make_symbol() const
+  {
+    return SymbolTable::instance().intern(src_.data() + start_,
+                                          current_ - start_);
   }
 }
@@ -22,7 +22,6 @@
 #define LOXX_SCANNER_HPP
 
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "Token.hpp"
@@ -35,7 +34,7 @@ namespace loxx
   public:
     explicit Scanner(std::string src);
 
-    const std::vector<Token>& scan_tokens();
+    std::vector<Token> scan_tokens();
 
   private:
     void scan_token();
@@ -48,21 +47,25 @@ namespace loxx
     char peek() const;
     char peek_next() const;
 
-    bool is_alpha(const char c) const { return isalpha(c) != 0   or c == '_'; }
-    bool is_digit(const char c) const { return isdigit(c) != 0; }
-    bool is_alpha_numeric(const char c) const
-    { return is_alpha(c) or is_digit(c); }
+    TokenType identifier_type() const;
+    TokenType check_keyword(const unsigned int offset, const char* rest,
+                            const unsigned int length,
+                            const TokenType type) const;
+
     bool is_at_end() const { return current_ >= src_.size(); }
+    const char* cursor() const { return src_.data() + current_; }
+    const char* src_end() const { return src_.data() + src_.size(); }
+    void skip_to(const char* pos)
+    { current_ = static_cast<unsigned int>(pos - src_.data()); }
     char advance();
     void add_token(const TokenType type);
     void add_token(const TokenType type, Value literal);
+    Symbol make_symbol() const;
 
     unsigned int start_, current_, line_;
 
     std::string src_;
     std::vector<Token> tokens_;
-
-    std::unordered_map<std::string, TokenType> keywords_;
   };
 }
 
@@ -0,0 +1,386 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <cstdint>
+
+#include "CharClass.hpp"
+#include "SimdScan.hpp"
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__)) and \
+    defined(__SSE2__)
+#define LOXX_SIMD_SCAN_X86
+#include <immintrin.h>
+#endif
+
+
+namespace loxx
+{
+  namespace scan
+  {
+    namespace
+    {
+      inline bool is_whitespace(const char c)
+      {
+        return c == ' ' or c == '\t' or c == '\r' or c == '\n';
+      }
+
+
+      const char* skip_whitespace_scalar(
+          const char* begin, const char* end, unsigned int& lines)
+      {
+        while (begin != end and is_whitespace(*begin)) {
+          lines += *begin == '\n' ? 1 : 0;
+          ++begin;
+        }
+        return begin;
+      }
+
+
+      const char* find_line_end_scalar(const char* begin, const char* end)
+      {
+        while (begin != end and *begin != '\n') {
+          ++begin;
+        }
+        return begin;
+      }
+
+
+      const char* find_string_end_scalar(
+          const char* begin, const char* end, unsigned int& lines)
+      {
+        while (begin != end and *begin != '"') {
+          lines += *begin == '\n' ? 1 : 0;
+          ++begin;
+        }
+        return begin;
+      }
+
+
+      const char* find_identifier_end_scalar(
+          const char* begin, const char* end)
+      {
+        while (begin != end and is_identifier_char(*begin)) {
+          ++begin;
+        }
+        return begin;
+      }
+
+
+#ifdef LOXX_SIMD_SCAN_X86
+      inline unsigned int count_bits(const std::uint32_t mask)
+      {
+        return static_cast<unsigned int>(__builtin_popcount(mask));
+      }
+
+
+      inline unsigned int first_bit(const std::uint32_t mask)
+      {
+        return static_cast<unsigned int>(__builtin_ctz(mask));
+      }
+
+
+      // Mask of the bits below the given bit position.
+      inline std::uint32_t bits_below(const unsigned int pos)
+      {
+        return pos >= 32 ? ~0u : (1u << pos) - 1;
+      }
+
+
+      // SSE2 is part of the x86-64 baseline, so these need no runtime check.
+
+      inline std::uint32_t whitespace_mask_sse2(
+          const __m128i chunk, std::uint32_t& newlines)
+      {
+        const auto nl = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+        const auto ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r')), nl));
+        newlines = static_cast<std::uint32_t>(_mm_movemask_epi8(nl));
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(ws));
+      }
+
+
+      const char* skip_whitespace_sse2(
+          const char* begin, const char* end, unsigned int& lines)
+      {
+        while (end - begin >= 16) {
+          const auto chunk =
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+          std::uint32_t newlines = 0;
+          const auto other = ~whitespace_mask_sse2(chunk, newlines) & 0xffff;
+
+          if (other != 0) {
+            const auto pos = first_bit(other);
+            lines += count_bits(newlines & bits_below(pos));
+            return begin + pos;
+          }
+
+          lines += count_bits(newlines);
+          begin += 16;
+        }
+
+        return skip_whitespace_scalar(begin, end, lines);
+      }
+
+
+      const char* find_line_end_sse2(const char* begin, const char* end)
+      {
+        const auto newline = _mm_set1_epi8('\n');
+
+        while (end - begin >= 16) {
+          const auto chunk =
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+          const auto mask = static_cast<std::uint32_t>(
+              _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+
+          if (mask != 0) {
+            return begin + first_bit(mask);
+          }
+
+          begin += 16;
+        }
+
+        return find_line_end_scalar(begin, end);
+      }
+
+
+      const char* find_string_end_sse2(
+          const char* begin, const char* end, unsigned int& lines)
+      {
+        const auto quote = _mm_set1_epi8('"');
+        const auto newline = _mm_set1_epi8('\n');
+
+        while (end - begin >= 16) {
+          const auto chunk =
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+          const auto quotes = static_cast<std::uint32_t>(
+              _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote)));
+          const auto newlines = static_cast<std::uint32_t>(
+              _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+
+          if (quotes != 0) {
+            const auto pos = first_bit(quotes);
+            lines += count_bits(newlines & bits_below(pos));
+            return begin + pos;
+          }
+
+          lines += count_bits(newlines);
+          begin += 16;
+        }
+
+        return find_string_end_scalar(begin, end, lines);
+      }
+
+
+      inline __m128i in_range_sse2(const __m128i chunk, const char lo,
+                                   const char hi)
+      {
+        // Signed comparisons are fine here because all the ranges we're
+        // interested in lie within ASCII.
+        return _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8(lo - 1)),
+                             _mm_cmplt_epi8(chunk, _mm_set1_epi8(hi + 1)));
+      }
+
+
+      const char* find_identifier_end_sse2(const char* begin, const char* end)
+      {
+        while (end - begin >= 16) {
+          const auto chunk =
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+          const auto ident = _mm_or_si128(
+              _mm_or_si128(in_range_sse2(chunk, 'a', 'z'),
+                           in_range_sse2(chunk, 'A', 'Z')),
+              _mm_or_si128(in_range_sse2(chunk, '0', '9'),
+                           _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'))));
+          const auto other =
+              ~static_cast<std::uint32_t>(_mm_movemask_epi8(ident)) & 0xffff;
+
+          if (other != 0) {
+            return begin + first_bit(other);
+          }
+
+          begin += 16;
+        }
+
+        return find_identifier_end_scalar(begin, end);
+      }
+
+
+      __attribute__((target("avx2")))
+      const char* skip_whitespace_avx2(
+          const char* begin, const char* end, unsigned int& lines)
+      {
+        while (end - begin >= 32) {
+          const auto chunk =
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+          const auto nl = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n'));
+          const auto ws = _mm256_or_si256(
+              _mm256_or_si256(
+                  _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                  _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+              _mm256_or_si256(
+                  _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r')), nl));
+          const auto newlines =
+              static_cast<std::uint32_t>(_mm256_movemask_epi8(nl));
+          const auto other =
+              ~static_cast<std::uint32_t>(_mm256_movemask_epi8(ws));
+
+          if (other != 0) {
+            const auto pos = first_bit(other);
+            lines += count_bits(newlines & bits_below(pos));
+            return begin + pos;
+          }
+
+          lines += count_bits(newlines);
+          begin += 32;
+        }
+
+        return skip_whitespace_sse2(begin, end, lines);
+      }
+
+
+      __attribute__((target("avx2")))
+      const char* find_line_end_avx2(const char* begin, const char* end)
+      {
+        const auto newline = _mm256_set1_epi8('\n');
+
+        while (end - begin >= 32) {
+          const auto chunk =
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+          const auto mask = static_cast<std::uint32_t>(
+              _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+
+          if (mask != 0) {
+            return begin + first_bit(mask);
+          }
+
+          begin += 32;
+        }
+
+        return find_line_end_sse2(begin, end);
+      }
+
+
+      __attribute__((target("avx2")))
+      const char* find_string_end_avx2(
+          const char* begin, const char* end, unsigned int& lines)
+      {
+        const auto quote = _mm256_set1_epi8('"');
+        const auto newline = _mm256_set1_epi8('\n');
+
+        while (end - begin >= 32) {
+          const auto chunk =
+              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+          const auto quotes = static_cast<std::uint32_t>(
+              _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quote)));
+          const auto newlines = static_cast<std::uint32_t>(
+              _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+
+          if (quotes != 0) {
+            const auto pos = first_bit(quotes);
+            lines += count_bits(newlines & bits_below(pos));
+            return begin + pos;
+          }
+
+          lines += count_bits(newlines);
+          begin += 32;
+        }
+
+        return find_string_end_sse2(begin, end, lines);
+      }
+#endif
+
+
+      struct ScanImpl
+      {
+        const char* (*skip_whitespace)(const char*, const char*,
+                                       unsigned int&);
+        const char* (*find_line_end)(const char*, const char*);
+        const char* (*find_string_end)(const char*, const char*,
+                                       unsigned int&);
+        const char* (*find_identifier_end)(const char*, const char*);
+        const char* name;
+      };
+
+
+      ScanImpl select_impl()
+      {
+#ifdef LOXX_SIMD_SCAN_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2")) {
+          // Identifiers are typically short, so the 16-byte SSE2 version is
+          // used for them even when AVX2 is available.
+          return ScanImpl{skip_whitespace_avx2, find_line_end_avx2,
+                          find_string_end_avx2, find_identifier_end_sse2,
+                          "avx2"};
+        }
+
+        return ScanImpl{skip_whitespace_sse2, find_line_end_sse2,
+                        find_string_end_sse2, find_identifier_end_sse2,
+                        "sse2"};
+#else
+        return ScanImpl{skip_whitespace_scalar, find_line_end_scalar,
+                        find_string_end_scalar, find_identifier_end_scalar,
+                        "scalar"};
+#endif
+      }
+
+
+      const ScanImpl& impl()
+      {
+        static const ScanImpl ret = select_impl();
+        return ret;
+      }
+    }
+
+
+    const char* skip_whitespace(const char* begin, const char* end,
+                                unsigned int& lines)
+    {
+      return impl().skip_whitespace(begin, end, lines);
+    }
+
+
+    const char* find_line_end(const char* begin, const char* end)
+    {
+      return impl().find_line_end(begin, end);
+    }
+
+
+    const char* find_string_end(const char* begin, const char* end,
+                                unsigned int& lines)
+    {
+      return impl().find_string_end(begin, end, lines);
+    }
+
+
+    const char* find_identifier_end(const char* begin, const char* end)
+    {
+      return impl().find_identifier_end(begin, end);
+    }
+
+
+    const char* implementation_name()
+    {
+      return impl().name;
+    }
+  }
+}
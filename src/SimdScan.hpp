@@ -0,0 +1,57 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_SIMDSCAN_HPP
+#define LOXX_SIMDSCAN_HPP
+
+#include <cstddef>
+
+
+namespace loxx
+{
+  namespace scan
+  {
+    // Each of these functions scans the range [begin, end) and returns a
+    // pointer to the first character that ends the run being scanned, or end
+    // if no such character exists. Where a run may span several lines, the
+    // number of newlines skipped over is added to lines.
+    //
+    // An SSE2 or AVX2 implementation is used where the CPU supports it, with
+    // a scalar fallback for everything else.
+
+    // Skips spaces, tabs, carriage returns and newlines.
+    const char* skip_whitespace(const char* begin, const char* end,
+                                unsigned int& lines);
+
+    // Finds the newline that terminates a line comment.
+    const char* find_line_end(const char* begin, const char* end);
+
+    // Finds the double quote that terminates a string literal.
+    const char* find_string_end(const char* begin, const char* end,
+                                unsigned int& lines);
+
+    // Finds the first character that can't appear in an identifier.
+    const char* find_identifier_end(const char* begin, const char* end);
+
+    // The name of the implementation selected at runtime.
+    const char* implementation_name();
+  }
+}
+
+#endif //LOXX_SIMDSCAN_HPP
@@ -0,0 +1,564 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include "logging.hpp"
+#include "ObjectTracker.hpp"
+#include "SinglePassCompiler.hpp"
+
+
+namespace loxx
+{
+  void SinglePassCompiler::compile()
+  {
+    ErrorBuffer errors;
+    auto& tracker = ObjectTracker::instance();
+    tracker.pause_gc();
+
+    while (not is_at_end()) {
+      declaration();
+    }
+
+    func_->add_instruction(Instruction::Return);
+    tracker.resume_gc();
+
+    errors.flush();
+  }
+
+
+  void SinglePassCompiler::declaration()
+  {
+    const auto state = save_state();
+
+    try {
+      if (match({TokenType::Class})) {
+        class_declaration();
+      }
+      else if (match({TokenType::Fun})) {
+        function_declaration();
+      }
+      else if (match({TokenType::Var})) {
+        var_declaration();
+      }
+      else {
+        statement();
+      }
+    }
+    catch (const ParseError& e) {
+      restore_state(state);
+      synchronise();
+    }
+  }
+
+
+  void SinglePassCompiler::class_declaration()
+  {
+    const auto name = consume(TokenType::Identifier, "Expected class name.");
+
+    const auto has_superclass = match({TokenType::Less});
+    const auto class_type_old = begin_class(has_superclass);
+
+    if (has_superclass) {
+      const auto superclass =
+          consume(TokenType::Identifier, "Expected superclass name.");
+      handle_variable_reference(superclass, false);
+    }
+
+    consume(TokenType::LeftBrace, "Expected '{' before class body.");
+
+    const auto name_constant = create_class(name, has_superclass);
+
+    while (not check(TokenType::RightBrace) and not is_at_end()) {
+      const auto method =
+          consume(TokenType::Identifier, "Expected method name.");
+      const auto method_constant = func_->add_string_constant(method.symbol());
+      function(method, method_type(method), "method");
+      create_method(method, method_constant);
+    }
+
+    consume(TokenType::RightBrace, "Expected '}' after class body.");
+
+    end_class(name, name_constant, has_superclass, class_type_old);
+  }
+
+
+  void SinglePassCompiler::function_declaration()
+  {
+    const auto name =
+        consume(TokenType::Identifier, "Expected function name.");
+
+    const auto arg = declare_variable(name);
+    function(name, FunctionType::Function, "function");
+    define_variable(arg, name);
+  }
+
+
+  void SinglePassCompiler::var_declaration()
+  {
+    const auto name = consume(TokenType::Identifier, "Expected variable name.");
+
+    const auto arg = declare_variable(name);
+
+    if (match({TokenType::Equal})) {
+      expression();
+    }
+    else {
+      func_->add_instruction(Instruction::Nil);
+    }
+
+    consume(TokenType::SemiColon, "Expected ';' after variable declaration.");
+    define_variable(arg, name);
+  }
+
+
+  void SinglePassCompiler::statement()
+  {
+    if (match({TokenType::If})) {
+      if_statement();
+    }
+    else if (match({TokenType::Print})) {
+      print_statement();
+    }
+    else if (match({TokenType::Return})) {
+      return_statement();
+    }
+    else if (match({TokenType::LeftBrace})) {
+      func_->begin_scope();
+      block();
+      func_->end_scope();
+    }
+    else if (match({TokenType::While})) {
+      while_statement();
+    }
+    else if (match({TokenType::For})) {
+      for_statement();
+    }
+    else {
+      expression_statement();
+    }
+  }
+
+
+  void SinglePassCompiler::if_statement()
+  {
+    consume(TokenType::LeftParen, "Expected '(' after 'if'.");
+    expression();
+    consume(TokenType::RightParen, "Expected ')' after condition.");
+
+    const auto first_jump_pos = func_->add_jump(Instruction::ConditionalJump);
+
+    func_->add_instruction(Instruction::Pop);
+
+    statement();
+
+    const auto second_jump_pos = func_->add_jump(Instruction::Jump);
+
+    func_->patch_jump(first_jump_pos);
+
+    func_->add_instruction(Instruction::Pop);
+
+    if (match({TokenType::Else})) {
+      statement();
+    }
+
+    func_->patch_jump(second_jump_pos);
+  }
+
+
+  void SinglePassCompiler::print_statement()
+  {
+    expression();
+    consume(TokenType::SemiColon, "Expect ';' after value.");
+
+    func_->add_instruction(Instruction::Print);
+  }
+
+
+  void SinglePassCompiler::return_statement()
+  {
+    const auto keyword = previous();
+    const auto has_value = not check(TokenType::SemiColon);
+
+    check_return(keyword, has_value);
+
+    if (has_value and func_->type() == FunctionType::Initialiser) {
+      // The AST compiler never generates code for a value returned from an
+      // initialiser, so any errors it contains are hidden here too.
+      ErrorBuffer value_errors;
+      expression();
+    }
+    else if (has_value) {
+      expression();
+    }
+
+    consume(TokenType::SemiColon, "Expected ';' after return value.");
+
+    compile_return(keyword, has_value);
+  }
+
+
+  void SinglePassCompiler::while_statement()
+  {
+    const auto first_label_pos = func_->current_bytecode_size();
+
+    consume(TokenType::LeftParen, "Expected '(' after 'while'.");
+    expression();
+    consume(TokenType::RightParen, "Expected ')' after condition.");
+
+    const auto first_jump_pos = func_->add_jump(Instruction::ConditionalJump);
+    func_->add_instruction(Instruction::Pop);
+
+    statement();
+
+    func_->add_loop(Instruction::Loop, first_label_pos);
+
+    func_->patch_jump(first_jump_pos);
+    func_->add_instruction(Instruction::Pop);
+  }
+
+
+  void SinglePassCompiler::for_statement()
+  {
+    // The increment clause comes before the loop body in the source, but has
+    // to run after it, so the loop is laid out like this:
+    //
+    // initialiser
+    // begin: <- loop_start
+    // if (not condition) goto end
+    // goto body
+    // increment: <- increment_start
+    // increment
+    // goto begin
+    // body:
+    // ...
+    // goto increment
+    // end:
+    consume(TokenType::LeftParen, "Expected '(' after 'for'.");
+
+    const auto has_initialiser = not match({TokenType::SemiColon});
+
+    if (has_initialiser) {
+      func_->begin_scope();
+
+      if (match({TokenType::Var})) {
+        var_declaration();
+      }
+      else {
+        expression_statement();
+      }
+    }
+
+    auto loop_start = func_->current_bytecode_size();
+
+    if (not check(TokenType::SemiColon)) {
+      expression();
+    }
+    else {
+      func_->add_instruction(Instruction::True);
+    }
+    consume(TokenType::SemiColon, "Expected ';' after for-loop condition.");
+
+    const auto exit_jump_pos = func_->add_jump(Instruction::ConditionalJump);
+    func_->add_instruction(Instruction::Pop);
+
+    if (not check(TokenType::RightParen)) {
+      const auto body_jump_pos = func_->add_jump(Instruction::Jump);
+      const auto increment_start = func_->current_bytecode_size();
+
+      expression();
+      func_->add_instruction(Instruction::Pop);
+
+      func_->add_loop(Instruction::Loop, loop_start);
+      loop_start = increment_start;
+      func_->patch_jump(body_jump_pos);
+    }
+    consume(TokenType::RightParen, "Expected ')' after for-loop clauses.");
+
+    statement();
+
+    func_->add_loop(Instruction::Loop, loop_start);
+
+    func_->patch_jump(exit_jump_pos);
+    func_->add_instruction(Instruction::Pop);
+
+    if (has_initialiser) {
+      func_->end_scope();
+    }
+  }
+
+
+  void SinglePassCompiler::expression_statement()
+  {
+    expression();
+    consume(TokenType::SemiColon, "Expected ';' after expression.");
+    func_->add_instruction(Instruction::Pop);
+  }
+
+
+  void SinglePassCompiler::block()
+  {
+    while (not check(TokenType::RightBrace) and not is_at_end()) {
+      declaration();
+    }
+
+    consume(TokenType::RightBrace, "Expected '}' after block.");
+  }
+
+
+  void SinglePassCompiler::function(const Token& name, const FunctionType type,
+                                    const std::string& kind)
+  {
+    consume(TokenType::LeftParen, "Expected '(' after " + kind + " name.");
+
+    begin_function(name, type);
+
+    unsigned int num_parameters = 0;
+
+    if (not check(TokenType::RightParen)) {
+      do {
+        if (num_parameters >= 8) {
+          error(peek(), "Cannot have more than eight function parameters.");
+        }
+        compile_parameter(consume(TokenType::Identifier,
+                                  "Expected parameter name."));
+        ++num_parameters;
+      } while (match({TokenType::Comma}));
+    }
+    consume(TokenType::RightParen, "Expected ')' after parameters.");
+
+    consume(TokenType::LeftBrace, "Expected '{' before " + kind + " body.");
+    block();
+
+    end_function(name, num_parameters);
+  }
+
+
+  void SinglePassCompiler::assignment()
+  {
+    logical_or(true);
+
+    // Valid assignment targets consume the '=' themselves, so finding one here
+    // means the left hand side wasn't something that can be assigned to.
+    if (match({TokenType::Equal})) {
+      const auto equals = previous();
+      assignment();
+
+      error(equals, "Invalid assignment target.");
+    }
+  }
+
+
+  void SinglePassCompiler::logical_or(const bool can_assign)
+  {
+    logical_and(can_assign);
+
+    while (match({TokenType::Or})) {
+      const auto first_jump_pos = func_->add_jump(Instruction::ConditionalJump);
+      const auto second_jump_pos = func_->add_jump(Instruction::Jump);
+      func_->patch_jump(first_jump_pos);
+      func_->add_instruction(Instruction::Pop);
+      logical_and(false);
+      func_->patch_jump(second_jump_pos);
+    }
+  }
+
+
+  void SinglePassCompiler::logical_and(const bool can_assign)
+  {
+    equality(can_assign);
+
+    while (match({TokenType::And})) {
+      const auto first_jump_pos = func_->add_jump(Instruction::ConditionalJump);
+      func_->add_instruction(Instruction::Pop);
+      equality(false);
+      func_->patch_jump(first_jump_pos);
+    }
+  }
+
+
+  void SinglePassCompiler::equality(const bool can_assign)
+  {
+    binary([this] (const bool assign) { comparison(assign); }, can_assign,
+           {TokenType::BangEqual, TokenType::EqualEqual});
+  }
+
+
+  void SinglePassCompiler::comparison(const bool can_assign)
+  {
+    binary([this] (const bool assign) { addition(assign); }, can_assign,
+           {TokenType::Greater, TokenType::GreaterEqual,
+            TokenType::Less, TokenType::LessEqual});
+  }
+
+
+  void SinglePassCompiler::addition(const bool can_assign)
+  {
+    binary([this] (const bool assign) { multiplication(assign); }, can_assign,
+           {TokenType::Minus, TokenType::Plus});
+  }
+
+
+  void SinglePassCompiler::multiplication(const bool can_assign)
+  {
+    binary([this] (const bool assign) { unary(assign); }, can_assign,
+           {TokenType::Slash, TokenType::Star});
+  }
+
+
+  void SinglePassCompiler::unary(const bool can_assign)
+  {
+    if (match({TokenType::Bang, TokenType::Minus})) {
+      const Token op = previous();
+      unary(false);
+      compile_unary_op(op);
+      return;
+    }
+
+    call(can_assign);
+  }
+
+
+  void SinglePassCompiler::call(const bool can_assign)
+  {
+    primary(can_assign);
+
+    while (true) {
+      if (match({TokenType::LeftParen})) {
+        const auto num_args = arguments();
+        compile_call(previous(), num_args);
+      }
+      else if (match({TokenType::Dot})) {
+        const auto name = consume(TokenType::Identifier,
+                                  "Expected property name after '.'.");
+
+        if (can_assign and match({TokenType::Equal})) {
+          assignment();
+          compile_property_reference(name, true);
+          return;
+        }
+        else if (match({TokenType::LeftParen})) {
+          const auto num_args = arguments();
+          compile_invoke(name, previous(), num_args);
+        }
+        else {
+          compile_property_reference(name, false);
+        }
+      }
+      else {
+        break;
+      }
+    }
+  }
+
+
+  void SinglePassCompiler::primary(const bool can_assign)
+  {
+    if (match({TokenType::False})) {
+      compile_literal(Value(InPlace<bool>(), false), previous().symbol());
+      return;
+    }
+    if (match({TokenType::True})) {
+      compile_literal(Value(InPlace<bool>(), true), previous().symbol());
+      return;
+    }
+    if (match({TokenType::Nil})) {
+      compile_literal(Value(), previous().symbol());
+      return;
+    }
+
+    if (match({TokenType::Number, TokenType::String})) {
+      compile_literal(previous().literal(), previous().symbol());
+      return;
+    }
+
+    if (match({TokenType::LeftParen})) {
+      expression();
+      consume(TokenType::RightParen, "Expect ')' after expression.");
+      return;
+    }
+
+    if (match({TokenType::Super})) {
+      const auto keyword = previous();
+      consume(TokenType::Dot, "Expected '.' after 'super'.");
+      const auto method = consume(TokenType::Identifier,
+                                  "Expected superclass method name.");
+      compile_super(keyword, method);
+      return;
+    }
+
+    if (match({TokenType::This})) {
+      compile_this(previous());
+      return;
+    }
+
+    if (match({TokenType::Identifier})) {
+      const auto name = previous();
+
+      if (can_assign and match({TokenType::Equal})) {
+        assignment();
+        handle_variable_reference(name, true);
+      }
+      else {
+        handle_variable_reference(name, false);
+      }
+      return;
+    }
+
+    throw error(peek(), "Expected expression.");
+  }
+
+
+  std::size_t SinglePassCompiler::arguments()
+  {
+    std::size_t num_args = 0;
+
+    if (not check(TokenType::RightParen)) {
+      do {
+        if (num_args >= 8) {
+          error(peek(), "Cannot have more than eight function arguments.");
+        }
+        expression();
+        ++num_args;
+      } while (match({TokenType::Comma}));
+    }
+
+    consume(TokenType::RightParen, "Expected ')' after arguments.");
+
+    return num_args;
+  }
+
+
+  SinglePassCompiler::State SinglePassCompiler::save_state() const
+  {
+    return State{func_.get(), func_->scope_depth(), class_type_};
+  }
+
+
+  void SinglePassCompiler::restore_state(const State& state)
+  {
+    // The bytecode generated for the broken declaration is never run, so all
+    // that matters here is that the scopes are consistent again.
+    while (func_.get() != state.func) {
+      func_ = func_->release_enclosing();
+    }
+    while (func_->scope_depth() > state.scope_depth) {
+      func_->end_scope();
+    }
+    class_type_ = state.class_type;
+  }
+}
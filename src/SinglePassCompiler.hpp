@@ -0,0 +1,111 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_SINGLEPASSCOMPILER_HPP
+#define LOXX_SINGLEPASSCOMPILER_HPP
+
+#include <vector>
+
+#include "Compiler.hpp"
+#include "Token.hpp"
+#include "TokenStream.hpp"
+
+
+namespace loxx
+{
+  // Compiles a token stream straight to bytecode without building a syntax
+  // tree. The grammar mirrors the Parser, but each production calls the
+  // Compiler's code generation primitives as soon as it has seen enough of
+  // the source, so the front end only makes one pass over the program. The
+  // Parser and Compiler are still needed for anything that consumes the
+  // AST, such as --debug ast.
+  class SinglePassCompiler : public Compiler, private TokenStream
+  {
+  public:
+    SinglePassCompiler(std::vector<Token> tokens,
+                       const CompilerOptions& options)
+        : Compiler(options), TokenStream(std::move(tokens))
+    {}
+
+    void compile();
+
+  private:
+    // Compiler state that must be restored when recovering from a syntax
+    // error, since the error may unwind out of nested functions and blocks.
+    struct State
+    {
+      FunctionScope* func;
+      unsigned int scope_depth;
+      ClassType class_type;
+    };
+
+    void declaration();
+    void class_declaration();
+    void function_declaration();
+    void var_declaration();
+    void statement();
+    void if_statement();
+    void print_statement();
+    void return_statement();
+    void while_statement();
+    void for_statement();
+    void expression_statement();
+    void block();
+    void function(const Token& name, const FunctionType type,
+                  const std::string& kind);
+
+    void expression() { assignment(); }
+    void assignment();
+    void logical_or(const bool can_assign);
+    void logical_and(const bool can_assign);
+    void equality(const bool can_assign);
+    void comparison(const bool can_assign);
+    void addition(const bool can_assign);
+    void multiplication(const bool can_assign);
+    void unary(const bool can_assign);
+    void call(const bool can_assign);
+    void primary(const bool can_assign);
+    std::size_t arguments();
+
+    template <typename Fn>
+    void binary(Fn fn, const bool can_assign,
+                const std::initializer_list<TokenType>& tokens);
+
+    State save_state() const;
+    void restore_state(const State& state);
+  };
+
+
+  template <typename Fn>
+  void SinglePassCompiler::binary(
+      Fn fn, const bool can_assign,
+      const std::initializer_list<TokenType>& tokens)
+  {
+    // Only the left-most operand may be the target of an assignment.
+    fn(can_assign);
+
+    while (match(tokens)) {
+      const Token op = previous();
+      fn(false);
+      compile_binary_op(op);
+    }
+  }
+}
+
+#endif //LOXX_SINGLEPASSCOMPILER_HPP
@@ -20,27 +20,37 @@
 #ifndef LOXX_STACK_HPP
 #define LOXX_STACK_HPP
 
-#include <array>
+#include <algorithm>
+#include <limits>
+#include <memory>
 #include <stdexcept>
-#include <vector>
+#include <utility>
 
 
 namespace loxx
 {
-  template <typename T, std::size_t N>
+  // A stack with storage for a fixed number of elements that's only
+  // extended on request. Pushing is unchecked, so callers must reserve
+  // enough space beforehand.
+  template <typename T>
   class Stack
   {
   public:
-    Stack() : top_(0) {}
+    explicit Stack(const std::size_t capacity)
+        : capacity_(capacity), storage_(new T[capacity]), top_(storage_.get())
+    {}
 
-    T* data() { return stack_.data(); }
-    const T* data() const { return stack_.data(); }
-    T& top(const std::size_t depth = 0)
-    { return stack_[top_ - 1 - depth]; }
+    T* data() { return storage_.get(); }
+    const T* data() const { return storage_.get(); }
+    T& top(const std::size_t depth = 0) { return *(top_ - 1 - depth); }
     const T& top(const std::size_t depth = 0) const
-    { return stack_[top_ - 1 - depth]; }
-    T& get(const std::size_t idx) { return stack_[idx]; }
-    const T& get(const std::size_t idx) const { return stack_[idx]; }
+    { return *(top_ - 1 - depth); }
+    T& get(const std::size_t idx) { return storage_[idx]; }
+    const T& get(const std::size_t idx) const { return storage_[idx]; }
+
+    // Direct access to the top of the stack, for callers that cache it.
+    T* top_ptr() { return top_; }
+    void set_top_ptr(T* top) { top_ = top; }
 
     template <typename... Us>
     void emplace(Us&&... args);
@@ -48,33 +58,69 @@ namespace loxx
     T pop();
     void discard(const std::size_t num = 1) { top_ -= num; }
 
-    std::size_t size() const { return top_; }
+    std::size_t size() const
+    { return static_cast<std::size_t>(top_ - storage_.get()); }
+    std::size_t capacity() const { return capacity_; }
+    // The most elements that fit in a single object, whose size in bytes has
+    // to fit in a std::ptrdiff_t.
+    static constexpr std::size_t max_capacity()
+    {
+      return static_cast<std::size_t>(
+          std::numeric_limits<std::ptrdiff_t>::max()) / sizeof(T);
+    }
+
+    // Grows the storage to hold at least the given number of elements,
+    // invalidating pointers to them if it has to move. Throws
+    // std::length_error if that's more than max_capacity().
+    void reserve(const std::size_t capacity);
 
   private:
-    std::size_t top_;
-    std::array<T, N> stack_;
+    std::size_t capacity_;
+    std::unique_ptr<T[]> storage_;
+    T* top_;
   };
 
 
-  template<typename T, size_t N>
+  template<typename T>
   template<typename... Us>
-  void Stack<T, N>::emplace(Us&& ... args)
+  void Stack<T>::emplace(Us&& ... args)
   {
-    stack_[top_++] = T(std::forward<Us>(args)...);
+    *top_++ = T(std::forward<Us>(args)...);
   }
 
 
-  template <typename T, std::size_t N>
-  void Stack<T, N>::push(const T& value)
+  template <typename T>
+  void Stack<T>::push(const T& value)
   {
-    stack_[top_++] = value;
+    *top_++ = value;
   }
 
 
-  template <typename T, std::size_t N>
-  T Stack<T, N>::pop()
+  template <typename T>
+  T Stack<T>::pop()
   {
-    return stack_[--top_];
+    return *--top_;
+  }
+
+
+  template <typename T>
+  void Stack<T>::reserve(const std::size_t capacity)
+  {
+    if (capacity <= capacity_) {
+      return;
+    }
+
+    if (capacity > max_capacity()) {
+      throw std::length_error("Stack capacity is too large.");
+    }
+
+    const auto num_elems = size();
+    std::unique_ptr<T[]> storage(new T[capacity]);
+    std::move(storage_.get(), top_, storage.get());
+
+    storage_ = std::move(storage);
+    top_ = storage_.get() + num_elems;
+    capacity_ = capacity;
   }
 }
 
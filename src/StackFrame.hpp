@@ -56,6 +56,10 @@ namespace loxx
     const Value& slot(const std::size_t i) const { return slots_[i]; }
     Value& slot(const std::size_t i) { return slots_[i]; }
 
+    // Points the frame at the same slots in a new copy of the stack.
+    void rebase(const Value* old_base, Value* new_base)
+    { slots_ = new_base + (slots_ - old_base); }
+
     const ClosureObject* closure() const { return closure_; }
     ClosureObject* closure() { return closure_; }
 
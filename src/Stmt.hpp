@@ -20,9 +20,7 @@
 #ifndef LOXX_STMT_HPP
 #define LOXX_STMT_HPP
 
-#include <memory>
-#include <vector>
-
+#include "Arena.hpp"
 #include "globals.hpp"
 #include "Token.hpp"
 #include "Expr.hpp"
@@ -41,10 +39,10 @@ namespace loxx
   struct Var;
   struct While;
 
+  // Nodes are allocated in an Arena and are never destroyed individually, so
+  // there's no virtual destructor here.
   struct Stmt
   {
-    virtual ~Stmt() = default;
-
     class Visitor
     {
     public:
@@ -65,20 +63,20 @@ namespace loxx
 
   struct Block : public Stmt
   {
-    Block(std::vector<std::unique_ptr<Stmt>> statements_arg)
+    Block(ArenaList<Stmt*> statements_arg)
         : statements(std::move(statements_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_block_stmt(*this); }
 
-    std::vector<std::unique_ptr<Stmt>> statements;
+    ArenaList<Stmt*> statements;
   };
 
 
   struct Class : public Stmt
   {
-    Class(Token name_arg, std::unique_ptr<Expr> superclass_arg, std::vector<std::unique_ptr<Function>> methods_arg)
+    Class(Token name_arg, Expr* superclass_arg, ArenaList<Function*> methods_arg)
         : name(std::move(name_arg)), superclass(std::move(superclass_arg)), methods(std::move(methods_arg))
     {}
 
@@ -86,27 +84,27 @@ namespace loxx
     { visitor.visit_class_stmt(*this); }
 
     Token name;
-    std::unique_ptr<Expr> superclass;
-    std::vector<std::unique_ptr<Function>> methods;
+    Expr* superclass;
+    ArenaList<Function*> methods;
   };
 
 
   struct Expression : public Stmt
   {
-    Expression(std::unique_ptr<Expr> expression_arg)
+    Expression(Expr* expression_arg)
         : expression(std::move(expression_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_expression_stmt(*this); }
 
-    std::unique_ptr<Expr> expression;
+    Expr* expression;
   };
 
 
   struct Function : public Stmt
   {
-    Function(Token name_arg, std::vector<Token> parameters_arg, std::vector<std::unique_ptr<Stmt>> body_arg)
+    Function(Token name_arg, ArenaList<Token> parameters_arg, ArenaList<Stmt*> body_arg)
         : name(std::move(name_arg)), parameters(std::move(parameters_arg)), body(std::move(body_arg))
     {}
 
@@ -114,42 +112,42 @@ namespace loxx
     { visitor.visit_function_stmt(*this); }
 
     Token name;
-    std::vector<Token> parameters;
-    std::vector<std::unique_ptr<Stmt>> body;
+    ArenaList<Token> parameters;
+    ArenaList<Stmt*> body;
   };
 
 
   struct If : public Stmt
   {
-    If(std::unique_ptr<Expr> condition_arg, std::unique_ptr<Stmt> then_branch_arg, std::unique_ptr<Stmt> else_branch_arg)
+    If(Expr* condition_arg, Stmt* then_branch_arg, Stmt* else_branch_arg)
         : condition(std::move(condition_arg)), then_branch(std::move(then_branch_arg)), else_branch(std::move(else_branch_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_if_stmt(*this); }
 
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> then_branch;
-    std::unique_ptr<Stmt> else_branch;
+    Expr* condition;
+    Stmt* then_branch;
+    Stmt* else_branch;
   };
 
 
   struct Print : public Stmt
   {
-    Print(std::unique_ptr<Expr> expression_arg)
+    Print(Expr* expression_arg)
         : expression(std::move(expression_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_print_stmt(*this); }
 
-    std::unique_ptr<Expr> expression;
+    Expr* expression;
   };
 
 
   struct Return : public Stmt
   {
-    Return(Token keyword_arg, std::unique_ptr<Expr> value_arg)
+    Return(Token keyword_arg, Expr* value_arg)
         : keyword(std::move(keyword_arg)), value(std::move(value_arg))
     {}
 
@@ -157,13 +155,13 @@ namespace loxx
     { visitor.visit_return_stmt(*this); }
 
     Token keyword;
-    std::unique_ptr<Expr> value;
+    Expr* value;
   };
 
 
   struct Var : public Stmt
   {
-    Var(Token name_arg, std::unique_ptr<Expr> initialiser_arg)
+    Var(Token name_arg, Expr* initialiser_arg)
         : name(std::move(name_arg)), initialiser(std::move(initialiser_arg))
     {}
 
@@ -171,21 +169,21 @@ namespace loxx
     { visitor.visit_var_stmt(*this); }
 
     Token name;
-    std::unique_ptr<Expr> initialiser;
+    Expr* initialiser;
   };
 
 
   struct While : public Stmt
   {
-    While(std::unique_ptr<Expr> condition_arg, std::unique_ptr<Stmt> body_arg)
+    While(Expr* condition_arg, Stmt* body_arg)
         : condition(std::move(condition_arg)), body(std::move(body_arg))
     {}
 
     void accept(Visitor& visitor) const override
     { visitor.visit_while_stmt(*this); }
 
-    std::unique_ptr<Expr> condition;
-    std::unique_ptr<Stmt> body;
+    Expr* condition;
+    Stmt* body;
   };
 
 }
@@ -20,7 +20,13 @@
 #ifndef LOXX_STRINGHASHTABLE_HPP
 #define LOXX_STRINGHASHTABLE_HPP
 
+#ifdef LOXX_SWISS_TABLES
+#include "SwissHashSet.hpp"
+#include "SwissHashTable.hpp"
+#else
+#include "HashSet.hpp"
 #include "HashTable.hpp"
+#endif
 
 
 namespace loxx
@@ -39,14 +45,33 @@ namespace loxx
     { return p1 == p2; }
   };
 
-  template <typename T>
-  using ConstStringHashTable =
-      HashTable<const StringObject*, T, HashStringObject, CompareStringObject>;
+
+  // Tables keyed on strings are on the interpreter's hot paths, so they can be
+  // built on the SIMD-probed tables instead. Those don't have a small mode, so
+  // SmallSize is ignored when they're used.
+#ifdef LOXX_SWISS_TABLES
+  template <typename Key, typename T, std::size_t SmallSize = 0>
+  using StringKeyedTable =
+      SwissHashTable<Key, T, HashStringObject, CompareStringObject>;
+
+  using StringHashSet =
+      SwissHashSet<StringObject*, HashStringObject, CompareStringObject>;
+#else
+  template <typename Key, typename T, std::size_t SmallSize = 0>
+  using StringKeyedTable =
+      HashTable<Key, T, HashStringObject, CompareStringObject, SmallSize>;
+
+  using StringHashSet =
+      HashSet<StringObject*, HashStringObject, CompareStringObject>;
+#endif
 
 
   template <typename T>
-  using StringHashTable =
-      HashTable<StringObject*, T, HashStringObject, CompareStringObject>;
+  using ConstStringHashTable = StringKeyedTable<const StringObject*, T>;
+
+
+  template <typename T, std::size_t SmallSize = 0>
+  using StringHashTable = StringKeyedTable<StringObject*, T, SmallSize>;
 }
 
 #endif //LOXX_STRINGHASHTABLE_HPP
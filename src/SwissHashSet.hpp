@@ -0,0 +1,129 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_SWISSHASHSET_HPP
+#define LOXX_SWISSHASHSET_HPP
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "detail/HashStructIterator.hpp"
+#include "detail/HashSlot.hpp"
+#include "detail/SwissImpl.hpp"
+
+
+namespace loxx
+{
+  // A hash set with the same interface as HashSet, but which finds keys by
+  // checking the control bytes of a group of slots at once.
+  template <typename Key, typename Hash = std::hash<Key>,
+            typename Compare = std::equal_to<Key>>
+  class SwissHashSet
+      : private detail::SwissImpl<
+          Key,
+          typename detail::SlotFor<Key, Key>::Type,
+          SwissHashSet<Key, Hash, Compare>>
+  {
+  friend class detail::SwissImpl<
+      Key,
+      typename detail::SlotFor<Key, Key>::Type,
+      SwissHashSet<Key, Hash, Compare>>;
+
+  public:
+    using Elem = typename detail::SlotFor<Key, Key>::Type;
+    using Iter = detail::HashStructIterator<Key, Elem>;
+
+    explicit SwissHashSet()
+        : num_used_slots_(0), num_deleted_slots_(0),
+          max_used_slots_(detail::default_max_used_slots),
+          ctrl_(this->make_ctrl(detail::default_size)),
+          data_(detail::default_size)
+    {}
+    void insert(const Key& key);
+    const Elem& get(const Key& key) const
+    { return this->find_elem(*this, key, hash_func_(key)); }
+    // Looks for an element with the given hash that satisfies the predicate.
+    template <typename Fn>
+    const Elem& find(const std::size_t hash, Fn evaluate) const;
+    void erase(const Key& key) { this->remove(*this, key); }
+    std::size_t count(const Key& key) const { return has_item(key) ? 1 : 0; }
+    bool has_item(const Key& key) const
+    { return this->find_pos(*this, key, hash_func_(key)) != data_.size(); }
+
+    std::size_t capacity() const { return data_.size(); }
+    std::size_t size() const { return num_used_slots_; }
+
+    // The number of groups past its first that a key ended up in. Keys that
+    // aren't present are reported as zero.
+    std::size_t probe_length(const Key& key) const
+    { return this->find_probe_length(*this, key); }
+    ProbeStats probe_stats() const { return this->compute_probe_stats(*this); }
+
+    auto begin() -> Iter
+    { return Iter(data_.data(), data_.data() + data_.size()); }
+    auto end() -> Iter
+    { return Iter(data_.data() + data_.size(), data_.data() + data_.size()); }
+
+  private:
+    struct KeyExtractor
+    {
+      const Key& operator()(const Elem& elem) const { return *elem; }
+    };
+
+    Hash hash_func_;
+    Compare compare_;
+    KeyExtractor key_extractor_;
+    std::size_t num_used_slots_, num_deleted_slots_, max_used_slots_;
+    std::vector<detail::Ctrl> ctrl_;
+    std::vector<Elem> data_;
+    // Returned by lookups for keys that aren't in the set.
+    static const Elem missing_;
+  };
+
+
+  template <typename Key, typename Hash, typename Compare>
+  const typename SwissHashSet<Key, Hash, Compare>::Elem
+      SwissHashSet<Key, Hash, Compare>::missing_;
+
+
+  template <typename Key, typename Hash, typename Compare>
+  template <typename Fn>
+  auto SwissHashSet<Key, Hash, Compare>::find(
+      const std::size_t hash, Fn evaluate) const -> const Elem&
+  {
+    const auto pos = this->find_pos_if(
+        *this, hash, [&] (const Elem& elem) { return evaluate(*elem); });
+    return pos == data_.size() ? missing_ : data_[pos];
+  }
+
+
+  template <typename Key, typename Hash, typename Compare>
+  void SwissHashSet<Key, Hash, Compare>::insert(const Key& key)
+  {
+    const auto hash = hash_func_(key);
+
+    if (this->find_pos(*this, key, hash) == data_.size()) {
+      this->reserve_slot(*this);
+      this->insert_new(*this, hash, key);
+    }
+  }
+}
+
+#endif //LOXX_SWISSHASHSET_HPP
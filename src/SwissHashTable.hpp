@@ -0,0 +1,140 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_SWISSHASHTABLE_HPP
+#define LOXX_SWISSHASHTABLE_HPP
+
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "detail/HashStructIterator.hpp"
+#include "detail/HashSlot.hpp"
+#include "detail/SwissImpl.hpp"
+
+
+namespace loxx
+{
+  // A hash table with the same interface as HashTable, but which finds keys
+  // by checking the control bytes of a group of slots at once.
+  template <typename Key, typename Value, typename Hash = std::hash<Key>,
+            typename Compare = std::equal_to<Key>>
+  class SwissHashTable
+    : private detail::SwissImpl<
+        Key,
+        typename detail::SlotFor<Key, std::pair<Key, Value>>::Type,
+        SwissHashTable<Key, Value, Hash, Compare>>
+  {
+    friend class detail::SwissImpl<
+        Key,
+        typename detail::SlotFor<Key, std::pair<Key, Value>>::Type,
+        SwissHashTable<Key, Value, Hash, Compare>>;
+
+  public:
+    using Item = std::pair<Key, Value>;
+    using Elem = typename detail::SlotFor<Key, Item>::Type;
+    using Iter = detail::HashStructIterator<Item, Elem>;
+
+    explicit SwissHashTable()
+        : num_used_slots_(0), num_deleted_slots_(0),
+          max_used_slots_(detail::default_max_used_slots),
+          ctrl_(this->make_ctrl(detail::default_size)),
+          data_(detail::default_size)
+    {}
+
+    Value& operator[](const Key& key);
+    const Value& at(const Key& key) const;
+    const Elem& get(const Key& key) const
+    { return this->find_elem(*this, key, hash_func_(key)); }
+    void erase(const Key& key) { this->remove(*this, key); }
+    std::size_t count(const Key& key) const { return has_item(key) ? 1 : 0; }
+    bool has_item(const Key& key) const
+    { return this->find_pos(*this, key, hash_func_(key)) != data_.size(); }
+
+    std::size_t capacity() const { return data_.size(); }
+    std::size_t size() const { return num_used_slots_; }
+
+    // The number of groups past its first that a key ended up in. Keys that
+    // aren't present are reported as zero.
+    std::size_t probe_length(const Key& key) const
+    { return this->find_probe_length(*this, key); }
+    ProbeStats probe_stats() const { return this->compute_probe_stats(*this); }
+
+    auto begin() -> Iter
+    { return Iter(data_.data(), data_.data() + data_.size()); }
+    auto end() -> Iter
+    { return Iter(data_.data() + data_.size(), data_.data() + data_.size()); }
+
+  private:
+    struct KeyExtractor
+    {
+      const Key& operator()(const Elem& elem) const { return elem->first; }
+    };
+
+    Hash hash_func_;
+    Compare compare_;
+    KeyExtractor key_extractor_;
+    std::size_t num_used_slots_, num_deleted_slots_, max_used_slots_;
+    std::vector<detail::Ctrl> ctrl_;
+    std::vector<Elem> data_;
+    // Returned by lookups for keys that aren't in the table.
+    static const Elem missing_;
+  };
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare>
+  const typename SwissHashTable<Key, Value, Hash, Compare>::Elem
+      SwissHashTable<Key, Value, Hash, Compare>::missing_;
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare>
+  Value& SwissHashTable<Key, Value, Hash, Compare>::operator[](const Key& key)
+  {
+    const auto hash = hash_func_(key);
+    const auto found_pos = this->find_pos(*this, key, hash);
+
+    if (found_pos != data_.size()) {
+      return data_[found_pos]->second;
+    }
+
+    this->reserve_slot(*this);
+    const auto pos =
+        this->insert_new(*this, hash, std::make_pair(key, Value()));
+
+    return data_[pos]->second;
+  }
+
+
+  template <typename Key, typename Value, typename Hash, typename Compare>
+  const Value& SwissHashTable<Key, Value, Hash, Compare>::at(
+      const Key& key) const
+  {
+    const auto found_pos = this->find_pos(*this, key, hash_func_(key));
+
+    if (found_pos == data_.size()) {
+      throw std::out_of_range(
+          "SwissHashTable instance does not have supplied key!");
+    }
+
+    return data_[found_pos]->second;
+  }
+}
+
+#endif //LOXX_SWISSHASHTABLE_HPP
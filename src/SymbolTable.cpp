@@ -0,0 +1,111 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include <cstring>
+
+#include "SymbolTable.hpp"
+
+
+namespace loxx
+{
+  namespace
+  {
+    std::size_t hash_lexeme(const char* str, const std::size_t length)
+    {
+      // FNV-1a
+      std::size_t hash = 14695981039346656037ul;
+      for (std::size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ul;
+      }
+      return hash;
+    }
+  }
+
+
+  constexpr Symbol SymbolTable::empty_slot_;
+
+
+  SymbolTable& SymbolTable::instance()
+  {
+    static SymbolTable ret;
+    return ret;
+  }
+
+
+  SymbolTable::SymbolTable()
+      : mask_(255), slots_(256, empty_slot_)
+  {
+    const char* predefined[] = {
+        "and", "class", "else", "false", "fun", "for", "if", "nil", "or",
+        "print", "return", "super", "this", "true", "var", "while",
+        "init", ""
+    };
+
+    for (const auto str : predefined) {
+      intern(str, std::strlen(str));
+    }
+  }
+
+
+  Symbol SymbolTable::intern(const char* str, const std::size_t length)
+  {
+    const auto hash = hash_lexeme(str, length);
+    auto pos = hash & mask_;
+
+    while (slots_[pos] != empty_slot_) {
+      const auto candidate = slots_[pos];
+      const auto& lexeme = lexemes_[candidate];
+
+      if (hashes_[candidate] == hash and lexeme.size() == length and
+          std::memcmp(lexeme.data(), str, length) == 0) {
+        return candidate;
+      }
+      pos = (pos + 1) & mask_;
+    }
+
+    const auto symbol = static_cast<Symbol>(lexemes_.size());
+    lexemes_.emplace_back(str, length);
+    hashes_.push_back(hash);
+    slots_[pos] = symbol;
+
+    if (lexemes_.size() * 4 >= slots_.size() * 3) {
+      rehash();
+    }
+
+    return symbol;
+  }
+
+
+  void SymbolTable::rehash()
+  {
+    std::vector<Symbol> slots(slots_.size() * 2, empty_slot_);
+    mask_ = slots.size() - 1;
+
+    for (Symbol symbol = 0; symbol < lexemes_.size(); ++symbol) {
+      auto pos = hashes_[symbol] & mask_;
+      while (slots[pos] != empty_slot_) {
+        pos = (pos + 1) & mask_;
+      }
+      slots[pos] = symbol;
+    }
+
+    std::swap(slots, slots_);
+  }
+}
@@ -0,0 +1,73 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_SYMBOLTABLE_HPP
+#define LOXX_SYMBOLTABLE_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+
+namespace loxx
+{
+  using Symbol = std::uint32_t;
+
+
+  namespace symbols
+  {
+    // The keywords are interned first, in the same order as they appear in
+    // TokenType, so that keyword tokens can be given a symbol without
+    // touching the table.
+    constexpr Symbol num_keywords = 16;
+    constexpr Symbol init = num_keywords;
+    constexpr Symbol empty = num_keywords + 1;
+  }
+
+
+  class SymbolTable
+  {
+  public:
+    static SymbolTable& instance();
+
+    Symbol intern(const char* str, const std::size_t length);
+    Symbol intern(const std::string& str)
+    { return intern(str.data(), str.size()); }
+
+    const std::string& lexeme(const Symbol symbol) const
+    { return lexemes_[symbol]; }
+
+    std::size_t size() const { return lexemes_.size(); }
+
+  private:
+    SymbolTable();
+
+    void rehash();
+
+    static constexpr Symbol empty_slot_ = ~Symbol(0);
+
+    std::size_t mask_;
+    std::deque<std::string> lexemes_;
+    std::vector<std::size_t> hashes_;
+    std::vector<Symbol> slots_;
+  };
+}
+
+#endif //LOXX_SYMBOLTABLE_HPP
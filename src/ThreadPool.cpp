@@ -0,0 +1,71 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include "ThreadPool.hpp"
+
+
+namespace loxx
+{
+  ThreadPool::ThreadPool(const unsigned int num_threads)
+      : stopping_(false)
+  {
+    threads_.reserve(num_threads);
+
+    for (unsigned int i = 0; i < num_threads; ++i) {
+      threads_.emplace_back([this] () { work(); });
+    }
+  }
+
+
+  ThreadPool::~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    condition_.notify_all();
+
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+
+  void ThreadPool::work()
+  {
+    while (true) {
+      std::function<void()> task;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(
+            lock, [this] () { return stopping_ or not tasks_.empty(); });
+
+        if (tasks_.empty()) {
+          return;
+        }
+
+        task = std::move(tasks_.front());
+        tasks_.pop();
+      }
+
+      task();
+    }
+  }
+}
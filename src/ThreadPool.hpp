@@ -0,0 +1,82 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_THREADPOOL_HPP
+#define LOXX_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace loxx
+{
+  // Fixed-size pool of worker threads that run submitted tasks in the order
+  // they were submitted. Destroying the pool waits for all outstanding tasks
+  // to finish.
+  class ThreadPool
+  {
+  public:
+    explicit ThreadPool(const unsigned int num_threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template <typename Fn>
+    std::future<std::result_of_t<Fn()>> submit(Fn fn);
+
+  private:
+    void work();
+
+    bool stopping_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::queue<std::function<void()>> tasks_;
+    std::vector<std::thread> threads_;
+  };
+
+
+  template <typename Fn>
+  std::future<std::result_of_t<Fn()>> ThreadPool::submit(Fn fn)
+  {
+    // std::function must be copyable, so the task is shared rather than moved
+    // into the queue.
+    auto task =
+        std::make_shared<std::packaged_task<std::result_of_t<Fn()>()>>(
+            std::move(fn));
+    auto ret = task->get_future();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.emplace([task] () { (*task)(); });
+    }
+    condition_.notify_one();
+
+    return ret;
+  }
+}
+
+#endif //LOXX_THREADPOOL_HPP
@@ -24,6 +24,7 @@
 #include <string>
 
 #include "globals.hpp"
+#include "SymbolTable.hpp"
 #include "Value.hpp"
 
 
@@ -44,28 +45,36 @@ namespace loxx
     Eof
   };
 
+  constexpr Symbol keyword_symbol(const TokenType type)
+  {
+    return static_cast<Symbol>(type) - static_cast<Symbol>(TokenType::And);
+  }
+
+
   class Token
   {
   public:
-    Token(const TokenType type, std::string lexeme, const unsigned int line)
-        : type_(type), lexeme_(std::move(lexeme)), line_(line)
+    Token(const TokenType type, const Symbol lexeme, const unsigned int line)
+        : type_(type), lexeme_(lexeme), line_(line)
     {}
 
-    Token(const TokenType type, std::string lexeme, Value literal,
+    Token(const TokenType type, const Symbol lexeme, Value literal,
           const unsigned int line)
-        : type_(type), lexeme_(std::move(lexeme)), literal_(std::move(literal)),
+        : type_(type), lexeme_(lexeme), literal_(std::move(literal)),
           line_(line)
     {}
 
     TokenType type() const { return type_; }
-    const std::string& lexeme() const { return lexeme_; }
+    const std::string& lexeme() const
+    { return SymbolTable::instance().lexeme(lexeme_); }
+    Symbol symbol() const { return lexeme_; }
     unsigned int line() const { return line_; }
 
     const Value& literal() const { return literal_; }
 
   private:
     TokenType type_;
-    std::string lexeme_;
+    Symbol lexeme_;
     Value literal_;
     unsigned int line_;
   };
@@ -0,0 +1,118 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include "logging.hpp"
+#include "TokenStream.hpp"
+
+
+namespace loxx
+{
+  bool TokenStream::match(std::initializer_list<TokenType> types)
+  {
+    for (const auto type : types) {
+      if (check(type)) {
+        advance();
+        return true;
+      }
+    }
+    return false;
+  }
+
+
+  const Token& TokenStream::consume(const TokenType type,
+                                    const std::string& message)
+  {
+    if (check(type)) {
+      return advance();
+    }
+
+    throw error(peek(), message);
+  }
+
+
+  bool TokenStream::check(const TokenType type) const
+  {
+    if (is_at_end()) {
+      return false;
+    }
+    return peek().type() == type;
+  }
+
+
+  const Token& TokenStream::advance()
+  {
+    if (not is_at_end()) {
+      current_ += 1;
+    }
+    return previous();
+  }
+
+
+  bool TokenStream::is_at_end() const
+  {
+    return peek().type() == TokenType::Eof;
+  }
+
+
+  const Token& TokenStream::peek() const
+  {
+    return tokens_[current_];
+  }
+
+
+  const Token& TokenStream::previous() const
+  {
+    return tokens_[current_ - 1];
+  }
+
+
+  TokenStream::ParseError TokenStream::error(const Token& token,
+                                             const std::string& message)
+  {
+    syntax_error(token, message);
+    return ParseError();
+  }
+
+
+  void TokenStream::synchronise()
+  {
+    advance();
+
+    while (not is_at_end()) {
+      if (previous().type() == TokenType::SemiColon) {
+        return;
+      }
+
+      switch (peek().type()) {
+        case TokenType::Class:
+        case TokenType::Fun:
+        case TokenType::Var:
+        case TokenType::For:
+        case TokenType::If:
+        case TokenType::While:
+        case TokenType::Print:
+        case TokenType::Return:
+          return;
+        default:
+          advance();
+          break;
+      }
+    }
+  }
+}
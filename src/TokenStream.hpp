@@ -0,0 +1,62 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_TOKENSTREAM_HPP
+#define LOXX_TOKENSTREAM_HPP
+
+#include <stdexcept>
+#include <vector>
+
+#include "Token.hpp"
+
+
+namespace loxx
+{
+  // Cursor over the output of the Scanner, shared by the Parser and the
+  // SinglePassCompiler.
+  class TokenStream
+  {
+  protected:
+    class ParseError : public std::runtime_error
+    {
+    public:
+      ParseError() : std::runtime_error("") {}
+    };
+
+    explicit TokenStream(std::vector<Token> tokens)
+        : current_(0), tokens_(std::move(tokens))
+    {}
+
+    bool match(std::initializer_list<TokenType> types);
+    const Token& consume(const TokenType type, const std::string& message);
+    bool check(const TokenType type) const;
+    const Token& advance();
+    bool is_at_end() const;
+    const Token& peek() const;
+    const Token& previous() const;
+    ParseError error(const Token& token, const std::string& message);
+    void synchronise();
+
+  private:
+    unsigned int current_;
+    std::vector<Token> tokens_;
+  };
+}
+
+#endif //LOXX_TOKENSTREAM_HPP
@@ -0,0 +1,402 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#include "TypeInference.hpp"
+
+
+namespace loxx
+{
+  void TypeInference::infer_function(const Function& func)
+  {
+    begin_scope();
+
+    for (const auto& param : func.parameters) {
+      declare(param, Type::Unknown);
+    }
+
+    infer_stmts(func.body);
+
+    end_scope();
+  }
+
+
+  void TypeInference::infer_script(const ArenaList<Stmt*>& statements)
+  {
+    infer_stmts(statements);
+  }
+
+
+  void TypeInference::visit_assign_expr(const Assign& expr)
+  {
+    const auto type = infer(*expr.value);
+    const auto local = resolve(expr.name);
+
+    if (local != nullptr and not local->captured) {
+      local->type = type;
+    }
+
+    type_ = type;
+  }
+
+
+  void TypeInference::visit_binary_expr(const Binary& expr)
+  {
+    const auto left = infer(*expr.left);
+    const auto right = infer(*expr.right);
+    const auto numeric = left == Type::Number and right == Type::Number;
+
+    switch (expr.op.type()) {
+    case TokenType::Plus:
+      // Adding anything other than two numbers either concatenates strings
+      // or fails.
+      record(expr, numeric);
+      type_ = numeric ? Type::Number : Type::Unknown;
+      break;
+
+    case TokenType::Minus:
+    case TokenType::Star:
+    case TokenType::Slash:
+      // These raise an error for anything other than numbers, so the result
+      // is a number whenever evaluation gets this far.
+      record(expr, numeric);
+      type_ = Type::Number;
+      break;
+
+    case TokenType::Less:
+    case TokenType::LessEqual:
+    case TokenType::Greater:
+    case TokenType::GreaterEqual:
+      record(expr, numeric);
+      type_ = Type::Unknown;
+      break;
+
+    default:
+      type_ = Type::Unknown;
+      break;
+    }
+  }
+
+
+  void TypeInference::visit_call_expr(const Call& expr)
+  {
+    infer(*expr.callee);
+
+    for (const auto argument : expr.arguments) {
+      infer(*argument);
+    }
+
+    type_ = Type::Unknown;
+  }
+
+
+  void TypeInference::visit_get_expr(const Get& expr)
+  {
+    infer(*expr.object);
+    type_ = Type::Unknown;
+  }
+
+
+  void TypeInference::visit_grouping_expr(const Grouping& expr)
+  {
+    type_ = infer(*expr.expression);
+  }
+
+
+  void TypeInference::visit_literal_expr(const Literal& expr)
+  {
+    type_ = holds_alternative<double>(expr.value) ?
+            Type::Number : Type::Unknown;
+  }
+
+
+  void TypeInference::visit_logical_expr(const Logical& expr)
+  {
+    // The right operand is only evaluated some of the time, so the result
+    // and the state afterwards could come from either path.
+    const auto left = infer(*expr.left);
+    const auto state = locals_;
+    const auto right = infer(*expr.right);
+
+    join(locals_, state);
+    type_ = join(left, right);
+  }
+
+
+  void TypeInference::visit_set_expr(const Set& expr)
+  {
+    infer(*expr.object);
+    infer(*expr.value);
+    type_ = Type::Unknown;
+  }
+
+
+  void TypeInference::visit_super_expr(const Super&)
+  {
+    type_ = Type::Unknown;
+  }
+
+
+  void TypeInference::visit_this_expr(const This&)
+  {
+    type_ = Type::Unknown;
+  }
+
+
+  void TypeInference::visit_unary_expr(const Unary& expr)
+  {
+    const auto right = infer(*expr.right);
+
+    if (expr.op.type() == TokenType::Minus) {
+      record(expr, right == Type::Number);
+      type_ = Type::Number;
+    }
+    else {
+      type_ = Type::Unknown;
+    }
+  }
+
+
+  void TypeInference::visit_variable_expr(const Variable& expr)
+  {
+    const auto local = resolve(expr.name);
+
+    type_ = local != nullptr and not local->captured ?
+            local->type : Type::Unknown;
+  }
+
+
+  void TypeInference::visit_block_stmt(const Block& stmt)
+  {
+    begin_scope();
+    infer_stmts(stmt.statements);
+    end_scope();
+  }
+
+
+  void TypeInference::visit_class_stmt(const Class& stmt)
+  {
+    declare(stmt.name, Type::Unknown);
+
+    if (stmt.superclass != nullptr) {
+      infer(*stmt.superclass);
+    }
+
+    for (const auto method : stmt.methods) {
+      find_captures(*method);
+    }
+  }
+
+
+  void TypeInference::visit_expression_stmt(const Expression& stmt)
+  {
+    infer(*stmt.expression);
+  }
+
+
+  void TypeInference::visit_function_stmt(const Function& stmt)
+  {
+    declare(stmt.name, Type::Unknown);
+    find_captures(stmt);
+  }
+
+
+  void TypeInference::visit_if_stmt(const If& stmt)
+  {
+    infer(*stmt.condition);
+    const auto state = locals_;
+
+    infer(*stmt.then_branch);
+    auto then_state = locals_;
+
+    locals_ = state;
+    if (stmt.else_branch != nullptr) {
+      infer(*stmt.else_branch);
+    }
+
+    join(locals_, then_state);
+  }
+
+
+  void TypeInference::visit_print_stmt(const Print& stmt)
+  {
+    infer(*stmt.expression);
+  }
+
+
+  void TypeInference::visit_return_stmt(const Return& stmt)
+  {
+    if (stmt.value != nullptr) {
+      infer(*stmt.value);
+    }
+  }
+
+
+  void TypeInference::visit_var_stmt(const Var& stmt)
+  {
+    const auto type = stmt.initialiser != nullptr ?
+                      infer(*stmt.initialiser) : Type::Unknown;
+    declare(stmt.name, type);
+  }
+
+
+  void TypeInference::visit_while_stmt(const While& stmt)
+  {
+    // Iterate until the state at the top of the loop stops changing. Each
+    // pass records results for the operators in the loop, so those from the
+    // final pass, which hold for every iteration, are the ones that stick.
+    // Locals only ever move towards being unknown, so this terminates.
+    auto head = locals_;
+
+    while (true) {
+      locals_ = head;
+      infer(*stmt.condition);
+      const auto exit_state = locals_;
+
+      infer(*stmt.body);
+      join(locals_, head);
+
+      if (locals_ == head) {
+        locals_ = exit_state;
+        break;
+      }
+
+      head = locals_;
+    }
+  }
+
+
+  TypeInference::Type TypeInference::infer(const Expr& expr)
+  {
+    expr.accept(*this);
+    return type_;
+  }
+
+
+  void TypeInference::infer(const Stmt& stmt)
+  {
+    stmt.accept(*this);
+  }
+
+
+  void TypeInference::infer_stmts(const ArenaList<Stmt*>& statements)
+  {
+    for (const auto stmt : statements) {
+      infer(*stmt);
+    }
+  }
+
+
+  void TypeInference::find_captures(const Function& func)
+  {
+    // Walk the nested function as if it were part of this one. Any locals
+    // it resolves from below nested_base_ are captured.
+    const auto outermost = nested_base_ == no_nesting_;
+    if (outermost) {
+      nested_base_ = locals_.size();
+    }
+
+    const auto state = locals_;
+
+    infer_function(func);
+
+    // The nested function's body doesn't run here, so only the captures
+    // it makes are kept.
+    for (std::size_t i = 0; i < state.size(); ++i) {
+      locals_[i].type = state[i].type;
+    }
+
+    if (outermost) {
+      nested_base_ = no_nesting_;
+    }
+  }
+
+
+  void TypeInference::begin_scope()
+  {
+    ++scope_depth_;
+  }
+
+
+  void TypeInference::end_scope()
+  {
+    --scope_depth_;
+
+    while (not locals_.empty() and locals_.back().depth > scope_depth_) {
+      locals_.pop_back();
+    }
+  }
+
+
+  void TypeInference::declare(const Token& name, const Type type)
+  {
+    if (scope_depth_ > 0) {
+      locals_.push_back(Local{name.symbol(), scope_depth_, type, false});
+    }
+  }
+
+
+  TypeInference::Local* TypeInference::resolve(const Token& name)
+  {
+    for (auto i = locals_.size(); i > 0; --i) {
+      auto& local = locals_[i - 1];
+
+      if (local.name == name.symbol()) {
+        if (nested_base_ != no_nesting_ and i - 1 < nested_base_) {
+          local.captured = true;
+        }
+        return &local;
+      }
+    }
+
+    return nullptr;
+  }
+
+
+  void TypeInference::record(const Expr& expr, const bool numeric)
+  {
+    // Operators inside nested functions are left for when those functions
+    // are analysed in their own right.
+    if (nested_base_ != no_nesting_) {
+      return;
+    }
+
+    if (numeric) {
+      numeric_ops_->insert(&expr);
+    }
+    else {
+      numeric_ops_->erase(&expr);
+    }
+  }
+
+
+  TypeInference::Type TypeInference::join(const Type first, const Type second)
+  {
+    return first == Type::Number and second == Type::Number ?
+           Type::Number : Type::Unknown;
+  }
+
+
+  void TypeInference::join(State& state, const State& other)
+  {
+    for (std::size_t i = 0; i < state.size(); ++i) {
+      state[i].type = join(state[i].type, other[i].type);
+      state[i].captured = state[i].captured or other[i].captured;
+    }
+  }
+}
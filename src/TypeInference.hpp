@@ -0,0 +1,126 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_TYPEINFERENCE_HPP
+#define LOXX_TYPEINFERENCE_HPP
+
+#include <unordered_set>
+#include <vector>
+
+#include "Stmt.hpp"
+
+
+namespace loxx
+{
+  // Flow-sensitive inference of which locals hold numbers, used to find
+  // arithmetic and comparisons whose operands are guaranteed to be numbers
+  // so that the compiler can emit instructions without type checks.
+  //
+  // Only the locals of the function being analysed are tracked. Globals and
+  // upvalues can be changed by code elsewhere, as can any local once a
+  // closure that captures it has been declared, so these are never assumed
+  // to hold numbers. Nested functions are analysed separately when they're
+  // compiled.
+  class TypeInference : private Expr::Visitor, private Stmt::Visitor
+  {
+  public:
+    // Operators found to have numeric operands are added to numeric_ops, and
+    // any others that are visited are removed from it.
+    explicit TypeInference(std::unordered_set<const Expr*>& numeric_ops)
+        : numeric_ops_(&numeric_ops), scope_depth_(0),
+          nested_base_(no_nesting_), type_(Type::Unknown)
+    {}
+
+    void infer_function(const Function& func);
+    void infer_script(const ArenaList<Stmt*>& statements);
+
+  private:
+    enum class Type
+    {
+      Number,
+      Unknown
+    };
+
+    struct Local
+    {
+      Symbol name;
+      std::size_t depth;
+      Type type;
+      bool captured;
+
+      bool operator==(const Local& other) const
+      {
+        return name == other.name and depth == other.depth and
+               type == other.type and captured == other.captured;
+      }
+    };
+
+    using State = std::vector<Local>;
+
+    void visit_assign_expr(const Assign& expr) override;
+    void visit_binary_expr(const Binary& expr) override;
+    void visit_call_expr(const Call& expr) override;
+    void visit_get_expr(const Get& expr) override;
+    void visit_grouping_expr(const Grouping& expr) override;
+    void visit_literal_expr(const Literal& expr) override;
+    void visit_logical_expr(const Logical& expr) override;
+    void visit_set_expr(const Set& expr) override;
+    void visit_super_expr(const Super& expr) override;
+    void visit_this_expr(const This& expr) override;
+    void visit_unary_expr(const Unary& expr) override;
+    void visit_variable_expr(const Variable& expr) override;
+
+    void visit_block_stmt(const Block& stmt) override;
+    void visit_class_stmt(const Class& stmt) override;
+    void visit_expression_stmt(const Expression& stmt) override;
+    void visit_function_stmt(const Function& stmt) override;
+    void visit_if_stmt(const If& stmt) override;
+    void visit_print_stmt(const Print& stmt) override;
+    void visit_return_stmt(const Return& stmt) override;
+    void visit_var_stmt(const Var& stmt) override;
+    void visit_while_stmt(const While& stmt) override;
+
+    Type infer(const Expr& expr);
+    void infer(const Stmt& stmt);
+    void infer_stmts(const ArenaList<Stmt*>& statements);
+    void find_captures(const Function& func);
+
+    void begin_scope();
+    void end_scope();
+    void declare(const Token& name, const Type type);
+    Local* resolve(const Token& name);
+    void record(const Expr& expr, const bool numeric);
+
+    static Type join(const Type first, const Type second);
+    static void join(State& state, const State& other);
+
+    static constexpr std::size_t no_nesting_ = ~std::size_t(0);
+
+    std::unordered_set<const Expr*>* numeric_ops_;
+    // Variables declared at depth zero are globals.
+    std::size_t scope_depth_;
+    // While walking a nested function to see which locals it captures, this
+    // is the number of locals belonging to the function being analysed.
+    std::size_t nested_base_;
+    Type type_;
+    State locals_;
+  };
+}
+
+#endif //LOXX_TYPEINFERENCE_HPP
@@ -17,10 +17,12 @@
  * Created by Matt Spraggs on 05/03/2018.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <tuple>
 
 #include "logging.hpp"
 #include "ObjectTracker.hpp"
@@ -30,9 +32,54 @@
 
 namespace loxx
 {
-  VirtualMachine::VirtualMachine(const bool debug)
-      : debug_(debug), ip_(0),
-        init_lexeme_(make_object<StringObject>("init"))
+  namespace
+  {
+    // The stacks start out small and double in size whenever they fill up.
+    constexpr std::size_t initial_stack_size = 256;
+    constexpr std::size_t initial_call_frames = 16;
+
+
+    Value string_builder(const Value*, const unsigned int)
+    {
+      return Value(InPlace<ObjectPtr>(), make_object<StringBuilderObject>());
+    }
+
+
+    // Native methods are passed their receiver as the first argument.
+    Value string_builder_append(const Value* args, const unsigned int)
+    {
+      get_object<StringBuilderObject>(args[0])->append(args[1]);
+      return args[0];
+    }
+
+
+    Value string_builder_length(const Value* args, const unsigned int)
+    {
+      const auto builder = get_object<StringBuilderObject>(args[0]);
+      return Value(static_cast<double>(builder->size()));
+    }
+
+
+    Value string_builder_finish(const Value* args, const unsigned int)
+    {
+      const auto builder = get_object<StringBuilderObject>(args[0]);
+      return Value(InPlace<ObjectPtr>(),
+                   make_object<StringObject>(builder->release()));
+    }
+  }
+
+
+  VirtualMachine::VirtualMachine(const bool debug,
+                                 const std::size_t max_call_frames,
+                                 const std::size_t max_stack_size)
+      : debug_(debug),
+        max_call_frames_(
+            std::min(max_call_frames, Stack<StackFrame>::max_capacity())),
+        max_stack_size_(std::min(max_stack_size, Stack<Value>::max_capacity())),
+        ip_(nullptr),
+        stack_(std::min(initial_stack_size, max_stack_size)),
+        call_stack_(std::min(initial_call_frames, max_call_frames)),
+        open_upvalues_(nullptr), init_lexeme_(make_object<StringObject>("init"))
   {
     NativeObject::Fn fn =
         [] (const Value*, const unsigned int)
@@ -48,8 +95,29 @@ namespace loxx
     globals_[str] =
         Value(InPlace<ObjectPtr>(), make_object<NativeObject>(fn, 0));
 
-    ObjectTracker::instance().set_roots(
-        ObjectTracker::Roots{&stack_, &open_upvalues_, &globals_});
+    str = make_object<StringObject>("StringBuilder");
+    globals_[str] = Value(
+        InPlace<ObjectPtr>(), make_object<NativeObject>(string_builder, 0));
+
+    const std::tuple<const char*, NativeObject::Fn, unsigned int> methods[] = {
+        std::make_tuple("append", string_builder_append, 1),
+        std::make_tuple("length", string_builder_length, 0),
+        std::make_tuple("finish", string_builder_finish, 0),
+    };
+
+    for (const auto& method : methods) {
+      const auto name = make_object<StringObject>(std::get<0>(method));
+      const auto native =
+          make_object<NativeObject>(std::get<1>(method), std::get<2>(method));
+      string_builder_methods_[name] = native;
+      builtins_.push_back(name);
+      builtins_.push_back(native);
+    }
+
+    builtins_.push_back(init_lexeme_);
+
+    ObjectTracker::instance().set_roots(ObjectTracker::Roots{
+        &stack_, &call_stack_, &open_upvalues_, &globals_, &builtins_});
   }
 
 
@@ -61,353 +129,391 @@ namespace loxx
         std::make_unique<ClosureObject>(top_level_func.get());
 
     code_object_ = top_level_func->code_object();
-    ip_ = top_level_func->code_object()->bytecode.begin();
+    ip_ = top_level_func->code_object()->bytecode.data();
+    reserve_stack(code_object_->stack_size);
     call_stack_.emplace(ip_, code_object_, stack_.data(),
                         top_level_closure.get());
 
+    // The instruction pointer and the top of the stack are kept in locals so
+    // that they can live in registers. They're written back before anything
+    // else that uses them, such as calls and allocations, and reloaded
+    // afterwards. Runtime errors are given the instruction pointer directly.
+    auto ip = ip_;
+    auto sp = stack_.top_ptr();
+
+    const auto store_registers = [&] {
+      ip_ = ip;
+      stack_.set_top_ptr(sp);
+    };
+    const auto load_registers = [&] {
+      ip = ip_;
+      sp = stack_.top_ptr();
+    };
+
     while (true) {
 
 #ifndef NDEBUG
       if (debug_) {
+        store_registers();
         print_stack();
         print_instruction(
-            *call_stack_.top().closure()->function().code_object(), ip_);
+            *call_stack_.top().closure()->function().code_object(), ip);
       }
 #endif
 
-      const auto instruction = static_cast<Instruction>(*ip_++);
+      const auto instruction = static_cast<Instruction>(*ip++);
 
       switch (instruction) {
 
       case Instruction::Add: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
+        const auto second = *(sp - 1);
+        const auto first = *(sp - 2);
 
         const auto first_str = get_object<StringObject>(first);
         const auto second_str = get_object<StringObject>(second);
 
         if (first_str and second_str) {
-          const auto combined_str = make_object<StringObject>(
-              first_str->as_std_string() + second_str->as_std_string());
-          stack_.emplace(InPlace<ObjectPtr>(), combined_str);
+          // Allocating may trigger garbage collection, which scans the stack,
+          // so the operands stay on it until the rope refers to them.
+          store_registers();
+          const auto combined_str =
+              make_object<RopeObject>(first_str, second_str);
+          sp -= 2;
+          *sp++ = Value(InPlace<ObjectPtr>(), combined_str);
         }
         else if (holds_alternative<double>(first) and
                  holds_alternative<double>(second)) {
-          stack_.emplace(
+          sp -= 2;
+          *sp++ = Value(
               unsafe_get<double>(first) + unsafe_get<double>(second));
         }
         else {
           throw make_runtime_error(
-              "Binary operands must be two numbers or two strings.");
+              "Binary operands must be two numbers or two strings.", ip);
+        }
+        break;
+      }
+
+      case Instruction::AddNumbers: {
+        const auto second = unsafe_get<double>(*--sp);
+        const auto first = unsafe_get<double>(*--sp);
+        *sp++ = Value(first + second);
+        break;
+      }
+
+      case Instruction::AssertNumbers: {
+        // Emitted before operations on inferred numbers when verifying the
+        // type inference.
+        const auto num_operands = read_integer<InstrArgUByte>(ip);
+        for (unsigned int i = 0; i < num_operands; ++i) {
+          if (not holds_alternative<double>(*(sp - 1 - i))) {
+            throw make_runtime_error(
+                "Type inference error: operand is not a number.", ip);
+          }
         }
         break;
       }
 
       case Instruction::Call:
+        store_registers();
         execute_call();
+        load_registers();
         break;
 
       case Instruction::CloseUpvalue:
-        close_upvalues(stack_.top());
-        stack_.discard();
+        close_upvalues(sp[-1]);
+        --sp;
         break;
 
       case Instruction::ConditionalJump: {
-        const auto jmp = read_integer<InstrArgUShort>();
-        if (not is_truthy(stack_.top())) {
-          ip_ += jmp;
+        const auto jmp = read_integer<InstrArgUShort>(ip);
+        if (not is_truthy(sp[-1])) {
+          ip += jmp;
         }
         break;
       }
 
       case Instruction::CreateClass: {
-        auto name = read_string()->as_std_string();
-        const auto cls = make_object<ClassObject>(std::move(name));
-        stack_.emplace(InPlace<ObjectPtr>(), cls);
+        const auto name = read_string(ip);
+        store_registers();
+        execute_create_class(name, false);
+        load_registers();
         break;
       }
 
       case Instruction::CreateClosure:
-        execute_create_closure();
+        store_registers();
+        execute_create_closure<InstrArgUByte>();
+        load_registers();
         break;
 
       case Instruction::CreateMethod: {
-        const auto cls = get_object<ClassObject>(stack_.top(1));
-        const auto closure = get_object<ClosureObject>(stack_.top());
-        const auto name = read_string();
-
-        cls->set_method(name, closure);
-        stack_.discard();
+        const auto name = read_string(ip);
+        store_registers();
+        execute_create_method(name);
+        load_registers();
         break;
       }
 
       case Instruction::CreateSubclass: {
-        const auto super = get_object<ClassObject>(stack_.top());
-
-        if (not super) {
-          throw make_runtime_error("Superclass must be a class.");
-        }
-
-        auto name = read_string()->as_std_string();
-        const auto cls = make_object<ClassObject>(std::move(name), super);
-        stack_.emplace(InPlace<ObjectPtr>(), cls);
+        const auto name = read_string(ip);
+        store_registers();
+        execute_create_class(name, true);
+        load_registers();
         break;
       }
 
-      case Instruction::DefineGlobal: {
-        const auto varname = read_string();
-        globals_[varname] = stack_.pop();
+      case Instruction::DefineGlobal:
+        globals_[read_string(ip)] = *--sp;
         break;
-      }
 
       case Instruction::Divide: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
-        check_number_operands(first, second);
-        stack_.emplace(unsafe_get<double>(first) / unsafe_get<double>(second));
+        const auto second = *--sp;
+        const auto first = *--sp;
+        check_number_operands(first, second, ip);
+        *sp++ = Value(unsafe_get<double>(first) / unsafe_get<double>(second));
+        break;
+      }
+
+      case Instruction::DivideNumbers: {
+        const auto second = unsafe_get<double>(*--sp);
+        const auto first = unsafe_get<double>(*--sp);
+        *sp++ = Value(first / second);
         break;
       }
 
       case Instruction::Equal: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
+        const auto second = *--sp;
+        const auto first = *--sp;
 
-        stack_.emplace(InPlace<bool>(), are_equal(first, second));
+        *sp++ = Value(InPlace<bool>(), are_equal(first, second));
         break;
       }
 
       case Instruction::False:
-        stack_.emplace(InPlace<bool>(), false);
+        *sp++ = Value(InPlace<bool>(), false);
         break;
 
       case Instruction::GetGlobal: {
-        const auto varname = read_string();
-
-        const auto& global = globals_.get(varname);
-
-        if (not global) {
-          throw make_runtime_error(
-              "Undefined variable '" + varname->as_std_string() + "'.");
-        }
-
-        stack_.push(global->second);
+        const auto name = read_string(ip);
+        store_registers();
+        execute_get_global(name);
+        load_registers();
         break;
       }
 
       case Instruction::GetLocal: {
-        const auto arg = read_integer<InstrArgUByte>();
-        stack_.push(call_stack_.top().slot(arg));
+        const auto arg = read_integer<InstrArgUByte>(ip);
+        *sp++ = call_stack_.top().slot(arg);
         break;
       }
 
       case Instruction::GetProperty: {
-        const auto instance = get_object<InstanceObject>(stack_.top());
-        if (not instance) {
-          throw make_runtime_error("Only instances have properties.");
-        }
-
-        const auto name = read_string();
-        const auto& field = instance->field(name);
-
-        if (field) {
-          stack_.discard();
-          stack_.push(field->second);
-        }
-        else if (const auto& method = instance->cls().method(name)) {
-          const auto new_method =
-              make_object<MethodObject>(*method->second, *instance);
-          stack_.discard();
-          stack_.emplace(InPlace<ObjectPtr>(), new_method);
-        }
-        else {
-          throw make_runtime_error(
-              "Undefined property '" + name->as_std_string() + "'.");
-        }
+        const auto name = read_string(ip);
+        store_registers();
+        execute_get_property(name);
+        load_registers();
         break;
       }
 
       case Instruction::GetSuperFunc: {
-        const auto cls_value = stack_.pop();
-        const auto cls = get_object<ClassObject>(cls_value);
-        const auto instance = get_object<InstanceObject>(stack_.top());
-        const auto name = read_string();
-
-        if (const auto& method_elem = cls->method(name)) {
-          auto method =
-              make_object<MethodObject>(*method_elem->second, *instance);
-          stack_.discard();
-          stack_.emplace(InPlace<ObjectPtr>(), method);
-        }
-        else {
-          throw make_runtime_error(
-              "Undefined property '" + name->as_std_string() + "'.");
-        }
+        const auto name = read_string(ip);
+        store_registers();
+        execute_get_super_func(name);
+        load_registers();
         break;
       }
 
       case Instruction::GetUpvalue: {
-        const auto slot = read_integer<InstrArgUByte>();
-        stack_.push(call_stack_.top().closure()->upvalue(slot)->value());
+        const auto slot = read_integer<InstrArgUByte>(ip);
+        *sp++ = call_stack_.top().closure()->upvalue(slot)->value();
         break;
       }
 
       case Instruction::Greater: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
-        check_number_operands(first, second);
-        stack_.emplace(InPlace<bool>(),
+        const auto second = *--sp;
+        const auto first = *--sp;
+        check_number_operands(first, second, ip);
+        *sp++ = Value(InPlace<bool>(),
                        unsafe_get<double>(first) > unsafe_get<double>(second));
         break;
       }
 
-      case Instruction::Invoke: {
-        const auto name = read_string();
-        const auto num_args = read_integer<InstrArgUByte>();
-
-        const auto instance = get_object<InstanceObject>(stack_.top(num_args));
-        if (not instance) {
-          throw make_runtime_error("Only instances have methods.");
-        }
-
-        const auto& field = instance->field(name);
+      case Instruction::GreaterNumbers: {
+        const auto second = unsafe_get<double>(*--sp);
+        const auto first = unsafe_get<double>(*--sp);
+        *sp++ = Value(InPlace<bool>(), first > second);
+        break;
+      }
 
-        if (field) {
-          if (not holds_alternative<ObjectPtr>(field->second)) {
-            throw make_runtime_error("Can only call functions and classes.");
-          }
-          call_object(num_args, unsafe_get<ObjectPtr>(field->second));
-        }
-        else if (const auto& method = instance->cls().method(name)) {
-          call_object(num_args, method->second);
-        }
-        else {
-          throw make_runtime_error(
-              "Undefined property '" + name->as_std_string() + "'.");
-        }
+      case Instruction::Invoke: {
+        const auto name = read_string(ip);
+        const auto num_args = read_integer<InstrArgUByte>(ip);
+        store_registers();
+        execute_invoke(name, num_args);
+        load_registers();
         break;
       }
 
       case Instruction::Jump:
-        ip_ += read_integer<InstrArgUShort>();
+        ip += read_integer<InstrArgUShort>(ip);
+        break;
+
+      case Instruction::JumpIfTrue: {
+        const auto jmp = read_integer<InstrArgUShort>(ip);
+        if (is_truthy(sp[-1])) {
+          ip += jmp;
+        }
         break;
+      }
 
       case Instruction::Less: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
-        check_number_operands(first, second);
-        stack_.emplace(InPlace<bool>(),
+        const auto second = *--sp;
+        const auto first = *--sp;
+        check_number_operands(first, second, ip);
+        *sp++ = Value(InPlace<bool>(),
                        unsafe_get<double>(first) < unsafe_get<double>(second));
         break;
       }
 
+      case Instruction::LessNumbers: {
+        const auto second = unsafe_get<double>(*--sp);
+        const auto first = unsafe_get<double>(*--sp);
+        *sp++ = Value(InPlace<bool>(), first < second);
+        break;
+      }
+
       case Instruction::LoadConstant:
-        stack_.push(read_constant());
+        *sp++ = read_constant(ip);
         break;
 
       case Instruction::Loop:
-        ip_ -= read_integer<InstrArgUShort>();
+        ip -= read_integer<InstrArgUShort>(ip);
         break;
 
       case Instruction::Multiply: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
-        check_number_operands(first, second);
-        stack_.emplace(unsafe_get<double>(first) * unsafe_get<double>(second));
+        const auto second = *--sp;
+        const auto first = *--sp;
+        check_number_operands(first, second, ip);
+        *sp++ = Value(unsafe_get<double>(first) * unsafe_get<double>(second));
+        break;
+      }
+
+      case Instruction::MultiplyNumbers: {
+        const auto second = unsafe_get<double>(*--sp);
+        const auto first = unsafe_get<double>(*--sp);
+        *sp++ = Value(first * second);
         break;
       }
 
       case Instruction::Negate: {
-        if (not holds_alternative<double>(stack_.top())) {
-          throw make_runtime_error("Unary operand must be a number.");
+        if (not holds_alternative<double>(sp[-1])) {
+          throw make_runtime_error("Unary operand must be a number.", ip);
         }
-        const auto number = unsafe_get<double>(stack_.pop());
-        stack_.emplace(-number);
+        const auto number = unsafe_get<double>(*--sp);
+        *sp++ = Value(-number);
+        break;
+      }
+
+      case Instruction::NegateNumber: {
+        const auto number = unsafe_get<double>(*--sp);
+        *sp++ = Value(-number);
         break;
       }
 
       case Instruction::Nil:
-        stack_.emplace();
+        *sp++ = Value();
         break;
 
       case Instruction::Not:
-        stack_.emplace(InPlace<bool>(), not is_truthy(stack_.pop()));
+        sp[-1] = Value(InPlace<bool>(), not is_truthy(sp[-1]));
         break;
 
       case Instruction::Pop:
-        stack_.pop();
+        --sp;
         break;
 
       case Instruction::Print:
-        print_object(stack_.pop());
+        print_object(*--sp);
         break;
 
       case Instruction::Return: {
-        const auto result = stack_.pop();
         close_upvalues(call_stack_.top().slot(0));
-        const auto frame = call_stack_.pop();
+        auto frame = call_stack_.pop();
 
+        // The top-level code doesn't leave a result on the stack.
         if (call_stack_.size() == 0) {
+          store_registers();
           return;
         }
 
-        // We add one here to discard the function that was previously called
-        stack_.discard(
-            static_cast<std::size_t>(&stack_.top() - &frame.slot(0)) + 1);
-        stack_.push(result);
+        // The result replaces the function that was called, and the rest of
+        // the frame is discarded.
+        const auto result = sp[-1];
+        sp = &frame.slot(0);
+        *sp++ = result;
         code_object_ = frame.prev_code_object();
-        ip_ = frame.prev_ip();
+        ip = frame.prev_ip();
         break;
       }
 
       case Instruction::SetGlobal: {
-        const auto varname = read_string();
-
-        if (globals_.count(varname) == 0) {
-          throw make_runtime_error(
-              "Undefined variable '" + varname->as_std_string() + "'.");
-        }
-
-        globals_[varname] = stack_.top();
+        const auto name = read_string(ip);
+        store_registers();
+        execute_set_global(name);
+        load_registers();
         break;
       }
 
       case Instruction::SetLocal: {
-        const auto arg = read_integer<InstrArgUByte>();
-        call_stack_.top().slot(arg) = stack_.top();
+        const auto arg = read_integer<InstrArgUByte>(ip);
+        call_stack_.top().slot(arg) = sp[-1];
         break;
       }
 
       case Instruction::SetProperty: {
-        const auto obj = get_object<InstanceObject>(stack_.top(1));
-        if (not obj) {
-          throw make_runtime_error("Only instances have fields.");
-        }
-
-        const auto name = read_string();
-
-        obj->set_field(name, stack_.top());
-        const auto value = stack_.pop();
-        stack_.pop();
-        stack_.push(value);
+        const auto name = read_string(ip);
+        store_registers();
+        execute_set_property(name);
+        load_registers();
         break;
       }
 
       case Instruction::SetUpvalue: {
-        const auto slot = read_integer<InstrArgUByte>();
-        call_stack_.top().closure()->upvalue(slot)->set_value(stack_.top());
+        const auto slot = read_integer<InstrArgUByte>(ip);
+        call_stack_.top().closure()->upvalue(slot)->set_value(sp[-1]);
         break;
       }
 
       case Instruction::Subtract: {
-        const auto second = stack_.pop();
-        const auto first = stack_.pop();
-        check_number_operands(first, second);
-        stack_.emplace(unsafe_get<double>(first) - unsafe_get<double>(second));
+        const auto second = *--sp;
+        const auto first = *--sp;
+        check_number_operands(first, second, ip);
+        *sp++ = Value(unsafe_get<double>(first) - unsafe_get<double>(second));
+        break;
+      }
+
+      case Instruction::SubtractNumbers: {
+        const auto second = unsafe_get<double>(*--sp);
+        const auto first = unsafe_get<double>(*--sp);
+        *sp++ = Value(first - second);
         break;
       }
 
+      case Instruction::TailCall:
+        store_registers();
+        execute_tail_call();
+        load_registers();
+        break;
+
       case Instruction::True:
-        stack_.emplace(InPlace<bool>(), true);
+        *sp++ = Value(InPlace<bool>(), true);
+        break;
+
+      case Instruction::Wide:
+        store_registers();
+        execute_wide();
+        load_registers();
         break;
 
       default:
@@ -421,13 +527,15 @@ namespace loxx
 
   void VirtualMachine::print_object(Value variant) const
   {
-    std::cout << variant << std::endl;
+    // Output is flushed when the program exits or reports an error, so there's
+    // no need to do it for each print.
+    std::cout << variant << '\n';
   }
 
 
   void VirtualMachine::execute_call()
   {
-    const auto num_args = read_integer<InstrArgUByte>();
+    const auto num_args = read_integer<InstrArgUByte>(ip_);
 
     if (not holds_alternative<ObjectPtr>(stack_.top(num_args))) {
       throw make_runtime_error("Can only call functions and classes.");
@@ -439,6 +547,56 @@ namespace loxx
   }
 
 
+  void VirtualMachine::execute_tail_call()
+  {
+    const auto num_args = read_integer<InstrArgUByte>(ip_);
+    auto& callee = stack_.top(num_args);
+
+    if (not holds_alternative<ObjectPtr>(callee)) {
+      throw make_runtime_error("Can only call functions and classes.");
+    }
+
+    const auto obj = unsafe_get<ObjectPtr>(callee);
+    ClosureObject* closure = nullptr;
+
+    if (obj->type() == ObjectType::Closure) {
+      closure = static_cast<ClosureObject*>(obj);
+    }
+    else if (obj->type() == ObjectType::Method) {
+      closure = static_cast<MethodObject*>(obj)->closure();
+    }
+
+    // Classes and natives don't use a frame of their own, and a call with
+    // the wrong number of arguments is about to fail, so these are left to
+    // the usual call machinery.
+    if (closure == nullptr or closure->function().arity() != num_args) {
+      call_object(num_args, obj);
+      return;
+    }
+
+    if (obj->type() == ObjectType::Method) {
+      unsafe_get<ObjectPtr>(callee) =
+          static_cast<MethodObject*>(obj)->instance();
+    }
+
+    // Slide the callee and its arguments down over the current frame, which
+    // is then reused for the callee. The frame keeps the caller's return
+    // address.
+    auto& frame = call_stack_.top();
+    close_upvalues(frame.slot(0));
+
+    const auto first = &callee;
+    std::copy(first, first + num_args + 1, &frame.slot(0));
+    stack_.discard(static_cast<std::size_t>(first - &frame.slot(0)));
+
+    frame = StackFrame(frame.prev_ip(), frame.prev_code_object(),
+                       frame.slot(0), closure);
+    code_object_ = closure->function().code_object();
+    ip_ = code_object_->bytecode.data();
+    reserve_stack(code_object_->stack_size);
+  }
+
+
   void VirtualMachine::call_object(
       const InstrArgUByte num_args, const ObjectPtr obj)
   {
@@ -481,7 +639,7 @@ namespace loxx
         const auto result = native->call(&stack_.top(num_args),
                                          static_cast<unsigned int>(num_args));
         stack_.discard(num_args);
-        stack_.top(num_args) = result;
+        stack_.top() = result;
 
         break;
       }
@@ -492,17 +650,129 @@ namespace loxx
   }
 
 
+  void VirtualMachine::execute_wide()
+  {
+    // The prefix widens the index operands of the instruction that follows,
+    // which is otherwise executed as usual.
+    const auto instruction = static_cast<Instruction>(*ip_++);
+
+    switch (instruction) {
+
+    case Instruction::CreateClass:
+      execute_create_class(read_string<InstrArgUShort>(ip_), false);
+      break;
+
+    case Instruction::CreateClosure:
+      execute_create_closure<InstrArgUShort>();
+      break;
+
+    case Instruction::CreateMethod:
+      execute_create_method(read_string<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::CreateSubclass:
+      execute_create_class(read_string<InstrArgUShort>(ip_), true);
+      break;
+
+    case Instruction::DefineGlobal:
+      globals_[read_string<InstrArgUShort>(ip_)] = stack_.pop();
+      break;
+
+    case Instruction::GetGlobal:
+      execute_get_global(read_string<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::GetLocal: {
+      const auto arg = read_integer<InstrArgUShort>(ip_);
+      stack_.push(call_stack_.top().slot(arg));
+      break;
+    }
+
+    case Instruction::GetProperty:
+      execute_get_property(read_string<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::GetSuperFunc:
+      execute_get_super_func(read_string<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::GetUpvalue: {
+      const auto slot = read_integer<InstrArgUShort>(ip_);
+      stack_.push(call_stack_.top().closure()->upvalue(slot)->value());
+      break;
+    }
+
+    case Instruction::Invoke: {
+      const auto name = read_string<InstrArgUShort>(ip_);
+      execute_invoke(name, read_integer<InstrArgUByte>(ip_));
+      break;
+    }
+
+    case Instruction::LoadConstant:
+      stack_.push(read_constant<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::SetGlobal:
+      execute_set_global(read_string<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::SetLocal: {
+      const auto arg = read_integer<InstrArgUShort>(ip_);
+      call_stack_.top().slot(arg) = stack_.top();
+      break;
+    }
+
+    case Instruction::SetProperty:
+      execute_set_property(read_string<InstrArgUShort>(ip_));
+      break;
+
+    case Instruction::SetUpvalue: {
+      const auto slot = read_integer<InstrArgUShort>(ip_);
+      call_stack_.top().closure()->upvalue(slot)->set_value(stack_.top());
+      break;
+    }
+
+    default:
+      std::cout << "Unknown wide instruction: "
+                << static_cast<unsigned int>(instruction) << std::endl;
+      break;
+    }
+  }
+
+
+  void VirtualMachine::execute_create_class(StringObject* name,
+                                            const bool has_superclass)
+  {
+    ClassObject* super = nullptr;
+
+    if (has_superclass) {
+      super = get_object<ClassObject>(stack_.top());
+
+      if (not super) {
+        throw make_runtime_error("Superclass must be a class.");
+      }
+    }
+
+    const auto cls = make_object<ClassObject>(name->as_std_string(), super);
+    stack_.emplace(InPlace<ObjectPtr>(), cls);
+  }
+
+
+  template <typename T>
   void VirtualMachine::execute_create_closure()
   {
-    const auto& func_value = read_constant();
+    const auto& func_value = read_constant<T>(ip_);
     const auto& func_obj = unsafe_get<ObjectPtr>(func_value);
     auto func = static_cast<FuncObject*>(func_obj);
 
     auto closure = make_object<ClosureObject>(func);
+    // Capturing upvalues can trigger garbage collection, so the closure has
+    // to be reachable first.
+    stack_.push(Value(InPlace<ObjectPtr>(), closure));
 
     for (unsigned int i = 0; i < closure->num_upvalues(); ++i) {
-      const auto is_local = read_integer<InstrArgUByte>() != 0;
-      const auto index = read_integer<InstrArgUByte>();
+      const auto is_local = read_integer<InstrArgUByte>(ip_) != 0;
+      const auto index = read_integer<T>(ip_);
 
       if (is_local) {
         closure->set_upvalue(
@@ -513,46 +783,168 @@ namespace loxx
             i, call_stack_.top().closure()->upvalue(index));
       }
     }
+  }
 
-    stack_.push(Value(InPlace<ObjectPtr>(), closure));
+
+  void VirtualMachine::execute_create_method(StringObject* name)
+  {
+    const auto cls = get_object<ClassObject>(stack_.top(1));
+    const auto closure = get_object<ClosureObject>(stack_.top());
+
+    cls->set_method(name, closure);
+    stack_.discard();
   }
 
 
-  UpvalueObject* VirtualMachine::capture_upvalue(Value& local)
+  inline void VirtualMachine::execute_get_global(StringObject* name)
   {
-    if (open_upvalues_.empty()) {
-      open_upvalues_.push_back(make_object<UpvalueObject>(local));
-      return open_upvalues_.back();
+    const auto& global = globals_.get(name);
+
+    if (not global) {
+      undefined_variable(name);
     }
 
-    auto upvalue = open_upvalues_.end();
+    stack_.push(global->second);
+  }
 
-    for (auto it = open_upvalues_.begin(); it != open_upvalues_.end(); ++it) {
-      if (&(*it)->value() == &local) {
-        return *it;
-      }
-      else if (&(*it)->value() < &local) {
-        upvalue = it;
-        break;
+
+  inline void VirtualMachine::execute_set_global(StringObject* name)
+  {
+    if (globals_.count(name) == 0) {
+      undefined_variable(name);
+    }
+
+    globals_[name] = stack_.top();
+  }
+
+
+  inline void VirtualMachine::execute_get_property(StringObject* name)
+  {
+    const auto instance = get_object<InstanceObject>(stack_.top());
+    if (not instance) {
+      throw make_runtime_error("Only instances have properties.");
+    }
+
+    const auto& field = instance->field(name);
+
+    if (field) {
+      stack_.discard();
+      stack_.push(field->second);
+    }
+    else if (const auto& method = instance->cls().method(name)) {
+      const auto new_method =
+          make_object<MethodObject>(*method->second, *instance);
+      stack_.discard();
+      stack_.emplace(InPlace<ObjectPtr>(), new_method);
+    }
+    else {
+      undefined_property(name);
+    }
+  }
+
+
+  inline void VirtualMachine::execute_set_property(StringObject* name)
+  {
+    const auto obj = get_object<InstanceObject>(stack_.top(1));
+    if (not obj) {
+      throw make_runtime_error("Only instances have fields.");
+    }
+
+    obj->set_field(name, stack_.top());
+    const auto value = stack_.pop();
+    stack_.pop();
+    stack_.push(value);
+  }
+
+
+  void VirtualMachine::execute_get_super_func(StringObject* name)
+  {
+    const auto cls_value = stack_.pop();
+    const auto cls = get_object<ClassObject>(cls_value);
+    const auto instance = get_object<InstanceObject>(stack_.top());
+
+    if (const auto& method_elem = cls->method(name)) {
+      auto method =
+          make_object<MethodObject>(*method_elem->second, *instance);
+      stack_.discard();
+      stack_.emplace(InPlace<ObjectPtr>(), method);
+    }
+    else {
+      undefined_property(name);
+    }
+  }
+
+
+  inline void VirtualMachine::execute_invoke(StringObject* name,
+                                      const InstrArgUByte num_args)
+  {
+    const auto instance = get_object<InstanceObject>(stack_.top(num_args));
+    if (not instance) {
+      if (get_object<StringBuilderObject>(stack_.top(num_args))) {
+        const auto& method = string_builder_methods_.get(name);
+
+        if (not method) {
+          undefined_property(name);
+        }
+        call_object(num_args, method->second);
+        return;
       }
+
+      throw make_runtime_error("Only instances have methods.");
     }
 
-    const auto new_upvalue =
-        open_upvalues_.insert(upvalue, make_object<UpvalueObject>(local));
+    const auto& field = instance->field(name);
 
-    return *new_upvalue;
+    if (field) {
+      if (not holds_alternative<ObjectPtr>(field->second)) {
+        throw make_runtime_error("Can only call functions and classes.");
+      }
+      call_object(num_args, unsafe_get<ObjectPtr>(field->second));
+    }
+    else if (const auto& method = instance->cls().method(name)) {
+      call_object(num_args, method->second);
+    }
+    else {
+      undefined_property(name);
+    }
   }
 
 
-  void VirtualMachine::close_upvalues(Value& last)
+  UpvalueObject* VirtualMachine::capture_upvalue(Value& local)
   {
-    auto it = open_upvalues_.begin();
+    UpvalueObject* prev = nullptr;
+    auto upvalue = open_upvalues_;
+
+    while (upvalue != nullptr and &upvalue->value() > &local) {
+      prev = upvalue;
+      upvalue = upvalue->next();
+    }
+
+    if (upvalue != nullptr and &upvalue->value() == &local) {
+      return upvalue;
+    }
 
-    while (it != open_upvalues_.end() and &(*it)->value() >= &last) {
-      (*it)->close();
+    const auto new_upvalue = make_object<UpvalueObject>(local);
+    new_upvalue->set_next(upvalue);
 
-      ++it;
-      open_upvalues_.pop_front();
+    if (prev == nullptr) {
+      open_upvalues_ = new_upvalue;
+    }
+    else {
+      prev->set_next(new_upvalue);
+    }
+
+    return new_upvalue;
+  }
+
+
+  void VirtualMachine::close_upvalues(Value& last)
+  {
+    while (open_upvalues_ != nullptr and &open_upvalues_->value() >= &last) {
+      const auto upvalue = open_upvalues_;
+      upvalue->close();
+      open_upvalues_ = upvalue->next();
+      upvalue->set_next(nullptr);
     }
   }
 
@@ -564,13 +956,54 @@ namespace loxx
       incorrect_arg_num(closure->function().arity(), num_args);
     }
 
-    if (call_stack_.size() == max_call_frames) {
-      throw make_runtime_error("Stack overflow.");
+    if (call_stack_.size() == call_stack_.capacity()) {
+      if (call_stack_.size() == max_call_frames_) {
+        throw make_runtime_error("Stack overflow.");
+      }
+
+      const auto capacity = call_stack_.capacity();
+      call_stack_.reserve(
+          capacity <= max_call_frames_ / 2 ? 2 * capacity : max_call_frames_);
     }
 
+    const auto code_object = closure->function().code_object();
+    reserve_stack(code_object->stack_size);
+
     call_stack_.emplace(ip_, code_object_, stack_.top(num_args), closure);
-    code_object_ = closure->function().code_object();
-    ip_ = code_object_->bytecode.begin();
+    code_object_ = code_object;
+    ip_ = code_object_->bytecode.data();
+  }
+
+
+  void VirtualMachine::grow_stack(const std::size_t required_size)
+  {
+    if (required_size > max_stack_size_) {
+      throw make_runtime_error("Stack overflow.");
+    }
+
+    // Doubling is capped before it's done, so it can't wrap around.
+    const auto capacity = stack_.capacity();
+    const auto doubled =
+        capacity <= max_stack_size_ / 2 ? 2 * capacity : max_stack_size_;
+
+    const auto old_base = stack_.data();
+    stack_.reserve(std::max(required_size, doubled));
+    const auto new_base = stack_.data();
+
+    if (new_base == old_base) {
+      return;
+    }
+
+    // Frames and open upvalues point into the stack, so they have to follow
+    // it to its new home.
+    for (std::size_t i = 0; i < call_stack_.size(); ++i) {
+      call_stack_.get(i).rebase(old_base, new_base);
+    }
+
+    for (auto upvalue = open_upvalues_; upvalue != nullptr;
+         upvalue = upvalue->next()) {
+      upvalue->rebase(old_base, new_base);
+    }
   }
 
 
@@ -587,37 +1020,36 @@ namespace loxx
   }
 
 
-  Value VirtualMachine::read_constant()
-  {
-    return code_object_->constants[read_integer<InstrArgUByte>()];
-  }
-
 
-  loxx::StringObject* VirtualMachine::read_string()
-  {
-    return get_object<StringObject>(read_constant());
-  }
 
 
   void VirtualMachine::check_number_operands(
-      const Value& first, const Value& second) const
+      const Value& first, const Value& second,
+      const CodeObject::InsPtr ip) const
   {
     if (not holds_alternative<double>(first) or
         not holds_alternative<double>(second)) {
-      throw make_runtime_error("Binary operands must both be numbers.");
+      throw make_runtime_error("Binary operands must both be numbers.", ip);
     }
   }
 
 
-  bool VirtualMachine::are_equal(const Value& first,
-                                 const Value& second) const
+  inline bool VirtualMachine::are_equal(const Value& first,
+                                        const Value& second) const
   {
     if (first.index()  == Value::npos and
         second.index() == Value::npos) {
       return true;
     }
+    if (first == second) {
+      return true;
+    }
 
-    return first == second;
+    // Concatenated strings aren't interned, so they're compared by value.
+    const auto first_str = get_object<StringObject>(first);
+    const auto second_str = get_object<StringObject>(second);
+
+    return first_str and second_str and first_str->equals(*second_str);
   }
 
 
@@ -643,9 +1075,30 @@ namespace loxx
   }
 
 
+  void VirtualMachine::undefined_variable(const StringObject* name) const
+  {
+    throw make_runtime_error(
+        "Undefined variable '" + name->as_std_string() + "'.");
+  }
+
+
+  void VirtualMachine::undefined_property(const StringObject* name) const
+  {
+    throw make_runtime_error(
+        "Undefined property '" + name->as_std_string() + "'.");
+  }
+
+
   RuntimeError VirtualMachine::make_runtime_error(const std::string& msg) const
   {
-    const auto pos = std::distance(code_object_->bytecode.begin(), ip_);
+    return make_runtime_error(msg, ip_);
+  }
+
+
+  RuntimeError VirtualMachine::make_runtime_error(
+      const std::string& msg, const CodeObject::InsPtr ip) const
+  {
+    const auto pos = ip - code_object_->bytecode.data();
     return RuntimeError(get_current_line(*code_object_, pos), msg);
   }
 }
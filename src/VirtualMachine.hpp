@@ -21,7 +21,6 @@
 #define LOXX_VIRTUALMACHINE_HPP
 
 #include <functional>
-#include <list>
 #include <unordered_map>
 #include <vector>
 
@@ -42,52 +41,107 @@ namespace loxx
   class VirtualMachine
   {
   public:
-    explicit VirtualMachine(const bool debug);
+    explicit VirtualMachine(
+        const bool debug,
+        const std::size_t max_call_frames = default_max_call_frames,
+        const std::size_t max_stack_size = default_max_stack_size);
 
     void execute(std::unique_ptr<CodeObject> code_object);
 
+    ProbeStats global_probe_stats() const { return globals_.probe_stats(); }
+
   private:
     void print_object(Value object) const;
     void execute_call();
+    void execute_tail_call();
     void call_object(const InstrArgUByte num_args, ObjectPtr const obj);
+    void execute_wide();
+    void execute_create_class(StringObject* name, const bool has_superclass);
+    template <typename T>
     void execute_create_closure();
+    void execute_create_method(StringObject* name);
+    void execute_get_global(StringObject* name);
+    void execute_set_global(StringObject* name);
+    void execute_get_property(StringObject* name);
+    void execute_set_property(StringObject* name);
+    void execute_get_super_func(StringObject* name);
+    void execute_invoke(StringObject* name, const InstrArgUByte num_args);
 
     UpvalueObject* capture_upvalue(Value& local);
     void close_upvalues(Value& last);
 
     void call(ClosureObject* closure, const std::size_t num_args);
+    void reserve_stack(const std::size_t num_values);
+    void grow_stack(const std::size_t required_size);
     void print_stack() const;
 
     template <typename T>
-    T read_integer();
-    Value read_constant();
-    loxx::StringObject* read_string();
-    void check_number_operands(const Value& first,
-                               const Value& second) const;
+    static T read_integer(CodeObject::InsPtr& ip);
+    template <typename T = InstrArgUByte>
+    Value read_constant(CodeObject::InsPtr& ip) const;
+    template <typename T = InstrArgUByte>
+    StringObject* read_string(CodeObject::InsPtr& ip) const;
+    void check_number_operands(const Value& first, const Value& second,
+                               const CodeObject::InsPtr ip) const;
     bool are_equal(const Value& first, const Value& second) const;
     bool is_truthy(const Value& value) const;
     void incorrect_arg_num(const InstrArgUByte arity,
                            const InstrArgUByte num_args) const;
+    void undefined_variable(const StringObject* name) const;
+    void undefined_property(const StringObject* name) const;
     RuntimeError make_runtime_error(const std::string& msg) const;
+    RuntimeError make_runtime_error(const std::string& msg,
+                                    const CodeObject::InsPtr ip) const;
 
     bool debug_;
+    std::size_t max_call_frames_;
+    std::size_t max_stack_size_;
     CodeObject::InsPtr ip_;
     const CodeObject* code_object_;
     StringHashTable<Value> globals_;
-    Stack<Value, max_stack_size> stack_;
-    Stack<StackFrame, max_call_frames> call_stack_;
-    std::list<UpvalueObject*> open_upvalues_;
+    Stack<Value> stack_;
+    Stack<StackFrame> call_stack_;
+    // Sorted by the stack slot each refers to, from the top of the stack down.
+    UpvalueObject* open_upvalues_;
     StringObject* init_lexeme_;
+    StringHashTable<NativeObject*> string_builder_methods_;
+    // Objects the VM holds on to itself, which have to outlive any garbage
+    // collection.
+    std::vector<ObjectPtr> builtins_;
   };
 
 
+  inline void VirtualMachine::reserve_stack(const std::size_t num_values)
+  {
+    const auto required_size = stack_.size() + num_values;
+
+    if (required_size > stack_.capacity()) {
+      grow_stack(required_size);
+    }
+  }
+
+
   template <typename T>
-  T VirtualMachine::read_integer()
+  T VirtualMachine::read_integer(CodeObject::InsPtr& ip)
   {
-    const T integer = read_integer_at_pos<T>(ip_);
-    ip_ += sizeof(T);
+    const T integer = read_integer_at_pos<T>(ip);
+    ip += sizeof(T);
     return integer;
   }
+
+
+  template <typename T>
+  Value VirtualMachine::read_constant(CodeObject::InsPtr& ip) const
+  {
+    return code_object_->constants[read_integer<T>(ip)];
+  }
+
+
+  template <typename T>
+  StringObject* VirtualMachine::read_string(CodeObject::InsPtr& ip) const
+  {
+    return get_object<StringObject>(read_constant<T>(ip));
+  }
 }
 
 #endif // LOXX_VIRTUALMACHINE_HPP
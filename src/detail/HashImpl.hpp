@@ -20,6 +20,7 @@
 #ifndef LOXX_HASHIMPL_HPP
 #define LOXX_HASHIMPL_HPP
 
+#include <algorithm>
 #include <vector>
 
 #include "../Optional.hpp"
@@ -27,6 +28,29 @@
 
 namespace loxx
 {
+  // A summary of how far keys sit from the slot their hash maps to.
+  struct ProbeStats
+  {
+    double mean_probe_length() const
+    {
+      return num_keys == 0 ?
+             0.0 : static_cast<double>(total_probe_length) / num_keys;
+    }
+
+    ProbeStats& operator+=(const ProbeStats& other)
+    {
+      num_keys += other.num_keys;
+      total_probe_length += other.total_probe_length;
+      max_probe_length = std::max(max_probe_length, other.max_probe_length);
+      return *this;
+    }
+
+    std::size_t num_keys;
+    std::size_t total_probe_length;
+    std::size_t max_probe_length;
+  };
+
+
   namespace detail
   {
     constexpr std::size_t default_size = 4;
@@ -36,27 +60,51 @@ namespace loxx
         static_cast<std::size_t>(default_size * load_factor);
 
 
+    // Robin Hood probing: an element being inserted takes the place of any
+    // element that's closer to its ideal slot, which keeps probe lengths
+    // short and even. Each table also tracks the longest probe length any of
+    // its elements has needed, so a lookup only ever compares keys and can
+    // give up after that many slots instead of carrying on to an empty one.
     template <typename Key, typename Elem, typename HashStruct>
     class HashImpl
     {
     protected:
-      template <typename Fn>
-      static void remove(HashStruct& obj, const Key& key, Fn add_func);
+      static void remove(HashStruct& obj, const Key& key);
 
       static void rehash(HashStruct& obj);
 
+      // Returns the slot holding the key, or the size of the table if it
+      // isn't there.
       static std::size_t find_pos(
           const HashStruct& obj, const Key& key, const std::size_t hash);
 
-      static std::size_t find_new_pos(
+      // Returns the element holding the key, or an empty one if it isn't
+      // there.
+      static const Elem& find_elem(
           const HashStruct& obj, const Key& key, const std::size_t hash);
+
+      // Returns the slot a key that isn't in the table should be inserted
+      // into. That slot may hold another element, which insert_at moves out
+      // of the way.
+      static std::size_t find_new_pos(
+          const HashStruct& obj, const std::size_t hash);
+
+      static void insert_at(HashStruct& obj, const std::size_t pos, Elem elem);
+
+      static std::size_t find_probe_length(
+          const HashStruct& obj, const Key& key);
+
+      static ProbeStats compute_probe_stats(const HashStruct& obj);
+
+    private:
+      static std::size_t probe_length_at(
+          const HashStruct& obj, const std::size_t pos);
     };
 
 
     template <typename Key, typename Elem, typename HashStruct>
-    template <typename Fn>
     void HashImpl<Key, Elem, HashStruct>::remove(
-        HashStruct& obj, const Key& key, Fn add_func)
+        HashStruct& obj, const Key& key)
     {
       const auto hash = obj.hash_func_(key);
       auto pos = find_pos(obj, key, hash);
@@ -68,15 +116,19 @@ namespace loxx
       obj.data_[pos].reset();
       --obj.num_used_slots_;
 
+      // Shift the rest of the run back a slot, up to the first element that
+      // is already in its ideal slot. This only shortens probe lengths, so
+      // the table's longest probe length is still an upper bound.
       for (;;) {
-        pos = (pos + 1) & obj.mask_;
+        const auto next = (pos + 1) & obj.mask_;
 
-        if (not obj.data_[pos]) {
+        if (not obj.data_[next] or probe_length_at(obj, next) == 0) {
           break;
         }
 
-        const auto datum = std::move(obj.data_[pos]);
-        add_func(obj, datum);
+        obj.data_[pos] = std::move(obj.data_[next]);
+        obj.data_[next].reset();
+        pos = next;
       }
     }
 
@@ -87,6 +139,7 @@ namespace loxx
       const auto new_capacity = obj.data_.size() * growth_factor;
       obj.mask_ = new_capacity - 1;
       obj.max_used_slots_ *= detail::growth_factor;
+      obj.max_probe_length_ = 0;
 
       std::vector<Elem> old_data(new_capacity);
       std::swap(obj.data_, old_data);
@@ -98,8 +151,7 @@ namespace loxx
         }
 
         const auto hash = obj.hash_func_(obj.key_extractor_(elem));
-        const auto new_pos = find_new_pos(obj, obj.key_extractor_(elem), hash);
-        obj.data_[new_pos] = elem;
+        insert_at(obj, find_new_pos(obj, hash), std::move(elem));
       }
     }
 
@@ -108,35 +160,127 @@ namespace loxx
     std::size_t HashImpl<Key, Elem, HashStruct>::find_pos(
         const HashStruct& obj, const Key& key, const std::size_t hash)
     {
-      const auto init_pos = hash & obj.mask_;
+      auto pos = hash & obj.mask_;
 
-      auto pos = init_pos;
-      do {
-        if (obj.data_[pos] and
-            obj.compare_(obj.key_extractor_(obj.data_[pos]), key)) {
+      for (std::size_t length = 0; obj.data_[pos]; ++length) {
+        if (obj.compare_(obj.key_extractor_(obj.data_[pos]), key)) {
           return pos;
         }
+        if (length == obj.max_probe_length_) {
+          break;
+        }
         pos = (pos + 1) & obj.mask_;
-      } while (pos != init_pos);
+      }
 
       return obj.data_.size();
     }
 
 
+    template <typename Key, typename Elem, typename HashStruct>
+    const Elem& HashImpl<Key, Elem, HashStruct>::find_elem(
+        const HashStruct& obj, const Key& key, const std::size_t hash)
+    {
+      auto pos = hash & obj.mask_;
+
+      for (std::size_t length = 0; obj.data_[pos]; ++length) {
+        if (obj.compare_(obj.key_extractor_(obj.data_[pos]), key)) {
+          return obj.data_[pos];
+        }
+        if (length == obj.max_probe_length_) {
+          break;
+        }
+        pos = (pos + 1) & obj.mask_;
+      }
+
+      return HashStruct::missing_;
+    }
+
+
     template<typename Key, typename Elem, typename HashStruct>
     std::size_t HashImpl<Key, Elem, HashStruct>::find_new_pos(
-        const HashStruct& obj, const Key& key, const std::size_t hash)
+        const HashStruct& obj, const std::size_t hash)
     {
-      const auto init_pos = hash & obj.mask_;
+      auto pos = hash & obj.mask_;
 
-      auto pos = init_pos;
-      while (true) {
-        if (not obj.data_[pos] or
-            obj.compare_(obj.key_extractor_(obj.data_[pos]), key)) {
+      for (std::size_t length = 0; obj.data_[pos]; ++length) {
+        if (probe_length_at(obj, pos) < length) {
           return pos;
         }
         pos = (pos + 1) & obj.mask_;
       }
+
+      return pos;
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    void HashImpl<Key, Elem, HashStruct>::insert_at(
+        HashStruct& obj, const std::size_t pos, Elem elem)
+    {
+      // Moving the rest of the run along a slot keeps it in order, so the
+      // element can go straight into the slot it was given.
+      auto last = pos;
+      while (obj.data_[last]) {
+        last = (last + 1) & obj.mask_;
+      }
+
+      while (last != pos) {
+        const auto prev = (last - 1) & obj.mask_;
+        obj.data_[last] = std::move(obj.data_[prev]);
+        obj.max_probe_length_ =
+            std::max(obj.max_probe_length_, probe_length_at(obj, last));
+        last = prev;
+      }
+
+      obj.data_[pos] = std::move(elem);
+      obj.max_probe_length_ =
+          std::max(obj.max_probe_length_, probe_length_at(obj, pos));
+    }
+
+
+    template<typename Key, typename Elem, typename HashStruct>
+    std::size_t HashImpl<Key, Elem, HashStruct>::find_probe_length(
+        const HashStruct& obj, const Key& key)
+    {
+      const auto hash = obj.hash_func_(key);
+      const auto pos = find_pos(obj, key, hash);
+
+      // A missing key didn't end up anywhere, so there's no length to give.
+      if (pos == obj.data_.size()) {
+        return 0;
+      }
+
+      return (pos - hash) & obj.mask_;
+    }
+
+
+    template<typename Key, typename Elem, typename HashStruct>
+    ProbeStats HashImpl<Key, Elem, HashStruct>::compute_probe_stats(
+        const HashStruct& obj)
+    {
+      ProbeStats stats{0, 0, 0};
+
+      for (std::size_t pos = 0; pos < obj.data_.size(); ++pos) {
+        if (not obj.data_[pos]) {
+          continue;
+        }
+
+        const auto length = probe_length_at(obj, pos);
+        ++stats.num_keys;
+        stats.total_probe_length += length;
+        stats.max_probe_length = std::max(stats.max_probe_length, length);
+      }
+
+      return stats;
+    }
+
+
+    template<typename Key, typename Elem, typename HashStruct>
+    std::size_t HashImpl<Key, Elem, HashStruct>::probe_length_at(
+        const HashStruct& obj, const std::size_t pos)
+    {
+      const auto hash = obj.hash_func_(obj.key_extractor_(obj.data_[pos]));
+      return (pos - hash) & obj.mask_;
     }
   }
 }
@@ -0,0 +1,96 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_HASHSLOT_HPP
+#define LOXX_HASHSLOT_HPP
+
+#include <cstddef>
+#include <utility>
+
+#include "../Optional.hpp"
+
+
+namespace loxx
+{
+  namespace detail
+  {
+    template <typename T>
+    T* slot_key(T* item) { return item; }
+
+
+    template <typename Key, typename Value>
+    Key slot_key(const std::pair<Key, Value>& item) { return item.first; }
+
+
+    constexpr std::size_t round_up_to_power_of_two(
+        const std::size_t size, const std::size_t power = 1)
+    {
+      return power >= size ? power : round_up_to_power_of_two(size, power * 2);
+    }
+
+
+    // A slot in a table keyed on pointers. A null key marks the slot as empty,
+    // so there's no engaged flag (and no padding after it) like there would be
+    // with an Optional. The interface matches the parts of Optional that the
+    // tables use.
+    //
+    // Unless they're packed, slots are kept to a power of two in size. That's
+    // a saving for tables of pointers, and for hashed tables of Values it
+    // keeps each Value aligned and each slot index a shift, which was
+    // measurably faster than 24-byte slots.
+    template <typename Item, bool Packed = false>
+    class alignas(Packed ? alignof(Item) :
+                  round_up_to_power_of_two(sizeof(Item))) PointerKeySlot
+    {
+    public:
+      PointerKeySlot() : item_() {}
+      PointerKeySlot(Item item) : item_(std::move(item)) {}
+
+      explicit operator bool() const { return slot_key(item_) != nullptr; }
+
+      Item& operator*() { return item_; }
+      const Item& operator*() const { return item_; }
+      Item* operator->() { return &item_; }
+      const Item* operator->() const { return &item_; }
+
+      void reset() { item_ = Item(); }
+
+    private:
+      Item item_;
+    };
+
+
+    // Picks the type of the slots in a table with the given key and item
+    // types. Packed only affects slots with pointer keys.
+    template <typename Key, typename Item, bool Packed = false>
+    struct SlotFor
+    {
+      using Type = Optional<Item>;
+    };
+
+
+    template <typename Key, typename Item, bool Packed>
+    struct SlotFor<Key*, Item, Packed>
+    {
+      using Type = PointerKeySlot<Item, Packed>;
+    };
+  }
+}
+
+#endif //LOXX_HASHSLOT_HPP
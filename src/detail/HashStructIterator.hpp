@@ -20,20 +20,18 @@
 #ifndef LOXX_HASHSTRUCTITERATOR_HPP
 #define LOXX_HASHSTRUCTITERATOR_HPP
 
-#include <vector>
-
-#include "../Optional.hpp"
+#include <cstddef>
+#include <iterator>
 
 
 namespace loxx
 {
   namespace detail
   {
-    template<typename Item, typename Hash, typename Compare>
+    template <typename Item, typename Elem>
     class HashStructIterator
     {
-      using Elem = Optional<Item>;
-      using Iter = typename std::vector<Elem>::iterator;
+      using Iter = Elem*;
 
     public:
       using difference_type   = std::ptrdiff_t;
@@ -52,15 +50,15 @@ namespace loxx
         }
       }
 
-      auto operator++() -> HashStructIterator<Item, Hash, Compare>&;
+      auto operator++() -> HashStructIterator<Item, Elem>&;
 
-      auto operator++(int) -> HashStructIterator<Item, Hash, Compare>;
+      auto operator++(int) -> HashStructIterator<Item, Elem>;
 
       bool operator==(
-          const HashStructIterator<Item, Hash, Compare>& other) const;
+          const HashStructIterator<Item, Elem>& other) const;
 
       bool operator!=(
-          const HashStructIterator<Item, Hash, Compare>& other) const;
+          const HashStructIterator<Item, Elem>& other) const;
 
       auto operator*() -> reference;
 
@@ -71,9 +69,9 @@ namespace loxx
       Iter it_, finish_;
     };
 
-    template <typename Item, typename Hash, typename Compare>
-    auto HashStructIterator<Item, Hash, Compare>::operator++()
-        -> HashStructIterator<Item, Hash, Compare>&
+    template <typename Item, typename Elem>
+    auto HashStructIterator<Item, Elem>::operator++()
+        -> HashStructIterator<Item, Elem>&
     {
       ++it_;
       while (it_ != finish_ and not *it_) {
@@ -84,9 +82,9 @@ namespace loxx
     }
 
 
-    template <typename Item, typename Hash, typename Compare>
-    auto HashStructIterator<Item, Hash, Compare>::operator++(int)
-        -> HashStructIterator<Item, Hash, Compare>
+    template <typename Item, typename Elem>
+    auto HashStructIterator<Item, Elem>::operator++(int)
+        -> HashStructIterator<Item, Elem>
     {
       const auto ret = *this;
 
@@ -99,24 +97,24 @@ namespace loxx
     }
 
 
-    template <typename Item, typename Hash, typename Compare>
-    bool HashStructIterator<Item, Hash, Compare>::operator==(
-        const HashStructIterator<Item, Hash, Compare>& other) const
+    template <typename Item, typename Elem>
+    bool HashStructIterator<Item, Elem>::operator==(
+        const HashStructIterator<Item, Elem>& other) const
     {
       return it_ == other.it_;
     }
 
 
-    template <typename Item, typename Hash, typename Compare>
-    bool HashStructIterator<Item, Hash, Compare>::operator!=(
-        const HashStructIterator<Item, Hash, Compare>& other) const
+    template <typename Item, typename Elem>
+    bool HashStructIterator<Item, Elem>::operator!=(
+        const HashStructIterator<Item, Elem>& other) const
     {
       return not (*this == other);
     }
 
 
-    template <typename Item, typename Hash, typename Compare>
-    auto HashStructIterator<Item, Hash, Compare>::operator*() -> reference
+    template <typename Item, typename Elem>
+    auto HashStructIterator<Item, Elem>::operator*() -> reference
     {
       if (it_ == finish_) {
         return back_;
@@ -126,8 +124,8 @@ namespace loxx
     }
 
 
-    template <typename Item, typename Hash, typename Compare>
-    auto HashStructIterator<Item, Hash, Compare>::operator->() -> pointer
+    template <typename Item, typename Elem>
+    auto HashStructIterator<Item, Elem>::operator->() -> pointer
     {
       if (it_ == finish_) {
         return &back_;
@@ -0,0 +1,379 @@
+/*
+ * This file is part of loxx.
+ *
+ * loxx is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * loxx is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Created by Matt Spraggs on 18/10/26.
+ */
+
+#ifndef LOXX_SWISSIMPL_HPP
+#define LOXX_SWISSIMPL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "HashImpl.hpp"
+
+#if defined(__GNUC__) and (defined(__x86_64__) or defined(__i386__)) and \
+    defined(__SSE2__)
+#define LOXX_SWISS_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace loxx
+{
+  namespace detail
+  {
+    // Each slot has a control byte saying whether it's empty, was deleted or
+    // is full. A full slot's byte holds seven bits of its key's hash, so a
+    // group of sixteen slots can be checked against a key with a couple of
+    // instructions before any of the keys themselves are looked at.
+    using Ctrl = std::int8_t;
+
+    constexpr Ctrl ctrl_empty = -128;
+    constexpr Ctrl ctrl_deleted = -2;
+    constexpr std::size_t group_width = 16;
+
+
+    inline unsigned int lowest_bit(const std::uint32_t mask)
+    {
+#ifdef __GNUC__
+      return static_cast<unsigned int>(__builtin_ctz(mask));
+#else
+      unsigned int bit = 0;
+      while ((mask & (1u << bit)) == 0) {
+        ++bit;
+      }
+      return bit;
+#endif
+    }
+
+
+    // The control bytes of sixteen consecutive slots. Each match function
+    // returns a mask with a bit set for each slot that matches.
+    class Group
+    {
+    public:
+#ifdef LOXX_SWISS_SSE2
+      explicit Group(const Ctrl* ctrl)
+          : ctrl_(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl)))
+      {}
+
+      std::uint32_t match(const Ctrl h2) const
+      {
+        return static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl_)));
+      }
+
+      // Empty and deleted are the only control bytes with the top bit set.
+      std::uint32_t match_empty_or_deleted() const
+      {
+        return static_cast<std::uint32_t>(_mm_movemask_epi8(ctrl_));
+      }
+
+    private:
+      __m128i ctrl_;
+#else
+      explicit Group(const Ctrl* ctrl) : ctrl_(ctrl) {}
+
+      std::uint32_t match(const Ctrl h2) const
+      {
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < group_width; ++i) {
+          mask |= static_cast<std::uint32_t>(ctrl_[i] == h2) << i;
+        }
+        return mask;
+      }
+
+      std::uint32_t match_empty_or_deleted() const
+      {
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < group_width; ++i) {
+          mask |= static_cast<std::uint32_t>(ctrl_[i] < 0) << i;
+        }
+        return mask;
+      }
+
+    private:
+      const Ctrl* ctrl_;
+#endif
+
+    public:
+      std::uint32_t match_empty() const { return match(ctrl_empty); }
+    };
+
+
+    // Slots are probed a group at a time, moving on by one more group each
+    // time, which visits every group when there's a power of two of them.
+    // Tables smaller than a group still have a full group of control bytes,
+    // with the ones past the end of the table left empty.
+    template <typename Key, typename Elem, typename HashStruct>
+    class SwissImpl
+    {
+    protected:
+      static std::size_t find_pos(
+          const HashStruct& obj, const Key& key, const std::size_t hash);
+
+      // Returns the first slot with the given hash whose element satisfies
+      // the predicate, or the size of the table if there isn't one.
+      template <typename Fn>
+      static std::size_t find_pos_if(
+          const HashStruct& obj, const std::size_t hash, Fn matches);
+
+      static const Elem& find_elem(
+          const HashStruct& obj, const Key& key, const std::size_t hash);
+
+      // Puts an element whose key isn't in the table into the first free
+      // slot along its probe sequence, returning that slot.
+      static std::size_t insert_new(
+          HashStruct& obj, const std::size_t hash, Elem elem);
+
+      static void remove(HashStruct& obj, const Key& key);
+
+      // Makes room for another element. Deleted slots count towards the load,
+      // so a table that's mostly deleted slots is cleaned out rather than
+      // grown.
+      static void reserve_slot(HashStruct& obj);
+
+      static std::size_t find_probe_length(
+          const HashStruct& obj, const Key& key);
+
+      static ProbeStats compute_probe_stats(const HashStruct& obj);
+
+      static std::vector<Ctrl> make_ctrl(const std::size_t capacity);
+
+    private:
+      static Ctrl h2(const std::size_t hash)
+      { return static_cast<Ctrl>(hash & 0x7f); }
+
+      static std::size_t first_group(
+          const HashStruct& obj, const std::size_t hash);
+
+      static std::size_t group_mask(const HashStruct& obj)
+      { return std::max(obj.data_.size() / group_width, std::size_t(1)) - 1; }
+
+      static void rehash(HashStruct& obj, const std::size_t new_capacity);
+    };
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    std::size_t SwissImpl<Key, Elem, HashStruct>::find_pos(
+        const HashStruct& obj, const Key& key, const std::size_t hash)
+    {
+      return find_pos_if(
+          obj, hash,
+          [&] (const Elem& elem) {
+            return obj.compare_(obj.key_extractor_(elem), key);
+          });
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    template <typename Fn>
+    std::size_t SwissImpl<Key, Elem, HashStruct>::find_pos_if(
+        const HashStruct& obj, const std::size_t hash, Fn matches)
+    {
+      const auto mask = group_mask(obj);
+      auto group = first_group(obj, hash);
+
+      for (std::size_t step = 1; step <= mask + 1; ++step) {
+        const auto base = group * group_width;
+        const Group ctrl(&obj.ctrl_[base]);
+
+        for (auto candidates = ctrl.match(h2(hash)); candidates != 0;
+             candidates &= candidates - 1) {
+          const auto pos = base + lowest_bit(candidates);
+          if (matches(obj.data_[pos])) {
+            return pos;
+          }
+        }
+
+        if (ctrl.match_empty() != 0) {
+          break;
+        }
+        group = (group + step) & mask;
+      }
+
+      return obj.data_.size();
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    const Elem& SwissImpl<Key, Elem, HashStruct>::find_elem(
+        const HashStruct& obj, const Key& key, const std::size_t hash)
+    {
+      const auto pos = find_pos(obj, key, hash);
+      return pos == obj.data_.size() ? HashStruct::missing_ : obj.data_[pos];
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    std::size_t SwissImpl<Key, Elem, HashStruct>::insert_new(
+        HashStruct& obj, const std::size_t hash, Elem elem)
+    {
+      const auto mask = group_mask(obj);
+      // Control bytes past the end of a small table look empty, but mustn't
+      // be used.
+      const auto valid = obj.data_.size() >= group_width ?
+                         ~std::uint32_t(0) :
+                         (std::uint32_t(1) << obj.data_.size()) - 1;
+      auto group = first_group(obj, hash);
+
+      for (std::size_t step = 1; ; ++step) {
+        const auto base = group * group_width;
+        const auto free = Group(&obj.ctrl_[base]).match_empty_or_deleted();
+
+        if ((free & valid) != 0) {
+          const auto pos = base + lowest_bit(free & valid);
+
+          if (obj.ctrl_[pos] == ctrl_deleted) {
+            --obj.num_deleted_slots_;
+          }
+
+          obj.ctrl_[pos] = h2(hash);
+          obj.data_[pos] = std::move(elem);
+          ++obj.num_used_slots_;
+          return pos;
+        }
+
+        group = (group + step) & mask;
+      }
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    void SwissImpl<Key, Elem, HashStruct>::remove(
+        HashStruct& obj, const Key& key)
+    {
+      const auto pos = find_pos(obj, key, obj.hash_func_(key));
+
+      if (pos == obj.data_.size()) {
+        return;
+      }
+
+      // Lookups only stop at empty slots, so this one has to be marked as
+      // deleted in case a later key probed past it.
+      obj.data_[pos].reset();
+      obj.ctrl_[pos] = ctrl_deleted;
+      --obj.num_used_slots_;
+      ++obj.num_deleted_slots_;
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    void SwissImpl<Key, Elem, HashStruct>::reserve_slot(HashStruct& obj)
+    {
+      if (obj.num_used_slots_ + obj.num_deleted_slots_ <
+          obj.max_used_slots_) {
+        return;
+      }
+
+      const auto capacity = obj.data_.size();
+      rehash(obj, obj.num_used_slots_ >= obj.max_used_slots_ / 2 ?
+                  capacity * growth_factor : capacity);
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    std::size_t SwissImpl<Key, Elem, HashStruct>::find_probe_length(
+        const HashStruct& obj, const Key& key)
+    {
+      const auto hash = obj.hash_func_(key);
+      const auto pos = find_pos(obj, key, hash);
+
+      // A missing key isn't in any group, so the search below would never
+      // end.
+      if (pos == obj.data_.size()) {
+        return 0;
+      }
+
+      const auto mask = group_mask(obj);
+
+      // Counts the groups visited before the one holding the key.
+      auto group = first_group(obj, hash);
+      std::size_t length = 0;
+
+      while (group != pos / group_width) {
+        ++length;
+        group = (group + length) & mask;
+      }
+
+      return length;
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    ProbeStats SwissImpl<Key, Elem, HashStruct>::compute_probe_stats(
+        const HashStruct& obj)
+    {
+      ProbeStats stats{0, 0, 0};
+
+      for (const auto& elem : obj.data_) {
+        if (not elem) {
+          continue;
+        }
+
+        const auto length =
+            find_probe_length(obj, obj.key_extractor_(elem));
+        ++stats.num_keys;
+        stats.total_probe_length += length;
+        stats.max_probe_length = std::max(stats.max_probe_length, length);
+      }
+
+      return stats;
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    std::vector<Ctrl> SwissImpl<Key, Elem, HashStruct>::make_ctrl(
+        const std::size_t capacity)
+    {
+      return std::vector<Ctrl>(std::max(capacity, group_width), ctrl_empty);
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    std::size_t SwissImpl<Key, Elem, HashStruct>::first_group(
+        const HashStruct& obj, const std::size_t hash)
+    {
+      return (hash >> 7) & group_mask(obj);
+    }
+
+
+    template <typename Key, typename Elem, typename HashStruct>
+    void SwissImpl<Key, Elem, HashStruct>::rehash(
+        HashStruct& obj, const std::size_t new_capacity)
+    {
+      obj.max_used_slots_ =
+          static_cast<std::size_t>(new_capacity * load_factor);
+      obj.num_used_slots_ = 0;
+      obj.num_deleted_slots_ = 0;
+
+      std::vector<Elem> old_data(new_capacity);
+      std::swap(obj.data_, old_data);
+      obj.ctrl_ = make_ctrl(new_capacity);
+
+      for (auto& elem : old_data) {
+        if (elem) {
+          const auto hash = obj.hash_func_(obj.key_extractor_(elem));
+          insert_new(obj, hash, std::move(elem));
+        }
+      }
+    }
+  }
+}
+
+#endif //LOXX_SWISSIMPL_HPP
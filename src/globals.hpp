@@ -32,10 +32,11 @@ namespace loxx
   using InstrArgUShort = std::uint16_t;
   using InstrArgSShort = std::make_signed_t<InstrArgUShort>;
 
-  constexpr std::size_t max_scope_constants = 256;
-  constexpr std::size_t max_call_frames     = 64;
-  constexpr std::size_t max_stack_size      =
-      max_call_frames * max_scope_constants;
+  constexpr std::size_t max_scope_constants = 1 << 16;
+  constexpr std::size_t max_scope_locals = 1 << 16;
+  constexpr std::size_t max_scope_upvalues = 1 << 16;
+  constexpr std::size_t default_max_call_frames = 16384;
+  constexpr std::size_t default_max_stack_size  = 1 << 22;
 }
 
 #endif // LOXX_GLOBALS_HPP
@@ -25,6 +25,7 @@
 #include "Instruction.hpp"
 #include "logging.hpp"
 #include "Object.hpp"
+#include "Peephole.hpp"
 #include "utils.hpp"
 #include "VirtualMachine.hpp"
 
@@ -35,6 +36,21 @@ namespace loxx
   bool had_runtime_error = false;
 
 
+  namespace
+  {
+    // Each thread has its own buffer, so that compile errors from functions
+    // compiled concurrently can be collected and reported in source order.
+    thread_local ErrorBuffer* error_buffer = nullptr;
+
+
+    void print_error(const std::string& message)
+    {
+      std::cout << message << std::endl;
+      had_error = true;
+    }
+  }
+
+
   void error(const unsigned int line, const std::string& message)
   {
     report(line, "", message);
@@ -44,10 +60,24 @@ namespace loxx
               const std::string& message)
   {
     const auto location_padding = where.length() > 0 ? " " : "";
-    std::cout << "[line " << line << "] Error"
-              << location_padding << where << ": "
-              << message << std::endl;
-    had_error = true;
+    std::stringstream ss;
+    ss << "[line " << line << "] Error"
+       << location_padding << where << ": " << message;
+
+    report_held_errors({ss.str()});
+  }
+
+
+  void report_held_errors(const std::vector<std::string>& messages)
+  {
+    for (const auto& message : messages) {
+      if (error_buffer != nullptr) {
+        error_buffer->hold(message);
+      }
+      else {
+        print_error(message);
+      }
+    }
   }
 
 
@@ -62,6 +92,76 @@ namespace loxx
   }
 
 
+  void syntax_error(const Token& token, const std::string& message)
+  {
+    // Syntax errors are always printed straight away, and make any held
+    // compile errors redundant.
+    const auto buffer = error_buffer;
+    error_buffer = nullptr;
+
+    error(token, message);
+
+    error_buffer = buffer;
+    if (error_buffer != nullptr) {
+      error_buffer->discard();
+    }
+  }
+
+
+  ErrorBuffer::ErrorBuffer()
+      : discarding_(false), enclosing_(error_buffer)
+  {
+    error_buffer = this;
+  }
+
+
+  ErrorBuffer::~ErrorBuffer()
+  {
+    error_buffer = enclosing_;
+  }
+
+
+  void ErrorBuffer::hold(std::string message)
+  {
+    if (not discarding_) {
+      messages_.push_back(std::move(message));
+    }
+  }
+
+
+  void ErrorBuffer::discard()
+  {
+    messages_.clear();
+    discarding_ = true;
+
+    if (enclosing_ != nullptr) {
+      enclosing_->discard();
+    }
+  }
+
+
+  void ErrorBuffer::flush()
+  {
+    for (const auto& message : messages_) {
+      if (enclosing_ != nullptr) {
+        enclosing_->hold(message);
+      }
+      else {
+        print_error(message);
+      }
+    }
+    messages_.clear();
+  }
+
+
+  std::vector<std::string> ErrorBuffer::release()
+  {
+    std::vector<std::string> ret;
+    std::swap(ret, messages_);
+    return ret;
+  }
+
+
   void runtime_error(const RuntimeError& error)
   {
     std::cout << error.what() << "\n[line " << error.line() << ']'
@@ -74,21 +174,31 @@ namespace loxx
   void print_bytecode(const std::string& name, const CodeObject& output)
   {
     std::cout << "=== " << name << " ===\n";
-    auto ip = output.bytecode.begin();
-    while (ip != output.bytecode.end()) {
+    auto ip = output.bytecode.data();
+    const auto end = ip + output.bytecode.size();
+    while (ip != end) {
       ip = print_instruction(output, ip);
     }
   }
 
 
+  void print_peephole_stats(const PeepholeStats& stats)
+  {
+    std::cout << "--- peephole: " << stats.instructions_before << " -> "
+              << stats.instructions_after << " instructions\n";
+  }
+
+
   CodeObject::InsPtr print_instruction(const CodeObject& output,
                                        const CodeObject::InsPtr ip)
   {
     const auto& bytecode = output.bytecode;
     const auto& constants = output.constants;
-    const auto instruction = static_cast<Instruction>(*ip);
+    // A wide prefix is printed along with the instruction it widens.
+    const auto wide = static_cast<Instruction>(*ip) == Instruction::Wide;
+    const auto instruction = static_cast<Instruction>(*(wide ? ip + 1 : ip));
 
-    const auto pos = std::distance(bytecode.begin(), ip);
+    const auto pos = ip - bytecode.data();
     static unsigned int last_line_num = 0;
     const unsigned int current_line_num = get_current_line(output, pos);
 
@@ -104,21 +214,43 @@ namespace loxx
 
     std::cout << std::setw(4) << std::setfill('0') << std::right << pos;
     std::cout << line_num_ss.str() << ' ';
-    std::cout << std::setw(20) << std::setfill(' ') << std::left << instruction;
-
-    auto ret = ip + 1;
+    std::stringstream instruction_ss;
+    instruction_ss << (wide ? "WIDE " : "") << instruction;
+    std::cout << std::setw(20) << std::setfill(' ') << std::left
+              << instruction_ss.str();
+
+    auto ret = wide ? ip + 2 : ip + 1;
+
+    const auto read_index = [&] () {
+      unsigned int index;
+      if (wide) {
+        index = read_integer_at_pos<InstrArgUShort>(ret);
+        ret += sizeof(InstrArgUShort);
+      }
+      else {
+        index = read_integer_at_pos<InstrArgUByte>(ret);
+        ret += sizeof(InstrArgUByte);
+      }
+      return index;
+    };
 
     switch (instruction) {
 
     case Instruction::Add:
+    case Instruction::AddNumbers:
     case Instruction::CloseUpvalue:
     case Instruction::Divide:
+    case Instruction::DivideNumbers:
     case Instruction::Equal:
     case Instruction::False:
     case Instruction::Greater:
+    case Instruction::GreaterNumbers:
     case Instruction::Less:
+    case Instruction::LessNumbers:
     case Instruction::Multiply:
+    case Instruction::MultiplyNumbers:
     case Instruction::Negate:
+    case Instruction::NegateNumber:
     case Instruction::Nil:
     case Instruction::Not:
     case Instruction::Pop:
@@ -126,35 +258,34 @@ namespace loxx
     case Instruction::Push:
     case Instruction::Return:
     case Instruction::Subtract:
+    case Instruction::SubtractNumbers:
     case Instruction::True:
+    case Instruction::Wide:
       break;
 
     case Instruction::ConditionalJump:
-    case Instruction::Jump: {
+    case Instruction::Jump:
+    case Instruction::JumpIfTrue: {
       const auto param = read_integer_at_pos<InstrArgUShort>(ret);
       std::cout << pos << " -> " << pos + param + sizeof(InstrArgUShort) + 1;
-      ret += sizeof(InstrArgSByte);
+      ret += sizeof(InstrArgUShort);
       break;
     }
 
     case Instruction::CreateClosure: {
-      const auto& func_value =
-          constants[read_integer_at_pos<InstrArgUByte>(ret)];
+      const auto& func_value = constants[read_index()];
       const auto& func_obj = get<ObjectPtr>(func_value);
       auto func = static_cast<FuncObject*>(func_obj);
 
-      ret += sizeof(InstrArgUByte);
-
       std::cout << func->lexeme() << ' ';
 
       for (unsigned int i = 0; i < func->num_upvalues(); ++i) {
         const auto is_local = read_integer_at_pos<InstrArgUByte>(ret) != 0;
         ret += sizeof(InstrArgUByte);
-        const auto index = read_integer_at_pos<InstrArgUByte>(ret);
-        ret += sizeof(InstrArgUByte);
+        const auto index = read_index();
 
         std::cout << '(' << (is_local ? "local" : "upvalue") << ", "
-                  << static_cast<unsigned int>(index) << ')';
+                  << index << ')';
 
         if (i < func->num_upvalues() - 1) {
           std::cout << ", ";
@@ -164,7 +295,9 @@ namespace loxx
       break;
     }
 
-    case Instruction::Call: {
+    case Instruction::AssertNumbers:
+    case Instruction::Call:
+    case Instruction::TailCall: {
       const auto num_args = read_integer_at_pos<InstrArgUByte>(ret);
       ret += sizeof(InstrArgUByte);
       std::cout << num_args;
@@ -181,10 +314,8 @@ namespace loxx
     case Instruction::SetGlobal:
     case Instruction::SetProperty:
     case Instruction::LoadConstant: {
-      const auto param = read_integer_at_pos<InstrArgUByte>(ret);
-      std::cout << static_cast<unsigned int>(param)
-                << " '" << constants[param] << "'";
-      ret += sizeof(InstrArgUByte);
+      const auto param = read_index();
+      std::cout << param << " '" << constants[param] << "'";
       break;
     }
 
@@ -192,15 +323,12 @@ namespace loxx
     case Instruction::GetUpvalue:
     case Instruction::SetLocal:
     case Instruction::SetUpvalue: {
-      const auto param = read_integer_at_pos<InstrArgUByte>(ret);
-      std::cout << static_cast<unsigned int>(param);
-      ret += sizeof(InstrArgUByte);
+      std::cout << read_index();
       break;
     }
 
     case Instruction::Invoke: {
-      const auto param = read_integer_at_pos<InstrArgUByte>(ret);
-      ret += sizeof(InstrArgUByte);
+      const auto param = read_index();
       const auto num_args = read_integer_at_pos<InstrArgUByte>(ret);
       ret += sizeof(InstrArgUByte);
       std::cout << num_args << ", " << param << " '" << constants[param] << "'";
@@ -209,8 +337,8 @@ namespace loxx
 
     case Instruction::Loop: {
       const auto param = read_integer_at_pos<InstrArgUShort>(ret);
-      ret += sizeof(InstrArgUByte);
-      std::cout << pos << " -> " << pos - param + sizeof(InstrArgSByte) + 1;
+      ret += sizeof(InstrArgUShort);
+      std::cout << pos << " -> " << pos - param + sizeof(InstrArgUShort) + 1;
       break;
     }
     }
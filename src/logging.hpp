@@ -36,6 +36,7 @@ namespace loxx
 
 
   struct CodeObject;
+  struct PeepholeStats;
   class VirtualMachine;
 
 
@@ -49,10 +50,48 @@ namespace loxx
   void error(const Token& token, const std::string& message);
 
 
+  void report_held_errors(const std::vector<std::string>& messages);
+
+
+  void syntax_error(const Token& token, const std::string& message);
+
+
+  // Holds back errors reported during compilation instead of printing them
+  // immediately. The single-pass compiler parses and generates code at the
+  // same time, so it uses this to make its error output match the AST
+  // pipeline, where compile errors are only ever reported for source that
+  // parsed cleanly: a syntax error discards any held errors along with any
+  // further ones that are reported while the buffer is alive. Errors that
+  // haven't been flushed when the buffer is destroyed are dropped.
+  //
+  // Buffers are per-thread. Held errors can also be released and handed to
+  // report_held_errors on another thread.
+  class ErrorBuffer
+  {
+  public:
+    ErrorBuffer();
+    ~ErrorBuffer();
+
+    ErrorBuffer(const ErrorBuffer&) = delete;
+    ErrorBuffer& operator=(const ErrorBuffer&) = delete;
+
+    void hold(std::string message);
+    void discard();
+    void flush();
+    std::vector<std::string> release();
+
+  private:
+    bool discarding_;
+    ErrorBuffer* enclosing_;
+    std::vector<std::string> messages_;
+  };
+
+
   void runtime_error(const RuntimeError& error);
 
 
   void print_bytecode(const std::string& name, const CodeObject& output);
+  void print_peephole_stats(const PeepholeStats& stats);
 
 
   CodeObject::InsPtr print_instruction(const CodeObject& output,
@@ -6,9 +6,14 @@
 
 #include "AstPrinter.hpp"
 #include "logging.hpp"
+#include "ObjectTracker.hpp"
+#include "Optimiser.hpp"
+#include "OutputBuffer.hpp"
 #include "Parser.hpp"
 #include "Scanner.hpp"
+#include "SimdScan.hpp"
 #include "Compiler.hpp"
+#include "SinglePassCompiler.hpp"
 #include "VirtualMachine.hpp"
 
 
@@ -20,13 +25,36 @@ namespace loxx
     bool print_ast;
     bool print_bytecode;
     bool trace_exec;
+    bool print_table_stats;
+  };
+
+
+  enum class Phase
+  {
+    Scan,
+    Parse,
+    Compile,
+    Execute
+  };
+
+
+  struct RunConfig
+  {
+    DebugConfig debug;
+    Phase last_phase;
+    bool single_pass;
+    unsigned int num_jobs;
+    unsigned int opt_level;
+    bool verify_types;
+    std::size_t max_call_depth;
+    std::size_t max_stack_size;
   };
 
 
   Optional<DebugConfig> parse_debug_config(
       args::ValueFlagList<std::string>& opts)
   {
-    DebugConfig ret{false, false, false, false};
+    DebugConfig ret{false, false, false, false, false};
 
     if (opts) {
       for (const auto& opt : args::get(opts)) {
@@ -42,6 +70,9 @@ namespace loxx
         else if (opt == "trace") {
           ret.trace_exec = true;
         }
+        else if (opt == "tables") {
+          ret.print_table_stats = true;
+        }
         else {
           return {};
         }
@@ -52,63 +83,156 @@ namespace loxx
   }
 
 
-  void run(const std::string& src, const DebugConfig& debug_config,
-           const bool in_repl)
+  Optional<Phase> parse_phase(args::ValueFlag<std::string>& opt)
   {
-    Scanner scanner(src);
-    auto tokens = scanner.scan_tokens();
+    if (not opt) {
+      return Phase::Execute;
+    }
 
-    if (had_error) {
-      return;
+    const auto& phase = args::get(opt);
+
+    if (phase == "scan") {
+      return Phase::Scan;
+    }
+    else if (phase == "parse") {
+      return Phase::Parse;
+    }
+    else if (phase == "compile") {
+      return Phase::Compile;
     }
 
+    return {};
+  }
+
+
+  bool needs_ast(const RunConfig& config)
+  {
 #ifndef NDEBUG
-    if (debug_config.print_tokens) {
-      for (const auto& token : tokens) {
-        std::cout << token << '\n';
-      }
+    if (config.debug.print_ast) {
+      return true;
     }
 #endif
+    return not config.single_pass;
+  }
 
-    Parser parser(std::move(tokens), in_repl);
-    const auto statements = parser.parse();
 
-    if (had_error) {
-      return;
+  std::unique_ptr<CodeObject> compile_ast(std::vector<Token> tokens,
+                                          const RunConfig& config,
+                                          const bool in_repl)
+  {
+    Arena arena;
+    Parser parser(std::move(tokens), arena, in_repl);
+    auto statements = parser.parse();
+
+    if (had_error or config.last_phase == Phase::Parse) {
+      return nullptr;
+    }
+
+    if (config.opt_level > 0) {
+      Optimiser optimiser(arena, config.opt_level);
+      statements = optimiser.optimise(statements);
     }
 
 #ifndef NDEBUG
-    if (debug_config.print_ast) {
+    if (config.debug.print_ast) {
       AstPrinter printer;
       std::cout << printer.print(statements) << std::endl;
     }
 #endif
 
-    Compiler compiler(debug_config.print_bytecode);
+    // Functions declared on one line of the REPL can be redefined on the
+    // next, so calls to them can't be inlined.
+    const CompilerOptions options{
+        config.debug.print_bytecode, config.opt_level > 0,
+        config.opt_level > 0, config.verify_types,
+        config.opt_level > 1 and not in_repl, config.opt_level > 0,
+        config.num_jobs};
+    Compiler compiler(options);
     compiler.compile(statements);
+    arena.release();
+
+    return compiler.release_output();
+  }
+
+
+  std::unique_ptr<CodeObject> compile_single_pass(std::vector<Token> tokens,
+                                                  const RunConfig& config)
+  {
+    // There's no separate parse phase in this mode, so stopping after parsing
+    // is the same as stopping after compilation.
+    // Type inference and inlining need the AST, so they aren't available in
+    // this mode.
+    const CompilerOptions options{
+        config.debug.print_bytecode, config.opt_level > 0, false, false, false,
+        config.opt_level > 0, 1};
+    SinglePassCompiler compiler(std::move(tokens), options);
+    compiler.compile();
+
+    return compiler.release_output();
+  }
+
+
+  void print_probe_stats(const std::string& name, const ProbeStats& stats)
+  {
+    std::cout << "== " << name << " ==\n"
+              << "keys: " << stats.num_keys
+              << ", mean probe length: " << stats.mean_probe_length()
+              << ", max probe length: " << stats.max_probe_length << '\n';
+  }
+
+
+  void run(const std::string& src, const RunConfig& config,
+           const bool in_repl)
+  {
+    const auto& debug_config = config.debug;
+
+    Scanner scanner(src);
+    auto tokens = scanner.scan_tokens();
 
     if (had_error) {
       return;
     }
 
 #ifndef NDEBUG
-    if (debug_config.print_bytecode) {
-      print_bytecode("top level", compiler.output());
+    if (debug_config.print_tokens) {
+      for (const auto& token : tokens) {
+        std::cout << token << '\n';
+      }
     }
 #endif
 
-    static VirtualMachine vm(debug_config.trace_exec);
+    if (config.last_phase == Phase::Scan) {
+      return;
+    }
+
+    auto code_object = needs_ast(config) ?
+                       compile_ast(std::move(tokens), config, in_repl) :
+                       compile_single_pass(std::move(tokens), config);
+
+    if (had_error or config.last_phase != Phase::Execute) {
+      return;
+    }
+
+    static VirtualMachine vm(debug_config.trace_exec, config.max_call_depth,
+                             config.max_stack_size);
 
     try {
-      vm.execute(compiler.release_output());
+      vm.execute(std::move(code_object));
     }
     catch (const RuntimeError& e) {
       runtime_error(e);
     }
+
+    if (debug_config.print_table_stats) {
+      const auto& tracker = ObjectTracker::instance();
+      print_probe_stats("globals", vm.global_probe_stats());
+      print_probe_stats("fields", tracker.field_probe_stats());
+      print_probe_stats("interned strings", tracker.intern_probe_stats());
+    }
   }
 
 
-  void run_prompt(const DebugConfig& debug_config)
+  void run_prompt(const RunConfig& config)
   {
     while (true) {
       std::cout << "> ";
@@ -120,13 +244,13 @@ namespace loxx
         return;
       }
 
-      run(src, debug_config, true);
+      run(src, config, true);
       had_error = false;
     }
   }
 
 
-  void run_file(const std::string& path, const DebugConfig& debug_config)
+  void run_file(const std::string& path, const RunConfig& config)
   {
     std::ifstream file(path, std::ios::binary | std::ios::ate);
     if (not file.good()) {
@@ -142,7 +266,7 @@ namespace loxx
       throw std::ios_base::failure("Unable to read source file!");
     }
 
-    run(src, debug_config, false);
+    run(src, config, false);
 
     if (had_error) {
       std::exit(65);
@@ -162,9 +286,75 @@ int main(int argc, const char* argv[])
   args::ValueFlagList<std::string> debug(
       parser,
       "debug",
-      "Print debugging output (one of 'tokens', 'ast', 'bytecode' or 'trace'.",
+      "Print debugging output (one of 'tokens', 'ast', 'bytecode', 'trace' or "
+      "'tables').",
       {'d', "debug"}
   );
+  args::ValueFlag<std::string> stop_after(
+      parser,
+      "phase",
+      "Stop after the given phase (one of 'scan', 'parse' or 'compile').",
+      {"stop-after"}
+  );
+  args::Flag single_pass(
+      parser,
+      "single-pass",
+      "Generate bytecode directly from the token stream, without building an "
+      "AST. Ignored if the AST is needed for debugging output.",
+      {"single-pass"}
+  );
+  args::ValueFlag<unsigned int> jobs(
+      parser,
+      "jobs",
+      "Number of threads to compile top-level functions and methods with. "
+      "Ignored when printing bytecode and in single-pass mode.",
+      {'j', "jobs"}, 1
+  );
+  args::ValueFlag<unsigned int> opt_level(
+      parser,
+      "level",
+      "Optimisation level (0, 1 or 2). Level 1 folds constant expressions and "
+      "runs a peephole optimiser over the bytecode. It also infers which "
+      "local variables hold numbers so arithmetic on them can skip type "
+      "checks, and reuses the current call frame for calls whose result is "
+      "returned straight away. Level 2 also removes branches that can never "
+      "run and inlines calls to small functions. Only the peephole optimiser "
+      "and tail calls are used in single-pass mode.",
+      {'O'}, 1
+  );
+  args::Flag verify_types(
+      parser,
+      "verify-types",
+      "Check at runtime that operands inferred to be numbers are numbers.",
+      {"verify-types"}
+  );
+  args::Flag line_buffered(
+      parser,
+      "line-buffered",
+      "Write output at the end of each line instead of in large blocks. This "
+      "is always done at the prompt and when output goes to a terminal.",
+      {"line-buffered"}
+  );
+  args::Flag print_scanner(
+      parser,
+      "print-scanner",
+      "Print which scanner ('avx2', 'sse2' or 'scalar') was picked for this "
+      "machine and exit.",
+      {"print-scanner"}
+  );
+  args::ValueFlag<std::size_t> max_call_depth(
+      parser,
+      "depth",
+      "Maximum number of nested function calls.",
+      {"max-call-depth"}, loxx::default_max_call_frames
+  );
+  args::ValueFlag<std::size_t> max_stack_size(
+      parser,
+      "size",
+      "Maximum number of values on the stack. The stack starts small and "
+      "grows as needed up to this size.",
+      {"max-stack-size"}, loxx::default_max_stack_size
+  );
   args::Positional<std::string> source_file(
       parser, "source file", "File containing source code to execute.");
 
@@ -186,6 +376,11 @@ int main(int argc, const char* argv[])
     return EXIT_FAILURE;
   }
 
+  if (print_scanner) {
+    std::cout << loxx::scan::implementation_name() << '\n';
+    return EXIT_SUCCESS;
+  }
+
   const auto debug_config = loxx::parse_debug_config(debug);
 
   if (not debug_config) {
@@ -194,12 +389,53 @@ int main(int argc, const char* argv[])
     return EXIT_FAILURE;
   }
 
+  const auto last_phase = loxx::parse_phase(stop_after);
+
+  if (not last_phase) {
+    std::cerr << "Invalid option to --stop-after flag.\n";
+    std::cerr << parser;
+    return EXIT_FAILURE;
+  }
+
+  if (args::get(jobs) == 0) {
+    std::cerr << "Invalid option to --jobs flag.\n";
+    std::cerr << parser;
+    return EXIT_FAILURE;
+  }
+
+  if (args::get(opt_level) > 2) {
+    std::cerr << "Invalid option to -O flag.\n";
+    std::cerr << parser;
+    return EXIT_FAILURE;
+  }
+
+  if (args::get(max_call_depth) == 0) {
+    std::cerr << "Invalid option to --max-call-depth flag.\n";
+    std::cerr << parser;
+    return EXIT_FAILURE;
+  }
+
+  if (args::get(max_stack_size) == 0) {
+    std::cerr << "Invalid option to --max-stack-size flag.\n";
+    std::cerr << parser;
+    return EXIT_FAILURE;
+  }
+
+  const loxx::RunConfig config{
+      *debug_config, *last_phase, single_pass, args::get(jobs),
+      args::get(opt_level), verify_types, args::get(max_call_depth),
+      args::get(max_stack_size)};
+
+  loxx::buffer_stdout(
+      line_buffered or not source_file or loxx::stdout_is_terminal() ?
+      loxx::BufferMode::Line : loxx::BufferMode::Full);
+
   try {
     if (source_file) {
-      loxx::run_file(args::get(source_file), *debug_config);
+      loxx::run_file(args::get(source_file), config);
     }
     else {
-      loxx::run_prompt(*debug_config);
+      loxx::run_prompt(config);
     }
   }
   catch (const std::ios_base::failure& e) {
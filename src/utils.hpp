@@ -21,7 +21,7 @@
 #define LOXX_UTILS_HPP
 
 #include <cstdint>
-#include <vector>
+#include <cstring>
 
 #include "CodeObject.hpp"
 
@@ -31,7 +31,7 @@ namespace loxx
   T read_integer_at_pos(const CodeObject::InsPtr pos)
   {
     T integer;
-    std::copy(pos, pos + sizeof(T), reinterpret_cast<std::uint8_t*>(&integer));
+    std::memcpy(&integer, pos, sizeof(T));
     return integer;
   }
 }
@@ -20,9 +20,7 @@
 #ifndef LOXX_{{ base_name|upper }}_HPP
 #define LOXX_{{ base_name|upper }}_HPP
 
-#include <memory>
-#include <vector>
-
+#include "Arena.hpp"
 #include "globals.hpp"
 #include "Token.hpp"
 {% for inc in includes %}#include "{{ inc }}"
@@ -33,10 +31,10 @@ namespace loxx
 {% for spec in class_specs %}
   struct {{ spec.name }};{% endfor %}
 
+  // Nodes are allocated in an Arena and are never destroyed individually, so
+  // there's no virtual destructor here.
   struct {{ base_name }}
   {
-    virtual ~{{ base_name }}() = default;
-
     class Visitor
     {
     public:{% for spec in class_specs %}
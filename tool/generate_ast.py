@@ -31,14 +31,14 @@ def define_ast(output_dir, base_name, types, includes=[]):
 
     for name, members in type_items:
         arglist = ", ".join(
-            "std::unique_ptr<{}> {}_arg".format(t, n)
+            "{}* {}_arg".format(t, n)
             if i else "{} {}_arg".format(t, n)
             for t, n, i in members)
         initialisers = ", ".join(
             "{}(std::move({}_arg))".format(n, n)
             for t, n, i in members)
         member_vars = "\n    ".join(
-            "std::unique_ptr<{}> {};".format(t, n)
+            "{}* {};".format(t, n)
             if i else "{} {};".format(t, n)
             for t, n, i in members)
 
@@ -67,11 +67,11 @@ if __name__ == "__main__":
          "Binary": [("Expr", "left", True), ("Token", "op", False),
                     ("Expr", "right", True)],
          "Call": [("Expr", "callee", True), ("Token", "paren", False),
-                  ("std::vector<std::unique_ptr<Expr>>", "arguments", False)],
+                  ("ArenaList<Expr*>", "arguments", False)],
          "Get": [("Expr", "object", True), ("Token", "name", False)],
          "Grouping": [("Expr", "expression", True)],
-         "Literal": [("StackVar", "value", False),
-                     ("std::string", "lexeme", False)],
+         "Literal": [("Value", "value", False),
+                     ("Symbol", "lexeme", False)],
          "Logical": [("Expr", "left", True), ("Token", "op", False),
                      ("Expr", "right", True)],
          "Set": [("Expr", "object", True), ("Token", "name", False),
@@ -83,13 +83,13 @@ if __name__ == "__main__":
 
     define_ast(
         output_dir, "Stmt",
-        {"Block": [("std::vector<std::unique_ptr<Stmt>>", "statements", False)],
+        {"Block": [("ArenaList<Stmt*>", "statements", False)],
          "Class": [("Token", "name", False), ("Expr", "superclass", True),
-                   ("std::vector<std::unique_ptr<Function>>", "methods", False)],
+                   ("ArenaList<Function*>", "methods", False)],
          "Expression": [("Expr", "expression", True)],
          "Function": [("Token", "name", False),
-                      ("std::vector<Token>", "parameters", False),
-                      ("std::vector<std::unique_ptr<Stmt>>", "body", False)],
+                      ("ArenaList<Token>", "parameters", False),
+                      ("ArenaList<Stmt*>", "body", False)],
          "If": [("Expr", "condition", True), ("Stmt", "then_branch", True),
                 ("Stmt", "else_branch", True)],
          "Print": [("Expr", "expression", True)],